@@ -0,0 +1,244 @@
+//! End-to-end latency of the work behind the Tauri commands, without a window.
+//!
+//! Each command is split into the phases it runs (parse, format, group,
+//! serialize) next to its end-to-end time, and the JSON payload size handed to
+//! the webview is printed once per command. This is the baseline for any change
+//! to the IPC format. `execute_query` runs against a temporary SQLite file:
+//! `stream_*` go through `stream_query` and a sink that does what the
+//! command's channel sink does (acknowledged batches, JSON or columnar
+//! frames), `collect` buffers the whole result as `DbClient::execute_query`.
+
+mod support;
+
+use std::sync::Arc;
+
+use criterion::{criterion_group, criterion_main, BatchSize, Criterion, Throughput};
+use serde::Serialize;
+use sql_log_parser_lib::core::db::columnar;
+use sql_log_parser_lib::core::db::control::QueryControl;
+use sql_log_parser_lib::core::db::sink::ResultSink;
+use sql_log_parser_lib::core::db::{CellValue, DbClient, DbConfig, DbType};
+use sql_log_parser_lib::core::log_parser::{self, LogParser};
+use sql_log_parser_lib::core::query_processor::QueryProcessor;
+use support::{bench_sizes_mb, generate_log, LogEncoding};
+
+const ENCODING: LogEncoding = LogEncoding::ShiftJis;
+
+fn report_payload(command: &str, bytes: usize) {
+    println!("payload {:<32} {:>12} bytes", command, bytes);
+}
+
+fn bench_process_query(c: &mut Criterion) {
+    for size_mb in bench_sizes_mb() {
+        let log = generate_log(ENCODING, size_mb);
+        let parser = LogParser::new(ENCODING.label().to_string());
+        let mut processor = QueryProcessor::new();
+        processor.parser_mut().set_encoding(ENCODING.label().to_string());
+
+        // Intermediate values for timing each phase in isolation
+        let raw = parser.extract_executions(&log.path, &log.sample_id);
+        let mut executions = raw.clone();
+        log_parser::format_executions(&mut executions);
+        let raw_groups = QueryProcessor::group_executions(&executions);
+        let mut groups = raw_groups.clone();
+        QueryProcessor::format_groups(&mut groups);
+        let result = QueryProcessor::build_result(executions.clone(), groups, false);
+        let payload = serde_json::to_vec(&result).expect("serialize ProcessResult");
+        report_payload(&format!("process_query/{}MB", size_mb), payload.len());
+
+        let mut group = c.benchmark_group(format!("command/process_query/{}MB", size_mb));
+        group.sample_size(10);
+
+        group.bench_function("end_to_end", |b| {
+            b.iter(|| {
+                let result = processor.process_query(&log.sample_id, &log.path, false);
+                serde_json::to_vec(&result).expect("serialize ProcessResult")
+            })
+        });
+        group.bench_function("parse", |b| {
+            b.iter(|| parser.extract_executions(&log.path, &log.sample_id))
+        });
+        group.bench_function("format", |b| {
+            b.iter_batched(
+                || (raw.clone(), raw_groups.clone()),
+                |(mut execs, mut groups)| {
+                    log_parser::format_executions(&mut execs);
+                    QueryProcessor::format_groups(&mut groups);
+                    (execs, groups)
+                },
+                BatchSize::LargeInput,
+            )
+        });
+        group.bench_function("group", |b| {
+            b.iter(|| QueryProcessor::group_executions(&executions))
+        });
+        group.throughput(Throughput::Bytes(payload.len() as u64));
+        group.bench_function("serialize", |b| {
+            b.iter(|| serde_json::to_vec(&result).expect("serialize ProcessResult"))
+        });
+
+        group.finish();
+    }
+}
+
+fn bench_get_all_ids(c: &mut Criterion) {
+    for size_mb in bench_sizes_mb() {
+        let log = generate_log(ENCODING, size_mb);
+        let parser = LogParser::new(ENCODING.label().to_string());
+
+        let ids = parser.get_all_ids(&log.path);
+        let payload = serde_json::to_vec(&ids).expect("serialize IdInfo");
+        report_payload(&format!("get_all_ids/{}MB", size_mb), payload.len());
+
+        let mut group = c.benchmark_group(format!("command/get_all_ids/{}MB", size_mb));
+        group.sample_size(10);
+
+        group.bench_function("parse", |b| b.iter(|| parser.get_all_ids(&log.path)));
+        group.throughput(Throughput::Bytes(payload.len() as u64));
+        group.bench_function("serialize", |b| {
+            b.iter(|| serde_json::to_vec(&ids).expect("serialize IdInfo"))
+        });
+
+        group.finish();
+    }
+}
+
+/// Create a fresh SQLite file holding `rows` rows of mixed column types.
+fn sqlite_fixture(rt: &tokio::runtime::Runtime, client: &DbClient, rows: u32) -> DbConfig {
+    let dir = std::env::temp_dir().join("log-helper-bench");
+    std::fs::create_dir_all(&dir).expect("create bench dir");
+    let path = dir.join(format!("execute_query_{}.sqlite", rows));
+    let _ = std::fs::remove_file(&path);
+
+    let config = DbConfig {
+        id: format!("bench-{}", rows),
+        name: format!("bench-{}", rows),
+        db_type: DbType::Sqlite,
+        url: format!("sqlite://{}?mode=rwc", path.to_string_lossy().replace('\\', "/")),
+        ..Default::default()
+    };
+
+    rt.block_on(async {
+        client
+            .execute_query(
+                &config,
+                "CREATE TABLE bench_rows (id INTEGER PRIMARY KEY, user_name TEXT, amount REAL, active INTEGER, created_at TEXT)",
+            )
+            .await
+            .expect("create bench table");
+        client
+            .execute_query(
+                &config,
+                &format!(
+                    "INSERT INTO bench_rows (id, user_name, amount, active, created_at) \
+                     WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < {}) \
+                     SELECT n, '山田太郎' || n, n * 1.25, n % 2, '2024-01-01 10:00:00' FROM seq",
+                    rows
+                ),
+            )
+            .await
+            .expect("fill bench table");
+    });
+
+    config
+}
+
+/// Batches in flight before the sink waits for an acknowledgement, as in
+/// the `execute_query` command.
+const BATCHES_IN_FLIGHT: usize = 4;
+
+#[derive(Serialize)]
+#[serde(tag = "kind", rename_all = "snake_case")]
+enum Event<'a> {
+    Columns { columns: &'a [String] },
+    Rows { rows: &'a [Vec<CellValue>] },
+}
+
+/// Stands in for the command's channel sink: serializes each batch and
+/// hands it to a task playing the webview, which acknowledges it.
+struct AckedSink {
+    columnar: bool,
+    column_count: usize,
+    window: Arc<tokio::sync::Semaphore>,
+    frames: tokio::sync::mpsc::UnboundedSender<Vec<u8>>,
+}
+
+impl AckedSink {
+    fn new(columnar: bool) -> Self {
+        let window = Arc::new(tokio::sync::Semaphore::new(BATCHES_IN_FLIGHT));
+        let (frames, mut rx) = tokio::sync::mpsc::unbounded_channel::<Vec<u8>>();
+        let acks = Arc::clone(&window);
+        tokio::spawn(async move {
+            while let Some(frame) = rx.recv().await {
+                std::hint::black_box(frame);
+                acks.add_permits(1);
+            }
+        });
+        Self { columnar, column_count: 0, window, frames }
+    }
+}
+
+#[async_trait::async_trait]
+impl ResultSink for AckedSink {
+    async fn columns(&mut self, columns: &[String]) -> anyhow::Result<()> {
+        self.column_count = columns.len();
+        let json = serde_json::to_vec(&Event::Columns { columns })?;
+        // Not a row batch, so never acknowledged
+        std::hint::black_box(json);
+        Ok(())
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        self.window.acquire().await?.forget();
+        let frame = if self.columnar {
+            columnar::encode_batch(&rows, self.column_count)
+        } else {
+            serde_json::to_vec(&Event::Rows { rows: &rows })?
+        };
+        self.frames.send(frame)?;
+        Ok(true)
+    }
+}
+
+fn bench_execute_query(c: &mut Criterion) {
+    let rt = tokio::runtime::Runtime::new().expect("tokio runtime");
+    let client = DbClient::new();
+
+    for rows in [100u32, 10_000] {
+        let config = sqlite_fixture(&rt, &client, rows);
+        let sql = "SELECT * FROM bench_rows";
+
+        let result = rt
+            .block_on(client.execute_query(&config, sql))
+            .expect("bench query");
+        let payload = serde_json::to_vec(&result).expect("serialize QueryResult");
+        report_payload(&format!("execute_query/{}rows", rows), payload.len());
+
+        let mut group = c.benchmark_group(format!("command/execute_query/{}rows", rows));
+
+        for (name, columnar) in [("stream_json", false), ("stream_columnar", true)] {
+            group.bench_function(name, |b| {
+                b.iter(|| {
+                    rt.block_on(async {
+                        let mut sink = AckedSink::new(columnar);
+                        let control = QueryControl::for_config(&config, Default::default());
+                        client.stream_query(&config, sql, &mut sink, &control).await
+                    })
+                    .expect("bench query")
+                })
+            });
+        }
+        group.bench_function("collect", |b| {
+            b.iter(|| rt.block_on(client.execute_query(&config, sql)).expect("bench query"))
+        });
+        group.throughput(Throughput::Bytes(payload.len() as u64));
+        group.bench_function("serialize", |b| {
+            b.iter(|| serde_json::to_vec(&result).expect("serialize QueryResult"))
+        });
+
+        group.finish();
+    }
+}
+
+criterion_group!(benches, bench_process_query, bench_get_all_ids, bench_execute_query);
+criterion_main!(benches);
@@ -0,0 +1,70 @@
+//! Parser throughput benchmarks over generated SJIS and UTF-8 logs.
+//!
+//! File-level benchmarks report throughput in bytes of log read, so criterion
+//! prints MB/s directly. Sizes come from `LOG_BENCH_SIZES_MB` (default 10 MB).
+
+mod support;
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use sql_log_parser_lib::core::log_parser::LogParser;
+use sql_log_parser_lib::core::sql_formatter;
+use support::{bench_sizes_mb, generate_log, LogEncoding};
+
+fn bench_log_files(c: &mut Criterion) {
+    for size_mb in bench_sizes_mb() {
+        for encoding in LogEncoding::ALL {
+            let log = generate_log(encoding, size_mb);
+            let parser = LogParser::new(encoding.label().to_string());
+            let size = format!("{}MB", size_mb);
+
+            let mut group = c.benchmark_group(format!("log_file/{}", encoding.label()));
+            group.throughput(Throughput::Bytes(log.bytes));
+            // Criterion's minimum; large files take seconds per iteration
+            group.sample_size(10);
+
+            group.bench_function(BenchmarkId::new("get_all_ids", &size), |b| {
+                b.iter(|| parser.get_all_ids(&log.path))
+            });
+            group.bench_function(BenchmarkId::new("parse_log_file_advanced", &size), |b| {
+                b.iter(|| parser.parse_log_file_advanced(&log.path, &log.sample_id))
+            });
+            group.bench_function(BenchmarkId::new("get_last_query", &size), |b| {
+                b.iter(|| parser.get_last_query(&log.path))
+            });
+
+            group.finish();
+        }
+    }
+}
+
+fn bench_params_and_formatting(c: &mut Criterion) {
+    let parser = LogParser::default();
+    let mut group = c.benchmark_group("statement");
+
+    for n in [5usize, 100, 500] {
+        let params_str = support::params_string(n);
+        let params = parser.parse_params_string(&params_str);
+        let sql = support::in_list_sql(n);
+
+        group.throughput(Throughput::Bytes(params_str.len() as u64));
+        group.bench_with_input(BenchmarkId::new("parse_params_string", n), &params_str, |b, s| {
+            b.iter(|| parser.parse_params_string(s))
+        });
+
+        group.throughput(Throughput::Bytes(sql.len() as u64));
+        group.bench_with_input(BenchmarkId::new("replace_placeholders", n), &sql, |b, sql| {
+            b.iter(|| sql_formatter::replace_placeholders(sql, &params))
+        });
+
+        let filled = sql_formatter::replace_placeholders(&sql, &params).unwrap_or(sql);
+        group.throughput(Throughput::Bytes(filled.len() as u64));
+        group.bench_with_input(BenchmarkId::new("format_sql", n), &filled, |b, sql| {
+            b.iter(|| sql_formatter::format_sql(sql))
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_log_files, bench_params_and_formatting);
+criterion_main!(benches);
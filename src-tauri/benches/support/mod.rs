@@ -0,0 +1,240 @@
+//! Deterministic synthetic log generator shared by the benchmarks.
+//!
+//! Produces logs shaped like `stcApp.log`: Japanese noise lines, `id=... sql=`
+//! statements followed by `id=... params=` lines, `Daoの終了` markers and
+//! statements with long IN-lists. The same seed always yields the same file.
+
+#![allow(dead_code)]
+
+use std::fs::{self, File};
+use std::io::{BufWriter, Write};
+use std::path::PathBuf;
+
+/// Sizes used when `LOG_BENCH_SIZES_MB` is not set.
+const DEFAULT_SIZES_MB: &[u64] = &[10];
+
+const SEED: u64 = 0x5EED_106_4E1;
+
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum LogEncoding {
+    ShiftJis,
+    Utf8,
+}
+
+impl LogEncoding {
+    pub const ALL: [LogEncoding; 2] = [LogEncoding::ShiftJis, LogEncoding::Utf8];
+
+    /// Label understood by `LogParser::new`.
+    pub fn label(self) -> &'static str {
+        match self {
+            LogEncoding::ShiftJis => "SHIFT_JIS",
+            LogEncoding::Utf8 => "UTF-8",
+        }
+    }
+}
+
+/// A generated log file on disk.
+pub struct GeneratedLog {
+    pub path: String,
+    pub bytes: u64,
+    /// An ID with many executions, for single-ID lookups.
+    pub sample_id: String,
+}
+
+/// Sizes requested through `LOG_BENCH_SIZES_MB` (comma separated), or the default.
+pub fn bench_sizes_mb() -> Vec<u64> {
+    std::env::var("LOG_BENCH_SIZES_MB")
+        .ok()
+        .map(|v| v.split(',').filter_map(|s| s.trim().parse().ok()).collect::<Vec<u64>>())
+        .filter(|v| !v.is_empty())
+        .unwrap_or_else(|| DEFAULT_SIZES_MB.to_vec())
+}
+
+/// Small xorshift generator; benchmarks need repeatability, not quality.
+pub struct Rng(u64);
+
+impl Rng {
+    pub fn new(seed: u64) -> Self {
+        Rng(seed.max(1))
+    }
+
+    pub fn next(&mut self) -> u64 {
+        let mut x = self.0;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        self.0 = x;
+        x
+    }
+
+    pub fn below(&mut self, n: u64) -> u64 {
+        self.next() % n
+    }
+
+    pub fn pick<'a, T>(&mut self, items: &'a [T]) -> &'a T {
+        &items[self.below(items.len() as u64) as usize]
+    }
+}
+
+const NOISE: &[&str] = &[
+    "INFO,jp.co.stc.web.action.LoginAction,リクエスト開始 ユーザー=U{n} 画面=ログイン",
+    "INFO,jp.co.stc.web.filter.SessionFilter,セッション確認 session={h}",
+    "DEBUG,jp.co.stc.common.util.CacheUtil,キャッシュヒット key=M_CODE_{n}",
+    "WARN,jp.co.stc.web.action.OrderAction,入力チェックエラー 項目=数量 値={n}",
+    "INFO,jp.co.stc.batch.JobRunner,ジョブ進捗 {n}件処理済み",
+];
+
+const DAOS: &[&str] = &["UserDao", "OrderDao", "ItemDao", "StockDao", "AuditLogDao"];
+
+const NAMES: &[&str] = &["山田太郎", "佐藤花子", "鈴木一郎", "O'Brien", "高橋", "ｶﾀｶﾅ", "test"];
+
+/// A statement template and the types of its placeholders.
+fn statement(rng: &mut Rng) -> (String, Vec<&'static str>) {
+    match rng.below(8) {
+        0 | 1 => (
+            "SELECT u.user_id, u.user_name, u.dept_cd FROM m_user u WHERE u.user_id = ? AND u.del_flg = ?".to_string(),
+            vec!["String", "Int"],
+        ),
+        2 | 3 => (
+            "UPDATE t_order SET status = ?, upd_user = ?, upd_date = ? WHERE order_no = ? AND version = ?".to_string(),
+            vec!["Int", "String", "Timestamp", "String", "Long"],
+        ),
+        4 => (
+            "INSERT INTO t_audit_log (log_id, user_name, amount, created_at) VALUES (?, ?, ?, ?)".to_string(),
+            vec!["Long", "String", "BigDecimal", "Timestamp"],
+        ),
+        5 => {
+            let n = 50 + rng.below(450) as usize;
+            (in_list_sql(n), vec!["String"; n])
+        }
+        _ => (
+            "SELECT s.item_cd, SUM(s.qty) FROM t_stock s INNER JOIN m_item i ON i.item_cd = s.item_cd WHERE s.warehouse_cd = ? GROUP BY s.item_cd ORDER BY s.item_cd".to_string(),
+            vec!["String"],
+        ),
+    }
+}
+
+/// `SELECT ... WHERE item_cd IN (?, ?, ...)` with `n` placeholders.
+pub fn in_list_sql(n: usize) -> String {
+    let mut sql = String::from("SELECT i.item_cd, i.item_name, i.price FROM m_item i WHERE i.item_cd IN (");
+    for i in 0..n {
+        if i > 0 {
+            sql.push_str(", ");
+        }
+        sql.push('?');
+    }
+    sql.push_str(") AND i.del_flg = 0");
+    sql
+}
+
+/// Params in log format (`[Type:index:value]...`) for the given placeholder types.
+pub fn params_for(rng: &mut Rng, types: &[&str]) -> String {
+    let mut out = String::new();
+    for (i, ty) in types.iter().enumerate() {
+        let value = match *ty {
+            "String" => format!("{}{}", rng.pick(NAMES), rng.below(10_000)),
+            "Timestamp" => format!("2024-01-{:02} {:02}:{:02}:00.0", 1 + rng.below(28), rng.below(24), rng.below(60)),
+            "BigDecimal" => format!("{}.{:02}", rng.below(1_000_000), rng.below(100)),
+            _ => rng.below(1_000_000).to_string(),
+        };
+        out.push_str(&format!("[{}:{}:{}]", ty, i + 1, value));
+    }
+    out
+}
+
+/// A `params=` payload with `n` string parameters, for the micro benchmarks.
+pub fn params_string(n: usize) -> String {
+    params_for(&mut Rng::new(SEED), &vec!["String"; n])
+}
+
+fn hex_id(rng: &mut Rng) -> String {
+    format!("{:016x}", rng.next())
+}
+
+fn timestamp(seconds: u64) -> String {
+    let day = 1 + (seconds / 86_400) % 28;
+    let s = seconds % 86_400;
+    format!("2024/01/{:02} {:02}:{:02}:{:02}", day, s / 3600, (s / 60) % 60, s % 60)
+}
+
+/// Write one CRLF-terminated line in the target encoding, returning its size.
+fn write_line(out: &mut BufWriter<File>, encoding: LogEncoding, line: &str) -> u64 {
+    let bytes: std::borrow::Cow<[u8]> = match encoding {
+        LogEncoding::ShiftJis => encoding_rs::SHIFT_JIS.encode(line).0,
+        LogEncoding::Utf8 => line.as_bytes().into(),
+    };
+    out.write_all(&bytes).expect("write bench log");
+    out.write_all(b"\r\n").expect("write bench log");
+    bytes.len() as u64 + 2
+}
+
+/// Return a cached log of roughly `size_mb` megabytes, generating it if needed.
+pub fn generate_log(encoding: LogEncoding, size_mb: u64) -> GeneratedLog {
+    let dir = std::env::temp_dir().join("log-helper-bench");
+    fs::create_dir_all(&dir).expect("create bench dir");
+    let path: PathBuf = dir.join(format!("stcApp_{}_{}MB_{:x}.log", encoding.label(), size_mb, SEED));
+    let target = size_mb * 1024 * 1024;
+
+    // The hot ID is derived from the seed, so it is known without re-reading the file.
+    let sample_id = hex_id(&mut Rng::new(SEED ^ 0xA11CE));
+
+    if let Ok(meta) = fs::metadata(&path) {
+        if meta.len() >= target {
+            return GeneratedLog {
+                path: path.to_string_lossy().into_owned(),
+                bytes: meta.len(),
+                sample_id,
+            };
+        }
+    }
+
+    let mut rng = Rng::new(SEED);
+    let mut out = BufWriter::with_capacity(1 << 20, File::create(&path).expect("create bench log"));
+    let mut written = 0u64;
+    let mut clock = 0u64;
+
+    while written < target {
+        clock += 1 + rng.below(3);
+        let ts = timestamp(clock);
+
+        for _ in 0..rng.below(4) {
+            let noise = rng.pick(NOISE)
+                .replace("{n}", &rng.below(100_000).to_string())
+                .replace("{h}", &hex_id(&mut rng));
+            written += write_line(&mut out, encoding, &format!("{},{}", ts, noise));
+        }
+
+        // The hot ID recurs every few hundred transactions, like a busy session
+        let id = if rng.below(512) == 0 { sample_id.clone() } else { hex_id(&mut rng) };
+        let dao = rng.pick(DAOS);
+        let (sql, types) = statement(&mut rng);
+        written += write_line(
+            &mut out,
+            encoding,
+            &format!("{},DEBUG,jp.co.stc.dao.{},id={} sql={}", ts, dao, id, sql),
+        );
+
+        for _ in 0..1 + rng.below(3) {
+            let params = params_for(&mut rng, &types);
+            written += write_line(
+                &mut out,
+                encoding,
+                &format!("{},DEBUG,jp.co.stc.dao.{},id={} params={}", ts, dao, id, params),
+            );
+        }
+
+        written += write_line(
+            &mut out,
+            encoding,
+            &format!("{},INFO,jp.co.stc.common.DaoInterceptor,Daoの終了jp.co.stc.dao.{}, 処理時間={}ms", ts, dao, rng.below(500)),
+        );
+    }
+
+    out.flush().expect("flush bench log");
+
+    GeneratedLog {
+        path: path.to_string_lossy().into_owned(),
+        bytes: written,
+        sample_id,
+    }
+}
@@ -1,3 +1,5 @@
 fn main() {
-    tauri_build::build()
+    // The headless CLI (`--no-default-features`) has no Tauri context to generate.
+    #[cfg(feature = "gui")]
+    tauri_build::build();
 }
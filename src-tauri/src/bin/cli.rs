@@ -0,0 +1,315 @@
+//! Headless command-line front end for batch log extraction.
+//!
+//! Shares `core::log_parser` and `core::query_processor` with the GUI but needs
+//! no webview or clipboard, so it can run unattended on the app servers.
+//! Every record is written to stdout as one JSON object per line (JSONL).
+//! `load` replays a window of the logs against a saved connection instead
+//! and prints one report.
+
+use std::collections::HashSet;
+use std::io::{self, BufWriter, Write};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::mpsc;
+
+use serde::Serialize;
+use sql_log_parser_lib::core::db::control::QueryControl;
+use sql_log_parser_lib::core::db::load::LoadOptions;
+use sql_log_parser_lib::core::db::{ConnectionManager, DbClient};
+use sql_log_parser_lib::core::log_parser::{format_executions, LogParser};
+use sql_log_parser_lib::core::query_processor::QueryProcessor;
+
+const USAGE: &str = "\
+Usage: sql-log-parser-cli <COMMAND> [OPTIONS] <FILE>...
+
+Commands:
+  ids                 List every ID with its DAO name and params count
+  query --id <ID>     Process one ID (grouped executions, filled SQL)
+  batch [--id <ID>]   Extract executions of many IDs in a single pass per file
+  last                Process the last query of each file
+  load --connection <NAME>
+                      Replay the executions of all files against a saved
+                      connection and report latency per template
+
+Options:
+  --id <ID>           Target ID (repeatable, or comma separated for `batch`)
+  --ids-file <PATH>   File with one ID per line (`batch` only)
+  --encoding <LABEL>  Log file encoding [default: SHIFT_JIS]
+  --jobs <N>          Worker threads [default: all cores]
+  -h, --help          Show this help
+
+Load options:
+  --connection <NAME> Saved connection (name or ID) to replay against
+  --from <TIMESTAMP>  First log timestamp to replay, e.g. \"2024/01/01 10:00:00\"
+  --to <TIMESTAMP>    Last log timestamp to replay
+  --speed <X>         Multiple of the original pace; 0 = no pauses [default: 1]
+  --workers <N>       Concurrent connections [default: 4]";
+
+/// One output line: the source file plus the flattened payload.
+#[derive(Serialize)]
+struct Record<'a, T: Serialize> {
+    file: &'a str,
+    #[serde(flatten)]
+    data: T,
+}
+
+#[derive(Clone, Copy, PartialEq)]
+enum Command {
+    Ids,
+    Query,
+    Batch,
+    Last,
+    Load,
+}
+
+struct Options {
+    command: Command,
+    ids: Vec<String>,
+    encoding: String,
+    jobs: usize,
+    files: Vec<String>,
+    connection: Option<String>,
+    load: LoadOptions,
+}
+
+fn parse_args(args: &[String]) -> Result<Options, String> {
+    let command = match args.first().map(|s| s.as_str()) {
+        Some("ids") => Command::Ids,
+        Some("query") => Command::Query,
+        Some("batch") => Command::Batch,
+        Some("last") => Command::Last,
+        Some("load") => Command::Load,
+        Some(other) => return Err(format!("Unknown command '{}'", other)),
+        None => return Err("Missing command".to_string()),
+    };
+
+    let mut opts = Options {
+        command,
+        ids: Vec::new(),
+        encoding: "SHIFT_JIS".to_string(),
+        jobs: std::thread::available_parallelism().map(|n| n.get()).unwrap_or(1),
+        files: Vec::new(),
+        connection: None,
+        load: LoadOptions { from: None, to: None, speed: 1.0, workers: 4 },
+    };
+
+    let mut iter = args[1..].iter();
+    while let Some(arg) = iter.next() {
+        let mut value = |name: &str| {
+            iter.next()
+                .cloned()
+                .ok_or_else(|| format!("Missing value for {}", name))
+        };
+        match arg.as_str() {
+            "--id" => opts.ids.extend(
+                value("--id")?
+                    .split(',')
+                    .map(|s| s.trim().to_string())
+                    .filter(|s| !s.is_empty()),
+            ),
+            "--ids-file" => {
+                let path = value("--ids-file")?;
+                let content = std::fs::read_to_string(&path)
+                    .map_err(|e| format!("Failed to read {}: {}", path, e))?;
+                opts.ids.extend(
+                    content
+                        .lines()
+                        .map(|l| l.trim().to_string())
+                        .filter(|l| !l.is_empty()),
+                );
+            }
+            "--encoding" => opts.encoding = value("--encoding")?,
+            "--jobs" => {
+                opts.jobs = value("--jobs")?
+                    .parse()
+                    .ok()
+                    .filter(|n: &usize| *n > 0)
+                    .ok_or_else(|| "--jobs must be a positive number".to_string())?;
+            }
+            "--connection" => opts.connection = Some(value("--connection")?),
+            "--from" => opts.load.from = Some(value("--from")?),
+            "--to" => opts.load.to = Some(value("--to")?),
+            "--speed" => {
+                opts.load.speed = value("--speed")?
+                    .parse()
+                    .ok()
+                    .filter(|x: &f64| *x >= 0.0)
+                    .ok_or_else(|| "--speed must be a non-negative number".to_string())?;
+            }
+            "--workers" => {
+                opts.load.workers = value("--workers")?
+                    .parse()
+                    .ok()
+                    .filter(|n: &usize| *n > 0)
+                    .ok_or_else(|| "--workers must be a positive number".to_string())?;
+            }
+            s if s.starts_with("--") => return Err(format!("Unknown option '{}'", s)),
+            file => opts.files.push(file.to_string()),
+        }
+    }
+
+    if opts.files.is_empty() {
+        return Err("No log files given".to_string());
+    }
+    if opts.command == Command::Query && opts.ids.len() != 1 {
+        return Err("`query` needs exactly one --id".to_string());
+    }
+    if opts.command == Command::Load && opts.connection.is_none() {
+        return Err("`load` needs --connection".to_string());
+    }
+    Ok(opts)
+}
+
+fn push_record<T: Serialize>(lines: &mut Vec<String>, file: &str, data: &T) {
+    match serde_json::to_string(&Record { file, data }) {
+        Ok(line) => lines.push(line),
+        Err(e) => eprintln!("{}: failed to serialize record: {}", file, e),
+    }
+}
+
+/// Run one file through the selected command and serialize its records.
+fn process_file(opts: &Options, file: &str) -> Vec<String> {
+    let mut lines = Vec::new();
+
+    match opts.command {
+        Command::Ids => {
+            let parser = LogParser::new(opts.encoding.clone());
+            for info in parser.get_all_ids(file) {
+                push_record(&mut lines, file, &info);
+            }
+        }
+        Command::Query => {
+            let mut processor = QueryProcessor::new();
+            processor.parser_mut().set_encoding(opts.encoding.clone());
+            let result = processor.process_query(&opts.ids[0], file, false);
+            push_record(&mut lines, file, &result);
+        }
+        Command::Batch => {
+            let parser = LogParser::new(opts.encoding.clone());
+            let wanted: HashSet<&str> = opts.ids.iter().map(|s| s.as_str()).collect();
+            // Format only the executions that are written out
+            let mut executions =
+                parser.extract_all_executions(file, |id| wanted.is_empty() || wanted.contains(id));
+            format_executions(&mut executions);
+            for exec in &executions {
+                push_record(&mut lines, file, exec);
+            }
+        }
+        Command::Last => {
+            let mut processor = QueryProcessor::new();
+            processor.parser_mut().set_encoding(opts.encoding.clone());
+            let result = processor.process_last_query(file, false);
+            push_record(&mut lines, file, &result);
+        }
+        Command::Load => unreachable!("`load` runs in `run_load`"),
+    }
+
+    lines
+}
+
+/// Replay the executions of every file against the saved connection and
+/// print the report. Ctrl-C stops the replay.
+fn run_load(opts: &Options) -> Result<(), String> {
+    let name = opts.connection.as_deref().unwrap_or_default();
+    let config = ConnectionManager::new()
+        .connections
+        .into_iter()
+        .find(|c| c.name == name || c.id == name)
+        .ok_or_else(|| format!("No saved connection named '{}'", name))?;
+
+    let parser = LogParser::new(opts.encoding.clone());
+    let executions: Vec<_> = opts.files.iter().flat_map(|f| parser.extract_all_executions(f, |_| true)).collect();
+
+    let runtime = tokio::runtime::Runtime::new().map_err(|e| e.to_string())?;
+    let report = runtime.block_on(async {
+        let cancel = tokio_util::sync::CancellationToken::new();
+        let on_ctrl_c = cancel.clone();
+        tokio::spawn(async move {
+            if tokio::signal::ctrl_c().await.is_ok() {
+                on_ctrl_c.cancel();
+            }
+        });
+        let control = QueryControl::for_config(&config, cancel);
+        DbClient::new()
+            .replay_load(&config, &executions, &opts.load, &control)
+            .await
+            .map_err(|e| e.to_string())
+    })?;
+
+    let line = serde_json::to_string(&report).map_err(|e| e.to_string())?;
+    println!("{}", line);
+    Ok(())
+}
+
+fn main() {
+    let args: Vec<String> = std::env::args().skip(1).collect();
+    if args.is_empty() || args.iter().any(|a| a == "-h" || a == "--help") {
+        println!("{}", USAGE);
+        return;
+    }
+
+    let mut opts = match parse_args(&args) {
+        Ok(o) => o,
+        Err(e) => {
+            eprintln!("error: {}\n\n{}", e, USAGE);
+            std::process::exit(2);
+        }
+    };
+
+    opts.files.retain(|file| {
+        let is_file = std::path::Path::new(file).is_file();
+        if !is_file {
+            eprintln!("warning: {} is not a file, skipping", file);
+        }
+        is_file
+    });
+    if opts.files.is_empty() {
+        eprintln!("error: no readable log files");
+        std::process::exit(1);
+    }
+
+    if opts.command == Command::Load {
+        if let Err(e) = run_load(&opts) {
+            eprintln!("error: {}", e);
+            std::process::exit(1);
+        }
+        return;
+    }
+
+    // Workers pull files from a shared index; the main thread owns stdout so
+    // records of one file are never interleaved with another's.
+    let next = AtomicUsize::new(0);
+    let (tx, rx) = mpsc::channel::<Vec<String>>();
+    let workers = opts.jobs.min(opts.files.len());
+
+    let write_result = std::thread::scope(|scope| {
+        for _ in 0..workers {
+            let tx = tx.clone();
+            let (opts, next) = (&opts, &next);
+            scope.spawn(move || loop {
+                let i = next.fetch_add(1, Ordering::Relaxed);
+                let Some(file) = opts.files.get(i) else { break };
+                if tx.send(process_file(opts, file)).is_err() {
+                    break;
+                }
+            });
+        }
+        drop(tx);
+
+        let stdout = io::stdout();
+        let mut out = BufWriter::new(stdout.lock());
+        for lines in rx {
+            for line in lines {
+                writeln!(out, "{}", line)?;
+            }
+        }
+        out.flush()
+    });
+
+    if let Err(e) = write_result {
+        // A closed pipe (e.g. `| head`) is not an error worth reporting
+        if e.kind() != io::ErrorKind::BrokenPipe {
+            eprintln!("error: {}", e);
+            std::process::exit(1);
+        }
+    }
+}
@@ -1,13 +1,38 @@
+use serde::{Deserialize, Serialize};
+use std::sync::Arc;
+use std::time::Instant;
+use tauri::ipc::{Channel, Response};
 use tauri::State;
+use tokio::sync::Semaphore;
 
+use crate::core::db::bench::BenchRequest;
+use crate::core::db::checksum::ChecksumRequest;
+use crate::core::db::columnar;
+use crate::core::db::control::QueryControl;
+use crate::core::db::export::{ExportProgress, ExportReport, ExportRequest};
+use crate::core::db::fanout::DiffMode;
+use crate::core::db::health::ConnectionHealth;
+use crate::core::db::replay::ReplayExecution;
+use crate::core::db::session::SessionStatement;
+use crate::core::db::sink::ResultSink;
+use crate::core::db::spill::{SpillLimits, SpillSink};
+use crate::core::db::view::{AggregateRequest, AggregateResult, RetainSink, ViewPage, ViewRequest};
 use crate::core::db::{
-    CellValue, ConnectionFields, DbConfig, ParsedSqlServerUrl,
-    QueryResult as DbQueryResult,
+    CellValue, ConnectionFields, DbConfig, ParsedSqlServerUrl, QueryResult,
 };
-use crate::core::log_parser::IdInfo;
-use crate::core::query_processor::ProcessResult;
+use crate::core::history::{HistoryEntry, HistoryFilter};
 use crate::config::Config;
 use crate::state::AppState;
+use crate::utils::{memory, perf};
+
+/// Serialize a command result here rather than in Tauri, so the cost and
+/// size of the payload show up in the perf stats.
+fn to_json_response<T: Serialize>(value: &T) -> Result<Response, String> {
+    let _span = perf::span("serialize");
+    let json = serde_json::to_string(value).map_err(|e| e.to_string())?;
+    perf::record_payload(json.len());
+    Ok(Response::new(json))
+}
 
 // ─── Log Parser Commands ────────────────────────────────────────────────────
 
@@ -16,10 +41,12 @@ pub fn get_all_ids(
     state: State<AppState>,
     log_path: String,
     encoding: String,
-) -> Vec<IdInfo> {
+) -> Result<Response, String> {
     use crate::core::log_parser::LogParser;
-    let parser = LogParser::new(encoding);
-    parser.get_all_ids(&log_path)
+    perf::trace("get_all_ids", || {
+        let parser = LogParser::new(encoding);
+        to_json_response(&parser.get_all_ids(&log_path))
+    })
 }
 
 #[tauri::command]
@@ -29,10 +56,12 @@ pub fn process_query(
     log_path: String,
     auto_copy: bool,
     encoding: String,
-) -> ProcessResult {
-    let mut processor = state.query_processor.lock().unwrap();
-    processor.parser_mut().set_encoding(encoding);
-    processor.process_query(&target_id, &log_path, auto_copy)
+) -> Result<Response, String> {
+    perf::trace("process_query", || {
+        let mut processor = state.query_processor.lock().unwrap();
+        processor.parser_mut().set_encoding(encoding);
+        to_json_response(&processor.process_query(&target_id, &log_path, auto_copy))
+    })
 }
 
 #[tauri::command]
@@ -41,10 +70,12 @@ pub fn process_last_query(
     log_path: String,
     auto_copy: bool,
     encoding: String,
-) -> ProcessResult {
-    let mut processor = state.query_processor.lock().unwrap();
-    processor.parser_mut().set_encoding(encoding);
-    processor.process_last_query(&log_path, auto_copy)
+) -> Result<Response, String> {
+    perf::trace("process_last_query", || {
+        let mut processor = state.query_processor.lock().unwrap();
+        processor.parser_mut().set_encoding(encoding);
+        to_json_response(&processor.process_last_query(&log_path, auto_copy))
+    })
 }
 
 // ─── Database Connection Commands ───────────────────────────────────────────
@@ -69,8 +100,11 @@ pub fn update_connection(
     state: State<AppState>,
     config: DbConfig,
 ) -> Result<(), String> {
+    let id = config.id.clone();
     let mut mgr = state.connection_manager.lock().unwrap();
-    mgr.update(config).map_err(|e| e.to_string())
+    mgr.update(config).map_err(|e| e.to_string())?;
+    state.db_client.invalidate(&id);
+    Ok(())
 }
 
 #[tauri::command]
@@ -79,7 +113,9 @@ pub fn delete_connection(
     id: String,
 ) -> Result<(), String> {
     let mut mgr = state.connection_manager.lock().unwrap();
-    mgr.delete(&id).map_err(|e| e.to_string())
+    mgr.delete(&id).map_err(|e| e.to_string())?;
+    state.db_client.invalidate(&id);
+    Ok(())
 }
 
 #[tauri::command]
@@ -95,26 +131,431 @@ pub async fn test_connection(
     Ok("Connection successful".to_string())
 }
 
+fn saved_connection(state: &AppState, connection_id: &str) -> Result<DbConfig, String> {
+    let mgr = state.connection_manager.lock().unwrap();
+    mgr.connections
+        .iter()
+        .find(|c| c.id == connection_id)
+        .cloned()
+        .ok_or_else(|| "Connection not found".to_string())
+}
+
+/// Open a pooled connection when a connection is selected, so the first
+/// query does not pay for the login.
+#[tauri::command]
+pub async fn warm_connection(
+    state: State<'_, AppState>,
+    connection_id: String,
+) -> Result<(), String> {
+    let conn = saved_connection(&state, &connection_id)?;
+
+    let client = state.db_client.clone();
+    client.warm(&conn).await.map_err(|e| e.to_string())
+}
+
+/// Probe every saved connection in parallel and return each one's recent
+/// connect, login and round-trip timings.
+#[tauri::command]
+pub async fn probe_connections(state: State<'_, AppState>) -> Result<Vec<ConnectionHealth>, String> {
+    let configs = state.connection_manager.lock().unwrap().connections.clone();
+
+    let client = state.db_client.clone();
+    Ok(client.probe_connections(&configs).await)
+}
+
+/// Row batches sent to the webview before it has to acknowledge one; past
+/// this, reading from the server pauses until the UI catches up.
+const BATCHES_IN_FLIGHT: usize = 4;
+
+/// Progress of a running `execute_query`, in order: for each result set a
+/// `Columns` followed by any number of `Rows`, then `Finished`.
+#[derive(Serialize)]
+#[serde(tag = "kind", rename_all = "snake_case")]
+pub enum QueryEvent {
+    Columns { columns: Vec<String> },
+    Rows { rows: Vec<Vec<CellValue>> },
+    Finished { result: QueryResult },
+}
+
+/// How row batches travel to the webview.
+#[derive(Debug, Clone, Copy, Default, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum RowFormat {
+    /// `Rows` events with one `CellValue` object per cell.
+    #[default]
+    Json,
+    /// Binary frames from `core::db::columnar`, sent in place of `Rows`.
+    Columnar,
+}
+
+/// Forwards row batches to the webview, waiting for acknowledgements once
+/// `BATCHES_IN_FLIGHT` are outstanding.
+struct ChannelSink {
+    channel: Channel<Response>,
+    window: Arc<Semaphore>,
+    format: RowFormat,
+    column_count: usize,
+}
+
+impl ChannelSink {
+    fn send_event(&self, event: &QueryEvent) -> anyhow::Result<()> {
+        let json = serde_json::to_string(event)?;
+        perf::record_payload(json.len());
+        self.channel.send(Response::new(json))?;
+        Ok(())
+    }
+}
+
+#[async_trait::async_trait]
+impl ResultSink for ChannelSink {
+    async fn columns(&mut self, columns: &[String]) -> anyhow::Result<()> {
+        self.column_count = columns.len();
+        self.send_event(&QueryEvent::Columns { columns: columns.to_vec() })
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        {
+            let _span = perf::span("backpressure");
+            self.window.acquire().await?.forget();
+        }
+        let _span = perf::span("serialize");
+        match self.format {
+            RowFormat::Json => self.send_event(&QueryEvent::Rows { rows })?,
+            RowFormat::Columnar => {
+                let frame = columnar::encode_batch(&rows, self.column_count);
+                perf::record_payload(frame.len());
+                self.channel.send(Response::new(frame))?;
+            }
+        }
+        Ok(true)
+    }
+}
+
+/// Run a query and stream its rows over `on_event` in batches of `format`
+/// (JSON by default). `query_id` is chosen by the caller and names the query
+/// in `ack_result_batches` and `cancel_query`.
 #[tauri::command]
 pub async fn execute_query(
     state: State<'_, AppState>,
     connection_id: String,
     sql: String,
-) -> Result<DbQueryResult, String> {
-    let conn = {
-        let mgr = state.connection_manager.lock().unwrap();
-        mgr.connections
-            .iter()
-            .find(|c| c.id == connection_id)
-            .cloned()
-            .ok_or_else(|| "Connection not found".to_string())?
+    query_id: String,
+    format: Option<RowFormat>,
+    capture_plan: Option<bool>,
+    on_event: Channel<Response>,
+) -> Result<(), String> {
+    let conn = saved_connection(&state, &connection_id)?;
+
+    let window = Arc::new(Semaphore::new(BATCHES_IN_FLIGHT));
+    let running = state.start_query(&query_id, Some(Arc::clone(&window)));
+
+    let limits = {
+        let config = state.config.lock().unwrap();
+        SpillLimits { rows: config.spill_after_rows, bytes: config.spill_after_mb * 1024 * 1024 }
     };
 
     let client = state.db_client.clone();
-    client
-        .execute_query(&conn, &sql)
-        .await
-        .map_err(|e| e.to_string())
+    let control = QueryControl::for_config(&conn, running.cancel.clone()).with_plan_capture(capture_plan.unwrap_or(false));
+    let outcome = perf::trace_async("execute_query", async {
+        let mut sink = ChannelSink {
+            channel: on_event,
+            window,
+            format: format.unwrap_or_default(),
+            column_count: 0,
+        };
+        let start = Instant::now();
+        let mut retain = RetainSink::new(&mut sink);
+        let mut spill = SpillSink::new(&mut retain, limits, &query_id);
+        let result = client
+            .stream_query(&conn, &sql, &mut spill, &control)
+            .await
+            .map_err(|e| e.to_string());
+        let spilled = spill.finish();
+        let retained = retain.finish(spilled.is_some());
+        state.history.record(HistoryEntry::new(&conn, &sql, start.elapsed(), result.as_ref()));
+        let mut result = result?;
+        if !result.result_sets.is_empty() {
+            state.results.insert(query_id.clone(), retained);
+        }
+        if let Some((file, summary)) = spilled {
+            state.spills.insert(query_id.clone(), file);
+            result.spill = Some(summary);
+        }
+        sink.send_event(&QueryEvent::Finished { result })
+            .map_err(|e| e.to_string())
+    })
+    .await;
+    outcome
+}
+
+/// Rows `offset..offset + limit` of result set `result_set` of a spilled
+/// result, counted from the start of the set, as one columnar frame.
+#[tauri::command]
+pub async fn fetch_result_page(
+    state: State<'_, AppState>,
+    result_id: String,
+    result_set: usize,
+    offset: u64,
+    limit: u64,
+) -> Result<Response, String> {
+    let file = state
+        .spills
+        .get(&result_id)
+        .ok_or_else(|| "Result was closed".to_string())?;
+    let rows = file.page(result_set, offset, limit).map_err(|e| e.to_string())?;
+    let frame = columnar::encode_batch(&rows, rows.first().map_or(0, Vec::len));
+    perf::record_payload(frame.len());
+    Ok(Response::new(frame))
+}
+
+/// A sorted and filtered page of a finished result, computed over the rows
+/// kept in the backend.
+#[tauri::command]
+pub async fn view_result(
+    state: State<'_, AppState>,
+    result_id: String,
+    request: ViewRequest,
+) -> Result<ViewPage, String> {
+    let result = state.results.get(&result_id).ok_or_else(|| "Result was closed".to_string())?;
+    perf::trace_async("view_result", async {
+        tokio::task::spawn_blocking(move || result.view(&request))
+            .await
+            .map_err(|e| e.to_string())?
+            .map_err(|e| e.to_string())
+    })
+    .await
+}
+
+/// Group-by aggregates over a finished result.
+#[tauri::command]
+pub async fn aggregate_result(
+    state: State<'_, AppState>,
+    result_id: String,
+    request: AggregateRequest,
+) -> Result<AggregateResult, String> {
+    let result = state.results.get(&result_id).ok_or_else(|| "Result was closed".to_string())?;
+    perf::trace_async("aggregate_result", async {
+        tokio::task::spawn_blocking(move || result.aggregate(&request))
+            .await
+            .map_err(|e| e.to_string())?
+            .map_err(|e| e.to_string())
+    })
+    .await
+}
+
+/// Drop the kept rows and the spill file of `result_id`, if any.
+#[tauri::command]
+pub fn close_result(state: State<AppState>, result_id: String) {
+    state.results.close(&result_id);
+    state.spills.close(&result_id);
+}
+
+/// Recorded executions matching `filter`, newest first.
+#[tauri::command]
+pub async fn search_history(
+    state: State<'_, AppState>,
+    filter: HistoryFilter,
+) -> Result<Vec<HistoryEntry>, String> {
+    state.history.search(&filter).await.map_err(|e| e.to_string())
+}
+
+/// The webview has rendered `batches` more row batches of `query_id`.
+#[tauri::command]
+pub fn ack_result_batches(state: State<AppState>, query_id: String, batches: usize) {
+    if let Some(window) = state
+        .running_queries
+        .lock()
+        .unwrap()
+        .get(&query_id)
+        .and_then(|q| q.window.as_ref())
+    {
+        window.add_permits(batches);
+    }
+}
+
+/// Stop a running `execute_query` or replay; it then fails with "Query
+/// cancelled".
+/// Unknown IDs (e.g. a query that just finished) are ignored.
+#[tauri::command]
+pub fn cancel_query(state: State<AppState>, query_id: String) {
+    if let Some(query) = state.running_queries.lock().unwrap().get(&query_id) {
+        query.cancel.cancel();
+    }
+}
+
+/// Drop cached results of `connection_id`, or of every connection.
+#[tauri::command]
+pub fn invalidate_result_cache(state: State<AppState>, connection_id: Option<String>) {
+    state.db_client.invalidate_cache(connection_id.as_deref());
+}
+
+/// Replay logged executions of `template_sql` on `connection_id` with their
+/// parameters bound. `query_id` names the replay in `cancel_query`.
+#[tauri::command]
+pub async fn replay_group(
+    state: State<'_, AppState>,
+    connection_id: String,
+    template_sql: String,
+    executions: Vec<ReplayExecution>,
+    query_id: String,
+) -> Result<Response, String> {
+    let conn = saved_connection(&state, &connection_id)?;
+
+    let running = state.start_query(&query_id, None);
+
+    let client = state.db_client.clone();
+    let control = QueryControl::for_config(&conn, running.cancel.clone());
+    let outcome = perf::trace_async("replay_group", async {
+        let report = client
+            .replay(&conn, &template_sql, &executions, &control)
+            .await
+            .map_err(|e| e.to_string())?;
+        to_json_response(&report)
+    })
+    .await;
+    outcome
+}
+
+/// Replay every statement of a logged session in order inside a transaction
+/// that is rolled back. `query_id` names the replay in `cancel_query`.
+#[tauri::command]
+pub async fn replay_session(
+    state: State<'_, AppState>,
+    connection_id: String,
+    statements: Vec<SessionStatement>,
+    query_id: String,
+) -> Result<Response, String> {
+    let conn = saved_connection(&state, &connection_id)?;
+
+    let running = state.start_query(&query_id, None);
+
+    let client = state.db_client.clone();
+    let control = QueryControl::for_config(&conn, running.cancel.clone());
+    let outcome = perf::trace_async("replay_session", async {
+        let report = client
+            .replay_session(&conn, &statements, &control)
+            .await
+            .map_err(|e| e.to_string())?;
+        to_json_response(&report)
+    })
+    .await;
+    outcome
+}
+
+/// Run `sql` on all of `connection_ids` at once and diff their rows against
+/// the first. `query_id` names the run in `cancel_query`.
+#[tauri::command]
+pub async fn fan_out_query(
+    state: State<'_, AppState>,
+    connection_ids: Vec<String>,
+    sql: String,
+    mode: Option<DiffMode>,
+    query_id: String,
+) -> Result<Response, String> {
+    let configs = connection_ids
+        .iter()
+        .map(|id| saved_connection(&state, id))
+        .collect::<Result<Vec<_>, _>>()?;
+
+    let running = state.start_query(&query_id, None);
+
+    let client = state.db_client.clone();
+    let outcome = perf::trace_async("fan_out_query", async {
+        let report = client
+            .fan_out(&configs, &sql, mode.unwrap_or_default(), running.cancel.clone())
+            .await
+            .map_err(|e| e.to_string())?;
+        to_json_response(&report)
+    })
+    .await;
+    outcome
+}
+
+/// Compare a table on all of `connection_ids` by server-side checksums over
+/// key ranges. `query_id` names the run in `cancel_query`.
+#[tauri::command]
+pub async fn compare_table_checksums(
+    state: State<'_, AppState>,
+    connection_ids: Vec<String>,
+    request: ChecksumRequest,
+    query_id: String,
+) -> Result<Response, String> {
+    let configs = connection_ids
+        .iter()
+        .map(|id| saved_connection(&state, id))
+        .collect::<Result<Vec<_>, _>>()?;
+
+    let running = state.start_query(&query_id, None);
+
+    let client = state.db_client.clone();
+    let outcome = perf::trace_async("compare_table_checksums", async {
+        let report = client
+            .compare_checksums(&configs, &request, running.cancel.clone())
+            .await
+            .map_err(|e| e.to_string())?;
+        to_json_response(&report)
+    })
+    .await;
+    outcome
+}
+
+/// Run one query repeatedly on a pooled connection and report the spread of
+/// its server, transfer and decode time.
+#[tauri::command]
+pub async fn benchmark_query(
+    state: State<'_, AppState>,
+    connection_id: String,
+    sql: String,
+    request: BenchRequest,
+    query_id: String,
+) -> Result<Response, String> {
+    let conn = saved_connection(&state, &connection_id)?;
+
+    let running = state.start_query(&query_id, None);
+
+    let client = state.db_client.clone();
+    let control = QueryControl::for_config(&conn, running.cancel.clone());
+    let outcome = perf::trace_async("benchmark_query", async {
+        let report = client
+            .benchmark(&conn, &sql, &request, &control)
+            .await
+            .map_err(|e| e.to_string())?;
+        to_json_response(&report)
+    })
+    .await;
+    outcome
+}
+
+/// Stream every row of `sql` into a CSV/TSV file, reporting progress on
+/// `on_progress` a few times a second.
+#[tauri::command]
+pub async fn export_query(
+    state: State<'_, AppState>,
+    connection_id: String,
+    sql: String,
+    request: ExportRequest,
+    query_id: String,
+    on_progress: Channel<ExportProgress>,
+) -> Result<ExportReport, String> {
+    let conn = saved_connection(&state, &connection_id)?;
+
+    let running = state.start_query(&query_id, None);
+
+    let client = state.db_client.clone();
+    let control = QueryControl::for_config(&conn, running.cancel.clone())
+        .without_row_cap()
+        .without_timeout();
+    let report_progress = |progress: ExportProgress| {
+        let _ = on_progress.send(progress);
+    };
+    let outcome = perf::trace_async("export_query", async {
+        client
+            .export_query(&conn, &sql, &request, &control, &report_progress)
+            .await
+            .map_err(|e| e.to_string())
+    })
+    .await;
+    outcome
 }
 
 // ─── Config Commands ────────────────────────────────────────────────────────
@@ -143,6 +584,8 @@ pub fn save_config(
         }
     }
 
+    memory::set_budget_mb(new_config.memory_budget_mb);
+
     let mut config = state.config.lock().unwrap();
     *config = new_config;
     config_mgr.save(&config).map_err(|e| e.to_string())
@@ -164,3 +607,13 @@ pub fn parse_jdbc_url_cmd(url: String) -> Result<ParsedSqlServerUrl, String> {
 pub fn build_jdbc_url_cmd(fields: ConnectionFields) -> String {
     crate::core::db::build_jdbc_url(&fields)
 }
+
+#[tauri::command]
+pub fn get_perf_stats() -> perf::PerfStats {
+    perf::stats()
+}
+
+#[tauri::command]
+pub fn get_memory_stats() -> memory::MemoryStats {
+    memory::stats()
+}
@@ -39,6 +39,16 @@ pub struct Config {
     pub encoding: String,
     #[serde(default = "default_true")]
     pub format_sql: bool,
+    /// Global memory budget for caches and result buffers; 0 = unlimited.
+    #[serde(default = "default_memory_budget_mb")]
+    pub memory_budget_mb: u64,
+    /// Rows of a result streamed to the SQL Executor before the rest is
+    /// spilled to disk and paged; 0 = never.
+    #[serde(default = "default_spill_after_rows")]
+    pub spill_after_rows: u64,
+    /// The same threshold in megabytes of decoded rows; 0 = never.
+    #[serde(default = "default_spill_after_mb")]
+    pub spill_after_mb: u64,
 }
 
 fn default_true() -> bool {
@@ -57,6 +67,18 @@ fn default_encoding() -> String {
     "SHIFT_JIS".to_string()
 }
 
+fn default_memory_budget_mb() -> u64 {
+    1024
+}
+
+fn default_spill_after_rows() -> u64 {
+    100_000
+}
+
+fn default_spill_after_mb() -> u64 {
+    256
+}
+
 impl Default for Config {
     fn default() -> Self {
         Self {
@@ -69,6 +91,9 @@ impl Default for Config {
             csv_separator: ",".to_string(),
             encoding: "SHIFT_JIS".to_string(),
             format_sql: true,
+            memory_budget_mb: default_memory_budget_mb(),
+            spill_after_rows: default_spill_after_rows(),
+            spill_after_mb: default_spill_after_mb(),
         }
     }
 }
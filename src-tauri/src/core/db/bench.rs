@@ -0,0 +1,219 @@
+//! Micro-benchmark of a single query.
+//!
+//! The query runs repeatedly on the connection's pool, bypassing the result
+//! cache, after optional unmeasured warm-up runs. An optional setup script
+//! (e.g. `DBCC DROPCLEANBUFFERS`) runs untimed before every run. Each run is
+//! split into server execution, up to the first result set or the end of a
+//! statement without one; client decoding; and transfer, the rest of the
+//! run, mostly waiting for rows on the wire. Rows are counted, not kept.
+//! A benchmarked write still invalidates the connection's cached results.
+
+use super::control::QueryControl;
+use super::load::percentile;
+use super::sink::ResultSink;
+use super::{CellValue, DbClient, DbConfig};
+use crate::utils::perf;
+use serde::{Deserialize, Serialize};
+use std::time::{Duration, Instant};
+
+pub const MAX_ITERATIONS: u32 = 1000;
+pub const MAX_WARMUP: u32 = 100;
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct BenchRequest {
+    pub iterations: u32,
+    #[serde(default)]
+    pub warmup: u32,
+    /// Run untimed before every run, warm-ups included.
+    #[serde(default)]
+    pub setup_sql: Option<String>,
+}
+
+#[derive(Debug, Clone, Copy, Default, Serialize)]
+pub struct Distribution {
+    pub p50_ms: f64,
+    pub p95_ms: f64,
+    pub max_ms: f64,
+}
+
+impl Distribution {
+    fn of(mut values: Vec<f64>) -> Self {
+        values.sort_by(f64::total_cmp);
+        Self {
+            p50_ms: percentile(&values, 50.0),
+            p95_ms: percentile(&values, 95.0),
+            max_ms: values.last().copied().unwrap_or(0.0),
+        }
+    }
+}
+
+/// One measured run. Phases add up to `total_ms` less any pool checkout.
+#[derive(Debug, Clone, Copy, Default, Serialize)]
+pub struct BenchSample {
+    pub total_ms: f64,
+    pub server_ms: f64,
+    pub transfer_ms: f64,
+    pub decode_ms: f64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct BenchReport {
+    pub iterations: u32,
+    pub warmup: u32,
+    /// Rows returned by the last run.
+    pub rows: u64,
+    pub server: Distribution,
+    pub transfer: Distribution,
+    pub decode: Distribution,
+    pub total: Distribution,
+    /// Every measured run, in order.
+    pub samples: Vec<BenchSample>,
+}
+
+/// Counts rows and notes when the first result set started.
+struct TimingSink {
+    start: Instant,
+    first_columns: Option<Duration>,
+    rows: u64,
+}
+
+impl TimingSink {
+    fn new() -> Self {
+        Self { start: Instant::now(), first_columns: None, rows: 0 }
+    }
+}
+
+#[async_trait::async_trait]
+impl ResultSink for TimingSink {
+    async fn columns(&mut self, _columns: &[String]) -> anyhow::Result<()> {
+        self.first_columns.get_or_insert(self.start.elapsed());
+        Ok(())
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        self.rows += rows.len() as u64;
+        Ok(true)
+    }
+}
+
+fn ms(d: Duration) -> f64 {
+    d.as_secs_f64() * 1000.0
+}
+
+/// Split a run of `total` by the executor's phases and the time its first
+/// result set started. Rows are decoded after that, so decoding comes out
+/// of the transfer time.
+fn split(total: Duration, first_columns: Option<Duration>, phases: &[(&'static str, Duration)]) -> BenchSample {
+    let phase = |name: &str| phases.iter().filter(|(p, _)| *p == name).map(|(_, d)| *d).sum::<Duration>();
+    let connect = phase("connect");
+    let decode = phase("row_decode");
+    let first_columns = first_columns.unwrap_or(total.saturating_sub(decode));
+    BenchSample {
+        total_ms: ms(total),
+        server_ms: ms(first_columns.saturating_sub(connect)),
+        transfer_ms: ms(total.saturating_sub(first_columns + decode)),
+        decode_ms: ms(decode),
+    }
+}
+
+impl DbClient {
+    /// Run `sql` `request.iterations` times and summarise the phases of the
+    /// measured runs. The first failing run ends the benchmark.
+    pub async fn benchmark(
+        &self,
+        config: &DbConfig,
+        sql: &str,
+        request: &BenchRequest,
+        control: &QueryControl,
+    ) -> anyhow::Result<BenchReport> {
+        let iterations = request.iterations.clamp(1, MAX_ITERATIONS);
+        let warmup = request.warmup.min(MAX_WARMUP);
+        let setup = request.setup_sql.as_deref().map(str::trim).filter(|s| !s.is_empty());
+
+        let mut samples = Vec::with_capacity(iterations as usize);
+        let mut rows = 0;
+        for run in 0..warmup + iterations {
+            if control.is_cancelled() {
+                anyhow::bail!("Query cancelled");
+            }
+            if let Some(setup) = setup {
+                let _span = perf::span("setup");
+                self.run_query(config, setup, &mut TimingSink::new(), control)
+                    .await
+                    .map_err(|e| anyhow::anyhow!("Setup failed: {}", e))?;
+            }
+
+            let mut sink = TimingSink::new();
+            let (result, phases) = perf::capture(self.run_query(config, sql, &mut sink, control)).await;
+            let total = sink.start.elapsed();
+            result?;
+            if run >= warmup {
+                samples.push(split(total, sink.first_columns, &phases));
+            }
+            rows = sink.rows;
+        }
+
+        let column = |f: fn(&BenchSample) -> f64| Distribution::of(samples.iter().map(f).collect());
+        Ok(BenchReport {
+            iterations,
+            warmup,
+            rows,
+            server: column(|s| s.server_ms),
+            transfer: column(|s| s.transfer_ms),
+            decode: column(|s| s.decode_ms),
+            total: column(|s| s.total_ms),
+            samples,
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::core::db::DbType;
+
+    #[test]
+    fn test_split_by_first_result_set_and_phases() {
+        let ms = Duration::from_millis;
+        let phases = [("connect", ms(2)), ("row_decode", ms(3)), ("fetch", ms(20)), ("row_decode", ms(1))];
+        let sample = split(ms(30), Some(ms(12)), &phases);
+        assert_eq!(sample.server_ms, 10.0);
+        assert_eq!(sample.decode_ms, 4.0);
+        assert_eq!(sample.transfer_ms, 14.0);
+
+        // Without a result set the server had the whole run
+        let sample = split(ms(8), None, &[]);
+        assert_eq!((sample.server_ms, sample.transfer_ms), (8.0, 0.0));
+    }
+
+    #[tokio::test]
+    async fn test_write_benchmark_drops_cached_results() {
+        let path = std::env::temp_dir().join(format!("bench_test_{}.sqlite", uuid::Uuid::new_v4()));
+        let config = DbConfig {
+            id: "bench-cache".to_string(),
+            db_type: DbType::Sqlite,
+            url: format!("sqlite://{}?mode=rwc", path.to_string_lossy().replace('\\', "/")),
+            cache_ttl_secs: 60,
+            ..Default::default()
+        };
+        let client = DbClient::new();
+        client.execute_query(&config, "CREATE TABLE t (a INTEGER); INSERT INTO t VALUES (1)").await.unwrap();
+        client.execute_query(&config, "SELECT a FROM t").await.unwrap();
+        assert!(client.cache.get(&config, "SELECT a FROM t").is_some());
+
+        let request = BenchRequest { iterations: 1, warmup: 0, setup_sql: None };
+        let control = QueryControl::for_config(&config, Default::default());
+        client.benchmark(&config, "UPDATE t SET a = a + 1", &request, &control).await.unwrap();
+        assert!(client.cache.get(&config, "SELECT a FROM t").is_none());
+
+        client.invalidate(&config.id);
+        let _ = std::fs::remove_file(path);
+    }
+
+    #[test]
+    fn test_distribution() {
+        let d = Distribution::of((1..=100).rev().map(f64::from).collect());
+        assert_eq!((d.p50_ms, d.p95_ms, d.max_ms), (50.0, 95.0, 100.0));
+        assert_eq!(Distribution::of(Vec::new()).max_ms, 0.0);
+    }
+}
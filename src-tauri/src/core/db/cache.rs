@@ -0,0 +1,311 @@
+//! Opt-in cache of read-only query results.
+//!
+//! Connections with a `cache_ttl_secs` keep the complete results of scripts
+//! that `statement::read_only` accepts, keyed by connection ID and
+//! normalized SQL. Entries expire after the TTL and are evicted least
+//! recently used past the cache's capacity or the memory budget. Anything
+//! else run on the connection may have changed the data, so it drops that
+//! connection's entries once it ran: `DbClient::run_query`, which every
+//! query, benchmark and export goes through, and replays of logged
+//! statements do so. Session replays are rolled back and leave them.
+
+use super::sink::{ResultSink, RowBatcher};
+use super::{approx_row_size, statement, CellValue, DbConfig, QueryResult};
+use crate::utils::memory::{Charge, Subsystem};
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+
+/// Default bound on the rows held by the cache as a whole.
+pub const MAX_BYTES: usize = 64 * 1024 * 1024;
+
+type Key = (String, String);
+
+pub(super) struct Entry {
+    /// The result as first returned, rows included.
+    result: QueryResult,
+    bytes: usize,
+    stored_at: Instant,
+}
+
+struct Slot {
+    entry: Arc<Entry>,
+    /// Use counter value; the slot used longest ago is evicted first.
+    last_used: u64,
+}
+
+struct Entries {
+    map: HashMap<Key, Slot>,
+    tick: u64,
+    charge: Charge,
+}
+
+pub struct ResultCache {
+    max_bytes: usize,
+    entries: Mutex<Entries>,
+}
+
+impl Default for ResultCache {
+    fn default() -> Self {
+        Self::with_capacity(MAX_BYTES)
+    }
+}
+
+/// Whether `sql` on `config` may be served from and stored in the cache.
+pub fn cacheable(config: &DbConfig, sql: &str) -> bool {
+    config.cache_ttl_secs > 0 && statement::read_only(sql)
+}
+
+fn key(config: &DbConfig, sql: &str) -> Key {
+    (config.id.clone(), statement::normalize(sql))
+}
+
+impl Entries {
+    fn remove(&mut self, key: &Key) {
+        if let Some(slot) = self.map.remove(key) {
+            self.charge.release(slot.entry.bytes);
+        }
+    }
+
+    fn evict_lru(&mut self) -> bool {
+        let oldest = self.map.iter().min_by_key(|(_, slot)| slot.last_used).map(|(k, _)| k.clone());
+        match oldest {
+            Some(key) => {
+                self.remove(&key);
+                true
+            }
+            None => false,
+        }
+    }
+}
+
+impl ResultCache {
+    pub fn with_capacity(max_bytes: usize) -> Self {
+        Self {
+            max_bytes,
+            entries: Mutex::new(Entries {
+                map: HashMap::new(),
+                tick: 0,
+                charge: Charge::new(Subsystem::Cache),
+            }),
+        }
+    }
+
+    /// Larger results are not cached, so one cannot flush all the others.
+    fn max_entry_bytes(&self) -> usize {
+        self.max_bytes / 4
+    }
+
+    /// A live entry for `sql`, marked as just used.
+    pub(super) fn get(&self, config: &DbConfig, sql: &str) -> Option<Arc<Entry>> {
+        let key = key(config, sql);
+        let ttl = Duration::from_secs(config.cache_ttl_secs);
+        let mut entries = self.entries.lock().unwrap();
+        entries.tick += 1;
+        let tick = entries.tick;
+
+        let slot = entries.map.get_mut(&key)?;
+        if slot.entry.stored_at.elapsed() >= ttl {
+            entries.remove(&key);
+            return None;
+        }
+        slot.last_used = tick;
+        Some(Arc::clone(&slot.entry))
+    }
+
+    /// Keep a complete result of `sql`, evicting as needed.
+    pub(super) fn insert(&self, config: &DbConfig, sql: &str, result: QueryResult) {
+        let bytes: usize = result.rows.iter().map(|r| approx_row_size(r)).sum();
+        if bytes > self.max_entry_bytes() {
+            return;
+        }
+        let key = key(config, sql);
+        let mut entries = self.entries.lock().unwrap();
+        entries.remove(&key);
+        while entries.charge.bytes() + bytes > self.max_bytes || !entries.charge.try_add(bytes) {
+            if !entries.evict_lru() {
+                return;
+            }
+        }
+        entries.tick += 1;
+        let slot = Slot {
+            entry: Arc::new(Entry { result, bytes, stored_at: Instant::now() }),
+            last_used: entries.tick,
+        };
+        entries.map.insert(key, slot);
+    }
+
+    /// Drop the entries of one connection, or all of them.
+    pub fn invalidate(&self, id: Option<&str>) {
+        let mut entries = self.entries.lock().unwrap();
+        let keys: Vec<Key> = entries
+            .map
+            .keys()
+            .filter(|(entry_id, _)| id.map_or(true, |id| entry_id == id))
+            .cloned()
+            .collect();
+        for key in &keys {
+            entries.remove(key);
+        }
+    }
+}
+
+impl Entry {
+    /// Hand the cached rows to `sink` as the executor would have.
+    pub(super) async fn replay(&self, sink: &mut dyn ResultSink) -> anyhow::Result<QueryResult> {
+        let start = Instant::now();
+        let mut batcher = RowBatcher::new(sink, None);
+        let mut rows = self.result.rows.iter();
+        let mut accepted = true;
+        'sets: for set in &self.result.result_sets {
+            if !batcher.columns(&set.columns).await? {
+                accepted = false;
+                break;
+            }
+            for row in rows.by_ref().take(set.row_count as usize) {
+                if !batcher.push(row.clone()).await? {
+                    accepted = false;
+                    break 'sets;
+                }
+            }
+        }
+        accepted &= batcher.flush().await?;
+
+        Ok(QueryResult {
+            columns: self.result.columns.clone(),
+            rows: Vec::new(),
+            affected_rows: self.result.affected_rows,
+            execution_time_ms: start.elapsed().as_millis(),
+            truncated: !accepted,
+            result_sets: self.result.result_sets.clone(),
+            cached_age_ms: Some(self.stored_at.elapsed().as_millis() as u64),
+            spill: None,
+            plan: None,
+            charge: None,
+        })
+    }
+}
+
+/// Passes rows on while keeping a copy for the cache, until the result
+/// outgrows an entry.
+pub(super) struct TeeSink<'a> {
+    inner: &'a mut dyn ResultSink,
+    rows: Vec<Vec<CellValue>>,
+    bytes: usize,
+    max_bytes: usize,
+    overflowed: bool,
+}
+
+impl<'a> TeeSink<'a> {
+    pub fn new(cache: &ResultCache, inner: &'a mut dyn ResultSink) -> Self {
+        Self { inner, rows: Vec::new(), bytes: 0, max_bytes: cache.max_entry_bytes(), overflowed: false }
+    }
+
+    /// The copied rows, unless the result was too large to keep.
+    pub fn into_rows(self) -> Option<Vec<Vec<CellValue>>> {
+        (!self.overflowed).then_some(self.rows)
+    }
+}
+
+#[async_trait::async_trait]
+impl ResultSink for TeeSink<'_> {
+    async fn columns(&mut self, columns: &[String]) -> anyhow::Result<()> {
+        self.inner.columns(columns).await
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        if !self.overflowed {
+            self.bytes += rows.iter().map(|r| approx_row_size(r)).sum::<usize>();
+            if self.bytes > self.max_bytes {
+                self.overflowed = true;
+                self.rows = Vec::new();
+            } else {
+                self.rows.extend(rows.iter().cloned());
+            }
+        }
+        self.inner.rows(rows).await
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::core::db::ResultSet;
+
+    fn result(rows: usize) -> QueryResult {
+        QueryResult {
+            columns: vec!["a".to_string()],
+            rows: (0..rows).map(|i| vec![CellValue::Int(i as i64)]).collect(),
+            affected_rows: 0,
+            execution_time_ms: 5,
+            truncated: false,
+            result_sets: vec![ResultSet { columns: vec!["a".to_string()], row_count: rows as u64 }],
+            cached_age_ms: None,
+            spill: None,
+            plan: None,
+            charge: None,
+        }
+    }
+
+    #[test]
+    fn test_ttl_normalization_and_invalidation() {
+        let cache = ResultCache::default();
+        let config = DbConfig { id: "dev".to_string(), cache_ttl_secs: 60, ..Default::default() };
+        assert!(cacheable(&config, "SELECT * FROM users"));
+        assert!(!cacheable(&config, "DELETE FROM users"));
+        assert!(!cacheable(&DbConfig::default(), "SELECT * FROM users"));
+
+        cache.insert(&config, "SELECT *\n  FROM users;", result(3));
+        let entry = cache.get(&config, "SELECT * FROM users").expect("normalized hit");
+        assert_eq!(entry.result.rows.len(), 3);
+
+        let other = DbConfig { id: "prod".to_string(), ..config.clone() };
+        assert!(cache.get(&other, "SELECT * FROM users").is_none());
+
+        cache.invalidate(Some("dev"));
+        assert!(cache.get(&config, "SELECT * FROM users").is_none());
+
+        // Expired entries are dropped on lookup
+        cache.insert(&config, "SELECT 1", result(1));
+        {
+            let mut entries = cache.entries.lock().unwrap();
+            let slot = entries.map.values_mut().next().unwrap();
+            let stored_at = slot.entry.stored_at - Duration::from_secs(61);
+            slot.entry = Arc::new(Entry { result: result(1), bytes: slot.entry.bytes, stored_at });
+        }
+        assert!(cache.get(&config, "SELECT 1").is_none());
+        assert_eq!(cache.entries.lock().unwrap().charge.bytes(), 0);
+    }
+
+    #[test]
+    fn test_comment_line_break_is_part_of_the_key() {
+        let cache = ResultCache::default();
+        let config = DbConfig { id: "dev".to_string(), cache_ttl_secs: 60, ..Default::default() };
+        cache.insert(&config, "SELECT a --x\nFROM t1", result(2));
+        assert!(cache.get(&config, "SELECT a --x FROM t1").is_none());
+        assert!(cache.get(&config, "SELECT a --x\n  FROM t1").is_some());
+    }
+
+    #[test]
+    fn test_least_recently_used_is_evicted_first() {
+        let row_bytes = approx_row_size(&[CellValue::Int(0)]);
+        let cache = ResultCache::with_capacity(400 * row_bytes);
+        let config = DbConfig { id: "dev".to_string(), cache_ttl_secs: 60, ..Default::default() };
+        // Each entry takes a quarter of the cache
+        let rows = 100;
+        for sql in ["SELECT 1", "SELECT 2", "SELECT 3", "SELECT 4"] {
+            cache.insert(&config, sql, result(rows));
+        }
+        assert!(cache.get(&config, "SELECT 1").is_some());
+        cache.insert(&config, "SELECT 5", result(rows));
+
+        assert!(cache.get(&config, "SELECT 2").is_none());
+        for sql in ["SELECT 1", "SELECT 3", "SELECT 4", "SELECT 5"] {
+            assert!(cache.get(&config, sql).is_some(), "{sql}");
+        }
+        assert!(cache.get(&config, "SELECT 6").is_none());
+        cache.insert(&config, "SELECT 6", result(101));
+        assert!(cache.get(&config, "SELECT 6").is_none(), "larger than an entry may be");
+        assert_eq!(cache.entries.lock().unwrap().charge.bytes(), 400 * row_bytes);
+    }
+}
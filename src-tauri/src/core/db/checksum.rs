@@ -0,0 +1,520 @@
+//! Comparing a table between connections by server-side checksums.
+//!
+//! Each server aggregates its rows into one count and checksum per key
+//! range (`CHECKSUM_AGG` over `BINARY_CHECKSUM` or `HASHBYTES` on SQL
+//! Server, `md5(string_agg(...))` on Postgres), so only a few rows per
+//! range cross the wire. Ranges whose aggregates disagree are split again
+//! until they hold at most `leaf_rows` rows or a single key. The key
+//! column must be an integer; `lo` and `hi` narrow the compared keys. Hashed
+//! columns stand in for NULL with a marker, so a NULL differs from `''` and
+//! from a NULL in the next column. `CHECKSUM_AGG` is an XOR, so a row present
+//! twice on one side cancels out; the counts catch that unless another row
+//! is missing too.
+
+use super::control::QueryControl;
+use super::sink::CollectSink;
+use super::{CellValue, DbClient, DbConfig, DbType};
+use crate::utils::perf;
+use serde::{Deserialize, Serialize};
+use std::collections::{HashMap, VecDeque};
+use std::time::Instant;
+use tokio_util::sync::CancellationToken;
+
+/// Differing ranges reported before the comparison stops.
+const MAX_RANGES: usize = 200;
+
+fn default_segments() -> u32 {
+    16
+}
+
+fn default_leaf_rows() -> u64 {
+    1000
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct ChecksumRequest {
+    pub table: String,
+    /// Integer column the ranges are taken over.
+    pub key_column: String,
+    /// Columns to hash; empty hashes whole rows.
+    #[serde(default)]
+    pub columns: Vec<String>,
+    /// Ranges each differing range is split into.
+    #[serde(default = "default_segments")]
+    pub segments: u32,
+    /// Differing ranges this small are reported rather than split further.
+    #[serde(default = "default_leaf_rows")]
+    pub leaf_rows: u64,
+    /// Lowest key to compare; the table's lowest by default.
+    #[serde(default)]
+    pub lo: Option<i64>,
+    /// Highest key to compare; the table's highest by default.
+    #[serde(default)]
+    pub hi: Option<i64>,
+}
+
+/// Inclusive range of key values.
+#[derive(Debug, Clone, Copy, PartialEq, Serialize)]
+pub struct KeyRange {
+    pub lo: i64,
+    pub hi: i64,
+}
+
+/// A smallest range that still differs.
+#[derive(Debug, Clone, Serialize)]
+pub struct RangeDiff {
+    #[serde(flatten)]
+    pub range: KeyRange,
+    /// Rows in the range per connection, in request order.
+    pub rows: Vec<u64>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct ChecksumReport {
+    pub connection_ids: Vec<String>,
+    /// Rows in the compared key range per connection.
+    pub rows: Vec<u64>,
+    pub identical: bool,
+    pub ranges: Vec<RangeDiff>,
+    /// More ranges differ than are reported.
+    pub truncated: bool,
+    /// Aggregate queries run per connection.
+    pub queries: u64,
+    /// Aggregate rows fetched over all connections; the transfer is about
+    /// this many small rows.
+    pub rows_fetched: u64,
+    pub total_ms: f64,
+}
+
+/// Count and checksum of the rows of one bucket on one connection.
+#[derive(Debug, Clone, PartialEq)]
+struct BucketSum {
+    rows: u64,
+    checksum: String,
+}
+
+/// Identifiers go into the SQL text; refuse anything that could end it.
+fn check_identifier(name: &str) -> anyhow::Result<()> {
+    let valid = !name.is_empty()
+        && name
+            .chars()
+            .all(|c| c.is_alphanumeric() || matches!(c, '_' | '.' | '[' | ']' | '"' | '$' | '#'));
+    if !valid {
+        anyhow::bail!("Not a table or column name: {}", name);
+    }
+    Ok(())
+}
+
+impl ChecksumRequest {
+    fn check(&self) -> anyhow::Result<()> {
+        check_identifier(&self.table)?;
+        check_identifier(&self.key_column)?;
+        for column in &self.columns {
+            check_identifier(column)?;
+        }
+        if self.segments < 2 {
+            anyhow::bail!("Split ranges into at least two segments");
+        }
+        if let (Some(lo), Some(hi)) = (self.lo, self.hi) {
+            if lo > hi {
+                anyhow::bail!("The key range {}..{} is empty", lo, hi);
+            }
+        }
+        Ok(())
+    }
+
+    /// Count and key bounds of the rows within `lo` and `hi`, which clamps
+    /// the compared range to the keys present.
+    fn bounds_sql(&self) -> String {
+        let k = &self.key_column;
+        let conditions: Vec<String> = [
+            self.lo.map(|lo| format!("{k} >= {lo}")),
+            self.hi.map(|hi| format!("{k} <= {hi}")),
+        ]
+        .into_iter()
+        .flatten()
+        .collect();
+        let filter = if conditions.is_empty() {
+            String::new()
+        } else {
+            format!(" WHERE {}", conditions.join(" AND "))
+        };
+        format!("SELECT COUNT(*), MIN({k}), MAX({k}) FROM {t}{filter}", t = self.table)
+    }
+
+    /// Text of each hashed column, NULL as a control character marker.
+    fn column_texts(&self, db_type: &DbType) -> Vec<String> {
+        self.columns
+            .iter()
+            .map(|c| match db_type {
+                DbType::SqlServer => format!("COALESCE(CAST({c} AS nvarchar(max)), NCHAR(1))"),
+                _ => format!("coalesce({c}::text, chr(1))"),
+            })
+            .collect()
+    }
+
+    /// Count and checksum per bucket of `width` keys within `range`.
+    fn buckets_sql(&self, db_type: &DbType, range: KeyRange, width: i64) -> anyhow::Result<String> {
+        let k = &self.key_column;
+        let (lo, hi) = (range.lo, range.hi);
+        let sql = match db_type {
+            DbType::SqlServer => {
+                let row_hash = if self.columns.is_empty() {
+                    "BINARY_CHECKSUM(*)".to_string()
+                } else {
+                    let parts: Vec<String> =
+                        self.column_texts(db_type).iter().map(|c| format!("{}, '|'", c)).collect();
+                    format!("CHECKSUM(HASHBYTES('SHA2_256', CONCAT({}, '')))", parts.join(", "))
+                };
+                format!(
+                    "SELECT (CAST({k} AS BIGINT) - CAST({lo} AS BIGINT)) / CAST({width} AS BIGINT), \
+                     COUNT_BIG(*), CHECKSUM_AGG({row_hash}) FROM {t} \
+                     WHERE {k} BETWEEN {lo} AND {hi} \
+                     GROUP BY (CAST({k} AS BIGINT) - CAST({lo} AS BIGINT)) / CAST({width} AS BIGINT)",
+                    t = self.table
+                )
+            }
+            DbType::Postgres => {
+                let row_text = if self.columns.is_empty() {
+                    "src::text".to_string()
+                } else {
+                    format!("concat_ws('|', {})", self.column_texts(db_type).join(", "))
+                };
+                format!(
+                    "SELECT ({k}::bigint - {lo}) / {width}, count(*), \
+                     md5(string_agg(md5({row_text}), '' ORDER BY {k})) FROM {t} AS src \
+                     WHERE {k} BETWEEN {lo} AND {hi} GROUP BY 1",
+                    t = self.table
+                )
+            }
+            other => anyhow::bail!("Checksum compare is not supported on {}", other),
+        };
+        Ok(sql)
+    }
+}
+
+fn as_int(cell: &CellValue) -> Option<i64> {
+    match cell {
+        CellValue::Int(n) => Some(*n),
+        CellValue::Decimal(s) => s.parse().ok(),
+        _ => None,
+    }
+}
+
+/// Keys per bucket so that `segments` buckets cover `range`.
+fn bucket_width(range: KeyRange, segments: u32) -> i64 {
+    let span = range.hi as i128 - range.lo as i128 + 1;
+    let segments = segments as i128;
+    ((span + segments - 1) / segments).clamp(1, i64::MAX as i128) as i64
+}
+
+fn bucket_range(range: KeyRange, width: i64, bucket: i64) -> KeyRange {
+    let lo = range.lo as i128 + bucket as i128 * width as i128;
+    let hi = (lo + width as i128 - 1).min(range.hi as i128);
+    KeyRange { lo: lo as i64, hi: hi as i64 }
+}
+
+/// Ranges still to compare and the differing ones found so far.
+struct Bisection {
+    segments: u32,
+    leaf_rows: u64,
+    pending: VecDeque<KeyRange>,
+    differing: Vec<RangeDiff>,
+    truncated: bool,
+}
+
+impl Bisection {
+    fn new(range: Option<KeyRange>, segments: u32, leaf_rows: u64) -> Self {
+        Self {
+            segments,
+            leaf_rows,
+            pending: range.into_iter().collect(),
+            differing: Vec::new(),
+            truncated: false,
+        }
+    }
+
+    fn next(&mut self) -> Option<KeyRange> {
+        if self.truncated {
+            return None;
+        }
+        self.pending.pop_front()
+    }
+
+    /// Compare the buckets of `range` across connections, queueing the
+    /// differing ones for another split or reporting them.
+    fn record(&mut self, range: KeyRange, sides: &[HashMap<i64, BucketSum>]) {
+        let width = bucket_width(range, self.segments);
+        let mut buckets: Vec<i64> = sides.iter().flat_map(|side| side.keys().copied()).collect();
+        buckets.sort_unstable();
+        buckets.dedup();
+
+        for bucket in buckets {
+            let sums: Vec<Option<&BucketSum>> = sides.iter().map(|side| side.get(&bucket)).collect();
+            if sums.windows(2).all(|pair| pair[0] == pair[1]) {
+                continue;
+            }
+            let sub = bucket_range(range, width, bucket);
+            let rows: Vec<u64> = sums.iter().map(|sum| sum.map_or(0, |s| s.rows)).collect();
+            if sub.lo == sub.hi || rows.iter().all(|&n| n <= self.leaf_rows) {
+                if self.differing.len() == MAX_RANGES {
+                    self.truncated = true;
+                    return;
+                }
+                self.differing.push(RangeDiff { range: sub, rows });
+            } else {
+                self.pending.push_back(sub);
+            }
+        }
+    }
+}
+
+impl DbClient {
+    /// Rows of an aggregate query, bypassing the result cache: a stale
+    /// checksum would hide exactly the differences being looked for.
+    async fn aggregate_rows(
+        &self,
+        config: &DbConfig,
+        sql: &str,
+        cancel: &CancellationToken,
+    ) -> anyhow::Result<Vec<Vec<CellValue>>> {
+        let mut sink = CollectSink::new();
+        let control = QueryControl::for_config(config, cancel.clone());
+        let result = self.run_query(config, sql, &mut sink, &control).await?;
+        if result.truncated {
+            anyhow::bail!("Checksum rows were truncated on {}; raise its row cap", config.name);
+        }
+        Ok(sink.into_result(result).rows)
+    }
+
+    /// Run one aggregate query on every connection at once.
+    async fn aggregate_all(
+        &self,
+        configs: &[DbConfig],
+        sql: impl Fn(&DbConfig) -> anyhow::Result<String>,
+        cancel: &CancellationToken,
+    ) -> anyhow::Result<Vec<Vec<Vec<CellValue>>>> {
+        let sqls = configs.iter().map(&sql).collect::<anyhow::Result<Vec<_>>>()?;
+        let runs = configs.iter().zip(&sqls).map(|(config, sql)| self.aggregate_rows(config, sql, cancel));
+        let results = futures_util::future::join_all(runs).await;
+        results
+            .into_iter()
+            .zip(configs)
+            .map(|(rows, config)| rows.map_err(|e| anyhow::anyhow!("{}: {}", config.name, e)))
+            .collect()
+    }
+
+    /// Compare `request.table` between `configs` by checksums over key
+    /// ranges, bisecting only the ranges that differ.
+    pub async fn compare_checksums(
+        &self,
+        configs: &[DbConfig],
+        request: &ChecksumRequest,
+        cancel: CancellationToken,
+    ) -> anyhow::Result<ChecksumReport> {
+        if configs.len() < 2 {
+            anyhow::bail!("Choose at least two connections to compare");
+        }
+        if configs.iter().any(|c| c.db_type != configs[0].db_type) {
+            anyhow::bail!("Checksums are only comparable between connections of the same database type");
+        }
+        request.check()?;
+        let start = Instant::now();
+
+        let bounds = {
+            let _span = perf::span("checksum_bounds");
+            self.aggregate_all(configs, |_| Ok(request.bounds_sql()), &cancel).await?
+        };
+        let mut rows = Vec::with_capacity(configs.len());
+        let mut range: Option<KeyRange> = None;
+        for side in &bounds {
+            let row = side.first().map(Vec::as_slice).unwrap_or_default();
+            rows.push(row.first().and_then(as_int).unwrap_or(0) as u64);
+            match row {
+                [_, CellValue::Null, CellValue::Null] => {}
+                [_, lo, hi] => {
+                    let (Some(lo), Some(hi)) = (as_int(lo), as_int(hi)) else {
+                        anyhow::bail!("Key column {} is not an integer", request.key_column);
+                    };
+                    range = Some(match range {
+                        Some(r) => KeyRange { lo: r.lo.min(lo), hi: r.hi.max(hi) },
+                        None => KeyRange { lo, hi },
+                    });
+                }
+                _ => anyhow::bail!("Unexpected bounds row for {}", request.table),
+            }
+        }
+
+        let mut bisection = Bisection::new(range, request.segments, request.leaf_rows);
+        let mut queries = 1;
+        let mut rows_fetched = configs.len() as u64;
+        while let Some(range) = bisection.next() {
+            let width = bucket_width(range, request.segments);
+            let sides = {
+                let _span = perf::span("checksum_buckets");
+                self.aggregate_all(configs, |c| request.buckets_sql(&c.db_type, range, width), &cancel)
+                    .await?
+            };
+            queries += 1;
+            rows_fetched += sides.iter().map(|rows| rows.len() as u64).sum::<u64>();
+
+            let sides: Vec<HashMap<i64, BucketSum>> = sides
+                .into_iter()
+                .map(|rows| {
+                    rows.into_iter()
+                        .filter_map(|row| match row.as_slice() {
+                            [bucket, count, checksum] => Some((
+                                as_int(bucket)?,
+                                BucketSum { rows: as_int(count)? as u64, checksum: checksum.to_string() },
+                            )),
+                            _ => None,
+                        })
+                        .collect()
+                })
+                .collect();
+            bisection.record(range, &sides);
+        }
+
+        Ok(ChecksumReport {
+            connection_ids: configs.iter().map(|c| c.id.clone()).collect(),
+            identical: bisection.differing.is_empty(),
+            rows,
+            ranges: bisection.differing,
+            truncated: bisection.truncated,
+            queries,
+            rows_fetched,
+            total_ms: start.elapsed().as_secs_f64() * 1000.0,
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::collections::BTreeMap;
+
+    /// What the servers would return for `range` over tables of key -> row.
+    fn buckets(table: &BTreeMap<i64, u64>, range: KeyRange, width: i64) -> HashMap<i64, BucketSum> {
+        let mut sums: HashMap<i64, (u64, u64)> = HashMap::new();
+        for (&key, &row) in table.range(range.lo..=range.hi) {
+            let sum = sums.entry((key - range.lo) / width).or_default();
+            sum.0 += 1;
+            sum.1 ^= row.wrapping_mul(0x9E37_79B9_7F4A_7C15) ^ key as u64;
+        }
+        sums.into_iter()
+            .map(|(bucket, (rows, checksum))| (bucket, BucketSum { rows, checksum: checksum.to_string() }))
+            .collect()
+    }
+
+    fn compare(tables: &[BTreeMap<i64, u64>], leaf_rows: u64) -> (Bisection, usize) {
+        let lo = tables.iter().filter_map(|t| t.keys().next()).min().copied();
+        let hi = tables.iter().filter_map(|t| t.keys().next_back()).max().copied();
+        let range = lo.zip(hi).map(|(lo, hi)| KeyRange { lo, hi });
+        let mut bisection = Bisection::new(range, 16, leaf_rows);
+        let mut queries = 0;
+        while let Some(range) = bisection.next() {
+            let width = bucket_width(range, 16);
+            let sides: Vec<_> = tables.iter().map(|t| buckets(t, range, width)).collect();
+            bisection.record(range, &sides);
+            queries += 1;
+        }
+        (bisection, queries)
+    }
+
+    #[test]
+    fn test_bisection_narrows_to_differing_keys() {
+        let base: BTreeMap<i64, u64> = (1..=1_000_000).map(|k| (k, k as u64 * 7)).collect();
+        let mut other = base.clone();
+        other.insert(123_456, 0);
+        other.remove(&900_001);
+
+        let (bisection, queries) = compare(&[base.clone(), other], 1);
+        let found: Vec<KeyRange> = bisection.differing.iter().map(|d| d.range).collect();
+        assert_eq!(found, vec![KeyRange { lo: 123_456, hi: 123_456 }, KeyRange { lo: 900_001, hi: 900_001 }]);
+        assert_eq!(bisection.differing[1].rows, vec![1, 0]);
+        assert!(queries <= 12, "{queries} queries");
+
+        let (bisection, queries) = compare(&[base.clone(), base], 1);
+        assert!(bisection.differing.is_empty());
+        assert_eq!(queries, 1);
+    }
+
+    #[test]
+    fn test_small_ranges_are_reported_not_split() {
+        let base: BTreeMap<i64, u64> = (0..10_000).map(|k| (k * 3, 1)).collect();
+        let mut other = base.clone();
+        other.insert(4_501, 1);
+        let (bisection, _) = compare(&[base, other], 500);
+        assert_eq!(bisection.differing.len(), 1);
+        let diff = &bisection.differing[0];
+        assert!(diff.range.lo <= 4_501 && 4_501 <= diff.range.hi);
+        assert!(diff.rows[0] <= 500 && diff.rows[1] == diff.rows[0] + 1);
+    }
+
+    #[test]
+    fn test_bucket_ranges_cover_extreme_keys() {
+        let range = KeyRange { lo: i64::MIN, hi: i64::MAX };
+        let width = bucket_width(range, 16);
+        assert_eq!(bucket_range(range, width, 0).lo, i64::MIN);
+        assert_eq!(bucket_range(range, width, 15).hi, i64::MAX);
+        assert_eq!(bucket_width(KeyRange { lo: 5, hi: 7 }, 16), 1);
+    }
+
+    #[test]
+    fn test_requests_are_checked_and_rendered() {
+        let request = ChecksumRequest {
+            table: "dbo.orders".to_string(),
+            key_column: "id".to_string(),
+            columns: vec!["total".to_string(), "status".to_string()],
+            segments: 16,
+            leaf_rows: 1000,
+            lo: None,
+            hi: None,
+        };
+        assert!(request.check().is_ok());
+        let range = KeyRange { lo: 1, hi: 160 };
+        let sql = request.buckets_sql(&DbType::SqlServer, range, 10).unwrap();
+        assert!(sql.contains("CHECKSUM_AGG(CHECKSUM(HASHBYTES('SHA2_256', CONCAT(COALESCE(CAST(total AS nvarchar(max)), NCHAR(1)), '|', COALESCE(CAST(status AS nvarchar(max)), NCHAR(1)), '|', ''))))"));
+        assert!(sql.contains("WHERE id BETWEEN 1 AND 160"));
+        let sql = request.buckets_sql(&DbType::Postgres, range, 10).unwrap();
+        assert!(sql.contains("md5(string_agg(md5(concat_ws('|', coalesce(total::text, chr(1)), coalesce(status::text, chr(1)))), '' ORDER BY id))"));
+        assert!(request.buckets_sql(&DbType::Sqlite, range, 10).is_err());
+        assert_eq!(request.bounds_sql(), "SELECT COUNT(*), MIN(id), MAX(id) FROM dbo.orders");
+
+        let ranged = ChecksumRequest { lo: Some(100), hi: Some(200), ..request.clone() };
+        assert_eq!(ranged.bounds_sql(), "SELECT COUNT(*), MIN(id), MAX(id) FROM dbo.orders WHERE id >= 100 AND id <= 200");
+        let above = ChecksumRequest { lo: Some(-5), ..request.clone() };
+        assert!(above.bounds_sql().ends_with(" WHERE id >= -5"));
+        assert!(ChecksumRequest { lo: Some(9), hi: Some(1), ..request.clone() }.check().is_err());
+
+        let bad = ChecksumRequest { table: "orders; DROP TABLE x".to_string(), ..request };
+        assert!(bad.check().is_err());
+    }
+
+    /// Row text as the column expressions build it on the server: each value
+    /// or the NULL marker, each followed by the separator.
+    fn row_text(values: &[Option<&str>]) -> String {
+        values.iter().map(|v| format!("{}|", v.unwrap_or("\u{1}"))).collect()
+    }
+
+    #[test]
+    fn test_null_markers_keep_rows_apart() {
+        assert_ne!(row_text(&[None, Some("x")]), row_text(&[Some("x"), None]), "shifted NULL");
+        assert_ne!(row_text(&[None, Some("x")]), row_text(&[Some(""), Some("x")]), "NULL vs ''");
+        let request = ChecksumRequest {
+            table: "t".to_string(),
+            key_column: "id".to_string(),
+            columns: vec!["a".to_string(), "b".to_string()],
+            segments: 16,
+            leaf_rows: 1000,
+            lo: None,
+            hi: None,
+        };
+        // Every hashed column carries the marker on both servers
+        for db_type in [DbType::SqlServer, DbType::Postgres] {
+            let texts = request.column_texts(&db_type);
+            assert_eq!(texts.len(), 2);
+            assert!(texts.iter().all(|t| t.contains("NCHAR(1)") || t.contains("chr(1)")), "{texts:?}");
+        }
+    }
+}
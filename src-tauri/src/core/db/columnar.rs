@@ -0,0 +1,308 @@
+//! Compact columnar encoding of row batches for the webview.
+//!
+//! JSON spends an object per cell (`{"Text":"..."}`) and the webview another
+//! per row. A frame instead stores each column as one typed array, repeated
+//! strings once per batch, and NULLs as a bitmap; `src/utils/columnar.ts`
+//! reads it in place. Spill files store the same frames.
+//!
+//! Layout, little-endian, every section padded to 8 bytes so numeric arrays
+//! can be viewed without copying:
+//!
+//! ```text
+//! frame  := u32 row_count, u32 column_count, column*
+//! column := u32 kind, u32 0, null bitmap (bit i set = row i is NULL), values
+//! values := INT32: i32 * rows | INT64: i64 * rows | FLOAT64: f64 * rows
+//!         | BOOL: u8 * rows   | NULL: nothing
+//!         | TEXT: u32 entries, u32 byte_len, u32 offsets * (entries + 1),
+//!                 UTF-8 bytes, u32 entry index * rows
+//! ```
+
+use super::CellValue;
+use std::collections::HashMap;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u32)]
+enum Kind {
+    Null = 0,
+    Int32 = 1,
+    Int64 = 2,
+    Float64 = 3,
+    Bool = 4,
+    Text = 5,
+}
+
+impl Kind {
+    fn from_u32(v: u32) -> Option<Kind> {
+        [Kind::Null, Kind::Int32, Kind::Int64, Kind::Float64, Kind::Bool, Kind::Text]
+            .into_iter()
+            .find(|k| *k as u32 == v)
+    }
+
+    fn of(cell: &CellValue) -> Option<Kind> {
+        Some(match cell {
+            CellValue::Null => return None,
+            CellValue::Int(n) if i32::try_from(*n).is_ok() => Kind::Int32,
+            CellValue::Int(_) => Kind::Int64,
+            CellValue::Float(_) => Kind::Float64,
+            CellValue::Bool(_) => Kind::Bool,
+            _ => Kind::Text,
+        })
+    }
+
+    /// Narrowest kind that holds both; anything mixed falls back to text.
+    fn merge(self, other: Kind) -> Kind {
+        match (self, other) {
+            (a, b) if a == b => a,
+            (Kind::Null, k) | (k, Kind::Null) => k,
+            (Kind::Int32, Kind::Int64) | (Kind::Int64, Kind::Int32) => Kind::Int64,
+            _ => Kind::Text,
+        }
+    }
+}
+
+fn pad(buf: &mut Vec<u8>) {
+    while buf.len() % 8 != 0 {
+        buf.push(0);
+    }
+}
+
+fn put_u32(buf: &mut Vec<u8>, v: u32) {
+    buf.extend_from_slice(&v.to_le_bytes());
+}
+
+/// Encode `rows` (each `column_count` cells long) as one frame.
+pub fn encode_batch(rows: &[Vec<CellValue>], column_count: usize) -> Vec<u8> {
+    let mut buf = Vec::with_capacity(16 + rows.len() * column_count * 4);
+    put_u32(&mut buf, rows.len() as u32);
+    put_u32(&mut buf, column_count as u32);
+
+    for col in 0..column_count {
+        let cells = rows.iter().map(|r| r.get(col).unwrap_or(&CellValue::Null));
+        let kind = cells
+            .clone()
+            .filter_map(Kind::of)
+            .fold(Kind::Null, Kind::merge);
+
+        put_u32(&mut buf, kind as u32);
+        put_u32(&mut buf, 0);
+
+        let mut nulls = vec![0u8; (rows.len() + 7) / 8];
+        for (i, cell) in cells.clone().enumerate() {
+            if matches!(cell, CellValue::Null) {
+                nulls[i / 8] |= 1 << (i % 8);
+            }
+        }
+        buf.extend_from_slice(&nulls);
+        pad(&mut buf);
+
+        match kind {
+            Kind::Null => {}
+            Kind::Int32 | Kind::Int64 | Kind::Float64 | Kind::Bool => {
+                for cell in cells {
+                    match (kind, cell) {
+                        (Kind::Int32, CellValue::Int(n)) => buf.extend_from_slice(&(*n as i32).to_le_bytes()),
+                        (Kind::Int32, _) => buf.extend_from_slice(&0i32.to_le_bytes()),
+                        (Kind::Int64, CellValue::Int(n)) => buf.extend_from_slice(&n.to_le_bytes()),
+                        (Kind::Int64, _) => buf.extend_from_slice(&0i64.to_le_bytes()),
+                        (Kind::Float64, CellValue::Float(f)) => buf.extend_from_slice(&f.to_le_bytes()),
+                        (Kind::Float64, _) => buf.extend_from_slice(&0f64.to_le_bytes()),
+                        (_, CellValue::Bool(b)) => buf.push(*b as u8),
+                        _ => buf.push(0),
+                    }
+                }
+                pad(&mut buf);
+            }
+            Kind::Text => encode_text(&mut buf, cells),
+        }
+    }
+    buf
+}
+
+fn encode_text<'a>(buf: &mut Vec<u8>, cells: impl Iterator<Item = &'a CellValue>) {
+    let mut entries: Vec<String> = Vec::new();
+    let mut index: HashMap<String, u32> = HashMap::new();
+    let indices: Vec<u32> = cells
+        .map(|cell| match cell {
+            CellValue::Null => 0,
+            cell => {
+                let text = match cell {
+                    CellValue::Text(s)
+                    | CellValue::DateTime(s)
+                    | CellValue::Binary(s)
+                    | CellValue::Decimal(s) => s.clone(),
+                    other => other.to_string(),
+                };
+                *index.entry(text).or_insert_with_key(|text| {
+                    entries.push(text.clone());
+                    (entries.len() - 1) as u32
+                })
+            }
+        })
+        .collect();
+
+    let byte_len: usize = entries.iter().map(String::len).sum();
+    put_u32(buf, entries.len() as u32);
+    put_u32(buf, byte_len as u32);
+    let mut offset = 0u32;
+    put_u32(buf, offset);
+    for entry in &entries {
+        offset += entry.len() as u32;
+        put_u32(buf, offset);
+    }
+    pad(buf);
+    for entry in &entries {
+        buf.extend_from_slice(entry.as_bytes());
+    }
+    pad(buf);
+    for i in indices {
+        put_u32(buf, i);
+    }
+    pad(buf);
+}
+
+/// Reads a frame front to back.
+struct Reader<'a> {
+    buf: &'a [u8],
+    at: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, len: usize) -> anyhow::Result<&'a [u8]> {
+        let bytes = self
+            .buf
+            .get(self.at..self.at + len)
+            .ok_or_else(|| anyhow::anyhow!("Truncated result frame"))?;
+        self.at += len;
+        Ok(bytes)
+    }
+
+    fn u32(&mut self) -> anyhow::Result<u32> {
+        Ok(u32::from_le_bytes(self.take(4)?.try_into()?))
+    }
+
+    fn align(&mut self) {
+        self.at = (self.at + 7) & !7;
+    }
+}
+
+/// Rows of a frame written by `encode_batch`. Text-like values (dates,
+/// decimals, binary) come back as `Text`.
+pub fn decode_batch(frame: &[u8]) -> anyhow::Result<Vec<Vec<CellValue>>> {
+    let mut r = Reader { buf: frame, at: 0 };
+    let row_count = r.u32()? as usize;
+    let column_count = r.u32()? as usize;
+    let mut rows = vec![Vec::with_capacity(column_count); row_count];
+
+    for _ in 0..column_count {
+        let kind = r.u32()?;
+        let kind = Kind::from_u32(kind).ok_or_else(|| anyhow::anyhow!("Unknown column kind {} in result frame", kind))?;
+        r.u32()?;
+        let nulls = r.take((row_count + 7) / 8)?;
+        r.align();
+        let is_null = |i: usize| nulls[i / 8] >> (i % 8) & 1 == 1;
+
+        let values: Vec<CellValue> = match kind {
+            Kind::Null => vec![CellValue::Null; row_count],
+            Kind::Int32 => (0..row_count)
+                .map(|_| Ok(CellValue::Int(i32::from_le_bytes(r.take(4)?.try_into()?) as i64)))
+                .collect::<anyhow::Result<_>>()?,
+            Kind::Int64 => (0..row_count)
+                .map(|_| Ok(CellValue::Int(i64::from_le_bytes(r.take(8)?.try_into()?))))
+                .collect::<anyhow::Result<_>>()?,
+            Kind::Float64 => (0..row_count)
+                .map(|_| Ok(CellValue::Float(f64::from_le_bytes(r.take(8)?.try_into()?))))
+                .collect::<anyhow::Result<_>>()?,
+            Kind::Bool => r.take(row_count)?.iter().map(|b| CellValue::Bool(*b != 0)).collect(),
+            Kind::Text => {
+                let entries = r.u32()? as usize;
+                let byte_len = r.u32()? as usize;
+                let offsets = (0..=entries).map(|_| r.u32()).collect::<anyhow::Result<Vec<_>>>()?;
+                r.align();
+                let bytes = r.take(byte_len)?;
+                r.align();
+                let strings = offsets
+                    .windows(2)
+                    .map(|w| {
+                        let text = bytes
+                            .get(w[0] as usize..w[1] as usize)
+                            .ok_or_else(|| anyhow::anyhow!("Truncated result frame"))?;
+                        Ok(std::str::from_utf8(text)?.to_string())
+                    })
+                    .collect::<anyhow::Result<Vec<_>>>()?;
+                (0..row_count)
+                    .map(|_| {
+                        let i = r.u32()? as usize;
+                        Ok(CellValue::Text(strings.get(i).cloned().unwrap_or_default()))
+                    })
+                    .collect::<anyhow::Result<_>>()?
+            }
+        };
+        r.align();
+
+        for (i, (row, value)) in rows.iter_mut().zip(values).enumerate() {
+            row.push(if is_null(i) { CellValue::Null } else { value });
+        }
+    }
+    Ok(rows)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn u32_at(buf: &[u8], at: usize) -> u32 {
+        u32::from_le_bytes(buf[at..at + 4].try_into().unwrap())
+    }
+
+    #[test]
+    fn test_encode_batch_layout() {
+        let rows = vec![
+            vec![CellValue::Int(7), CellValue::Text("a".into())],
+            vec![CellValue::Null, CellValue::Text("a".into())],
+            vec![CellValue::Int(1 << 40), CellValue::Decimal("1.50".into())],
+        ];
+        let buf = encode_batch(&rows, 2);
+        assert_eq!(buf.len() % 8, 0);
+        assert_eq!((u32_at(&buf, 0), u32_at(&buf, 4)), (3, 2));
+
+        // Column 0: INT64 (one value needs 64 bits), row 1 NULL
+        assert_eq!(u32_at(&buf, 8), Kind::Int64 as u32);
+        assert_eq!(buf[16], 0b010);
+        let values = 24;
+        assert_eq!(i64::from_le_bytes(buf[values..values + 8].try_into().unwrap()), 7);
+
+        // Column 1: TEXT with "a" stored once
+        let col1 = values + 3 * 8;
+        assert_eq!(u32_at(&buf, col1), Kind::Text as u32);
+        let dict = col1 + 16;
+        assert_eq!(u32_at(&buf, dict), 2);
+        assert_eq!(u32_at(&buf, dict + 4), 5);
+    }
+
+    #[test]
+    fn test_decode_batch_round_trip() {
+        let rows = vec![
+            vec![CellValue::Int(7), CellValue::Text("a".into()), CellValue::Bool(true), CellValue::Float(0.5)],
+            vec![CellValue::Null, CellValue::Text("a".into()), CellValue::Null, CellValue::Float(-2.0)],
+            vec![CellValue::Int(1 << 40), CellValue::Decimal("1.50".into()), CellValue::Bool(false), CellValue::Null],
+        ];
+        let decoded = decode_batch(&encode_batch(&rows, 4)).unwrap();
+        let text = |rows: &[Vec<CellValue>]| -> Vec<Vec<String>> {
+            rows.iter().map(|r| r.iter().map(|c| format!("{:?}", c)).collect()).collect()
+        };
+        let mut expected = rows.clone();
+        expected[2][1] = CellValue::Text("1.50".into());
+        assert_eq!(text(&decoded), text(&expected));
+
+        let nulls = decode_batch(&encode_batch(&[vec![CellValue::Null], vec![CellValue::Null]], 1)).unwrap();
+        assert!(matches!(nulls[1][0], CellValue::Null));
+        assert!(decode_batch(&encode_batch(&rows, 4)[..40]).is_err());
+    }
+
+    #[test]
+    fn test_kind_merge() {
+        assert_eq!(Kind::Null.merge(Kind::Int32), Kind::Int32);
+        assert_eq!(Kind::Int32.merge(Kind::Int64), Kind::Int64);
+        assert_eq!(Kind::Int32.merge(Kind::Float64), Kind::Text);
+    }
+}
@@ -0,0 +1,106 @@
+//! Cancellation, timeout, row cap and plan capture of one running statement.
+//!
+//! Neither driver can interrupt a statement in place (tiberius has no
+//! attention API and sqlx's `Any` driver no cancel request), so an
+//! interrupted statement loses its connection: closing the socket makes the
+//! server abort the request instead of streaming the rest of it to nobody.
+
+use super::DbConfig;
+use std::time::Duration;
+use tokio_util::sync::CancellationToken;
+
+#[derive(Clone, Default)]
+pub struct QueryControl {
+    cancel: CancellationToken,
+    timeout: Option<Duration>,
+    max_rows: Option<u64>,
+    capture_plan: bool,
+}
+
+impl QueryControl {
+    /// Limits from `config`, cancellable through `cancel`.
+    pub fn for_config(config: &DbConfig, cancel: CancellationToken) -> Self {
+        Self {
+            cancel,
+            timeout: (config.statement_timeout_secs > 0)
+                .then(|| Duration::from_secs(config.statement_timeout_secs)),
+            max_rows: (config.max_rows > 0).then_some(config.max_rows),
+            capture_plan: false,
+        }
+    }
+
+    /// Also capture the actual plan and runtime statistics (see `plan`).
+    pub fn with_plan_capture(mut self, capture: bool) -> Self {
+        self.capture_plan = capture;
+        self
+    }
+
+    /// Read every row, e.g. for an export to a file.
+    pub fn without_row_cap(mut self) -> Self {
+        self.max_rows = None;
+        self
+    }
+
+    /// Run as long as it takes, e.g. an export of a large table; only
+    /// cancellation stops it.
+    pub fn without_timeout(mut self) -> Self {
+        self.timeout = None;
+        self
+    }
+
+    pub fn max_rows(&self) -> Option<u64> {
+        self.max_rows
+    }
+
+    pub fn capture_plan(&self) -> bool {
+        self.capture_plan
+    }
+
+    pub fn is_cancelled(&self) -> bool {
+        self.cancel.is_cancelled()
+    }
+
+    /// Resolves on cancellation only, ignoring the timeout.
+    pub async fn cancelled(&self) {
+        self.cancel.cancelled().await
+    }
+
+    /// Resolves once the statement has to stop, with the reason. The timeout
+    /// counts from the first poll.
+    pub async fn interrupted(&self) -> anyhow::Error {
+        match self.timeout {
+            Some(timeout) => tokio::select! {
+                _ = self.cancel.cancelled() => anyhow::anyhow!("Query cancelled"),
+                _ = tokio::time::sleep(timeout) => {
+                    anyhow::anyhow!("Query timed out after {} s", timeout.as_secs())
+                }
+            },
+            None => {
+                self.cancel.cancelled().await;
+                anyhow::anyhow!("Query cancelled")
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[tokio::test]
+    async fn test_limits_from_config_and_cancel() {
+        let config = DbConfig { statement_timeout_secs: 30, max_rows: 10, ..Default::default() };
+        let control = QueryControl::for_config(&config, CancellationToken::new());
+        assert_eq!(control.timeout, Some(Duration::from_secs(30)));
+        assert_eq!(control.max_rows(), Some(10));
+        let control = control.without_row_cap().without_timeout();
+        assert_eq!((control.timeout, control.max_rows()), (None, None));
+
+        let cancel = CancellationToken::new();
+        let control = QueryControl::for_config(&DbConfig::default(), cancel.clone());
+        assert_eq!(control.timeout, None);
+        assert_eq!(control.max_rows(), None);
+        cancel.cancel();
+        assert_eq!(control.interrupted().await.to_string(), "Query cancelled");
+    }
+}
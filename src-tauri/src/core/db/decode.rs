@@ -0,0 +1,224 @@
+//! Turning result cells into `CellValue`s.
+//!
+//! Executors pick one decoder per column from the result set's metadata, so a
+//! row decodes in a single pass instead of probing each cell with a cascade of
+//! `try_get` calls. A custom encoding is resolved once per result set.
+
+use super::CellValue;
+use crate::utils::encoding::resolve_encoding;
+use encoding_rs::Encoding;
+use std::fmt::Write;
+
+fn decode_text(bytes: &[u8], encoding: &'static Encoding) -> String {
+    let (decoded, _, _) = encoding.decode(bytes);
+    decoded.into_owned()
+}
+
+/// `0x`-prefixed upper-case hex, as SQL Server tools show binary values.
+fn hex(bytes: &[u8]) -> String {
+    let mut out = String::with_capacity(2 + bytes.len() * 2);
+    out.push_str("0x");
+    for b in bytes {
+        let _ = write!(out, "{:02X}", b);
+    }
+    out
+}
+
+// ─── SQL Server ─────────────────────────────────────────────────────────────
+
+#[derive(Debug, Clone, Copy)]
+pub(super) enum MssqlDecoder {
+    /// tiberius hands out money as a float; show it with its fixed scale.
+    Money,
+    /// Binary data read as text in the connection's encoding.
+    EncodedBinary(&'static Encoding),
+    /// Follow the type of the received value.
+    Native,
+}
+
+impl MssqlDecoder {
+    pub fn for_columns(columns: &[tiberius::Column], encoding: Option<&str>) -> Vec<Self> {
+        use tiberius::ColumnType;
+
+        let encoding = encoding.map(resolve_encoding);
+        columns
+            .iter()
+            .map(|c| match (c.column_type(), encoding) {
+                (ColumnType::Money | ColumnType::Money4, _) => MssqlDecoder::Money,
+                (ColumnType::BigVarBin | ColumnType::BigBinary | ColumnType::Image, Some(enc)) => {
+                    MssqlDecoder::EncodedBinary(enc)
+                }
+                _ => MssqlDecoder::Native,
+            })
+            .collect()
+    }
+
+    pub fn decode(self, data: tiberius::ColumnData<'static>) -> CellValue {
+        use tiberius::ColumnData as D;
+
+        match (self, data) {
+            (MssqlDecoder::Money, D::F64(Some(v))) => CellValue::Decimal(format!("{:.4}", v)),
+            (MssqlDecoder::Money, D::F32(Some(v))) => CellValue::Decimal(format!("{:.4}", v)),
+            (MssqlDecoder::EncodedBinary(enc), D::Binary(Some(b))) => {
+                CellValue::Text(decode_text(&b, enc))
+            }
+            (_, data) => mssql_native(data),
+        }
+    }
+}
+
+fn mssql_native(data: tiberius::ColumnData<'static>) -> CellValue {
+    use tiberius::time::chrono::{DateTime, FixedOffset, NaiveDate, NaiveDateTime, NaiveTime};
+    use tiberius::ColumnData as D;
+
+    match data {
+        D::U8(Some(n)) => CellValue::Int(n.into()),
+        D::I16(Some(n)) => CellValue::Int(n.into()),
+        D::I32(Some(n)) => CellValue::Int(n.into()),
+        D::I64(Some(n)) => CellValue::Int(n),
+        D::F32(Some(f)) => CellValue::Float(f.into()),
+        D::F64(Some(f)) => CellValue::Float(f),
+        D::Bit(Some(b)) => CellValue::Bool(b),
+        D::String(Some(s)) => CellValue::Text(s.into_owned()),
+        D::Guid(Some(u)) => CellValue::Text(u.to_string()),
+        D::Binary(Some(b)) => CellValue::Binary(hex(&b)),
+        D::Numeric(Some(n)) => CellValue::Decimal(n.to_string()),
+        D::Xml(Some(x)) => CellValue::Text(x.into_owned().into_string()),
+        D::DateTime(Some(_)) | D::SmallDateTime(Some(_)) | D::DateTime2(Some(_)) => {
+            temporal::<NaiveDateTime>(&data)
+        }
+        D::Date(Some(_)) => temporal::<NaiveDate>(&data),
+        D::Time(Some(_)) => temporal::<NaiveTime>(&data),
+        D::DateTimeOffset(Some(_)) => temporal::<DateTime<FixedOffset>>(&data),
+        // Every remaining variant is a NULL of its type
+        _ => CellValue::Null,
+    }
+}
+
+fn temporal<'a, T>(data: &'a tiberius::ColumnData<'static>) -> CellValue
+where
+    T: tiberius::FromSql<'a> + std::fmt::Display,
+{
+    match T::from_sql(data) {
+        Ok(Some(v)) => CellValue::DateTime(v.to_string()),
+        Ok(None) => CellValue::Null,
+        Err(e) => CellValue::Text(format!("ERR: {}", e)),
+    }
+}
+
+// ─── sqlx ───────────────────────────────────────────────────────────────────
+
+#[derive(Debug, Clone, Copy)]
+pub(super) enum SqlxDecoder {
+    Bool,
+    SmallInt,
+    Integer,
+    BigInt,
+    Real,
+    Double,
+    Text,
+    Blob,
+    /// Blob read as text in the connection's encoding.
+    EncodedBlob(&'static Encoding),
+    /// No declared type (e.g. SQLite expressions); follow each value.
+    Dynamic(Option<&'static Encoding>),
+}
+
+impl SqlxDecoder {
+    pub fn for_columns(columns: &[sqlx::any::AnyColumn], encoding: Option<&str>) -> Vec<Self> {
+        use sqlx::Column;
+
+        let encoding = encoding.map(resolve_encoding);
+        columns
+            .iter()
+            .map(|c| Self::for_kind(c.type_info().kind(), encoding).unwrap_or(SqlxDecoder::Dynamic(encoding)))
+            .collect()
+    }
+
+    fn for_kind(kind: sqlx::any::AnyTypeInfoKind, encoding: Option<&'static Encoding>) -> Option<Self> {
+        use sqlx::any::AnyTypeInfoKind as K;
+
+        Some(match kind {
+            K::Null => return None,
+            K::Bool => SqlxDecoder::Bool,
+            K::SmallInt => SqlxDecoder::SmallInt,
+            K::Integer => SqlxDecoder::Integer,
+            K::BigInt => SqlxDecoder::BigInt,
+            K::Real => SqlxDecoder::Real,
+            K::Double => SqlxDecoder::Double,
+            K::Text => SqlxDecoder::Text,
+            K::Blob => match encoding {
+                Some(enc) => SqlxDecoder::EncodedBlob(enc),
+                None => SqlxDecoder::Blob,
+            },
+        })
+    }
+
+    pub fn decode(self, row: &sqlx::any::AnyRow, i: usize) -> CellValue {
+        use sqlx::{Row, TypeInfo, ValueRef};
+
+        let cell = match self {
+            SqlxDecoder::Bool => row.try_get::<Option<bool>, _>(i).map(|v| v.map(CellValue::Bool)),
+            SqlxDecoder::SmallInt => {
+                row.try_get::<Option<i16>, _>(i).map(|v| v.map(|n| CellValue::Int(n.into())))
+            }
+            SqlxDecoder::Integer => {
+                row.try_get::<Option<i32>, _>(i).map(|v| v.map(|n| CellValue::Int(n.into())))
+            }
+            SqlxDecoder::BigInt => row.try_get::<Option<i64>, _>(i).map(|v| v.map(CellValue::Int)),
+            SqlxDecoder::Real => {
+                row.try_get::<Option<f32>, _>(i).map(|v| v.map(|f| CellValue::Float(f.into())))
+            }
+            SqlxDecoder::Double => row.try_get::<Option<f64>, _>(i).map(|v| v.map(CellValue::Float)),
+            SqlxDecoder::Text => row.try_get::<Option<String>, _>(i).map(|v| v.map(CellValue::Text)),
+            SqlxDecoder::Blob => row
+                .try_get::<Option<Vec<u8>>, _>(i)
+                .map(|v| v.map(|b| CellValue::Binary(hex(&b)))),
+            SqlxDecoder::EncodedBlob(enc) => row
+                .try_get::<Option<Vec<u8>>, _>(i)
+                .map(|v| v.map(|b| CellValue::Text(decode_text(&b, enc)))),
+            SqlxDecoder::Dynamic(encoding) => {
+                // SQLite types values, not columns: decode by what arrived
+                return match row.try_get_raw(i) {
+                    Ok(raw) if raw.is_null() => CellValue::Null,
+                    Ok(raw) => match Self::for_kind(raw.type_info().kind(), encoding) {
+                        Some(decoder) => decoder.decode(row, i),
+                        None => CellValue::Text(raw.type_info().name().to_string()),
+                    },
+                    Err(e) => CellValue::Text(format!("ERR: {}", e)),
+                };
+            }
+        };
+
+        match cell {
+            Ok(Some(v)) => v,
+            Ok(None) => CellValue::Null,
+            Err(e) => CellValue::Text(format!("ERR: {}", e)),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_mssql_native_decoding() {
+        use tiberius::ColumnData as D;
+
+        assert!(matches!(MssqlDecoder::Native.decode(D::I16(Some(7))), CellValue::Int(7)));
+        assert!(matches!(MssqlDecoder::Native.decode(D::I32(None)), CellValue::Null));
+        assert!(matches!(
+            MssqlDecoder::Native.decode(D::Binary(Some(vec![0x0a, 0xff].into()))),
+            CellValue::Binary(s) if s == "0x0AFF"
+        ));
+        assert!(matches!(
+            MssqlDecoder::Money.decode(D::F64(Some(12.5))),
+            CellValue::Decimal(s) if s == "12.5000"
+        ));
+        assert!(matches!(
+            MssqlDecoder::EncodedBinary(encoding_rs::SHIFT_JIS).decode(D::Binary(Some(vec![0x82, 0xa0].into()))),
+            CellValue::Text(s) if s == "あ"
+        ));
+    }
+}
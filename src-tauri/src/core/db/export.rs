@@ -0,0 +1,264 @@
+//! Streaming CSV/TSV export of a query.
+//!
+//! Rows go from the driver's cursor through the usual per-column decoders
+//! straight into a buffered file, one batch at a time, so memory stays flat
+//! however many rows there are. The export bypasses the result cache, though
+//! a script that writes still invalidates it, and is meant to run without
+//! the connection's row cap and statement timeout (see `QueryControl`), so
+//! only cancelling stops it. Text is encoded as it is written; characters
+//! the target encoding lacks (e.g. in SHIFT_JIS) become `?`. Each result
+//! set of a script gets its own header, after a blank line.
+
+use super::control::QueryControl;
+use super::sink::ResultSink;
+use super::{CellValue, DbClient, DbConfig};
+use crate::utils::encoding::resolve_encoding;
+use encoding_rs::{Encoder, EncoderResult};
+use serde::{Deserialize, Serialize};
+use std::path::PathBuf;
+use std::time::{Duration, Instant};
+use tokio::io::{AsyncWriteExt, BufWriter};
+
+/// Write buffer of the output file.
+const WRITE_BUFFER: usize = 1024 * 1024;
+/// Least time between two progress reports.
+const PROGRESS_INTERVAL: Duration = Duration::from_millis(250);
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct ExportRequest {
+    pub path: PathBuf,
+    /// Field separator, e.g. `,` or `\t`.
+    pub separator: String,
+    /// Output encoding label, e.g. `UTF-8` or `SHIFT_JIS`.
+    pub encoding: String,
+    /// Start a UTF-8 file with a byte order mark, which Excel needs to
+    /// detect it.
+    #[serde(default)]
+    pub bom: bool,
+}
+
+#[derive(Debug, Clone, Copy, Default, Serialize)]
+pub struct ExportProgress {
+    pub rows: u64,
+    pub bytes: u64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct ExportReport {
+    pub path: PathBuf,
+    pub rows: u64,
+    pub bytes: u64,
+    pub result_sets: usize,
+    pub elapsed_ms: f64,
+}
+
+/// Append `field` to `line`, quoted if it holds the separator, a quote or a
+/// line break.
+fn push_field(line: &mut String, field: &str, separator: &str) {
+    if field.contains(separator) || field.contains(['"', '\n', '\r']) {
+        line.push('"');
+        line.push_str(&field.replace('"', "\"\""));
+        line.push('"');
+    } else {
+        line.push_str(field);
+    }
+}
+
+/// Append one CSV record; NULL is an empty field.
+fn push_record<'a>(line: &mut String, fields: impl Iterator<Item = Option<&'a str>>, separator: &str) {
+    for (i, field) in fields.enumerate() {
+        if i > 0 {
+            line.push_str(separator);
+        }
+        if let Some(field) = field {
+            push_field(line, field, separator);
+        }
+    }
+    line.push_str("\r\n");
+}
+
+fn cell_text(cell: &CellValue) -> Option<std::borrow::Cow<'_, str>> {
+    match cell {
+        CellValue::Null => None,
+        CellValue::Text(s) | CellValue::DateTime(s) | CellValue::Binary(s) | CellValue::Decimal(s) => {
+            Some(std::borrow::Cow::Borrowed(s))
+        }
+        other => Some(std::borrow::Cow::Owned(other.to_string())),
+    }
+}
+
+/// Encode `text` onto `out`, writing `?` for unmappable characters.
+fn encode(encoder: &mut Encoder, mut text: &str, out: &mut Vec<u8>) {
+    out.reserve(encoder.max_buffer_length_from_utf8_without_replacement(text.len()).unwrap_or(text.len()));
+    loop {
+        let (result, read) = encoder.encode_from_utf8_to_vec_without_replacement(text, out, false);
+        text = &text[read..];
+        match result {
+            EncoderResult::InputEmpty => break,
+            EncoderResult::OutputFull => out.reserve(text.len().max(16) * 2),
+            EncoderResult::Unmappable(_) => out.push(b'?'),
+        }
+    }
+}
+
+pub struct ExportSink<'a> {
+    file: BufWriter<tokio::fs::File>,
+    encoder: Encoder,
+    separator: String,
+    /// Text and encoded bytes of the batch being written, reused.
+    line: String,
+    encoded: Vec<u8>,
+    progress: ExportProgress,
+    result_sets: usize,
+    last_report: Instant,
+    on_progress: &'a (dyn Fn(ExportProgress) + Sync),
+}
+
+impl<'a> ExportSink<'a> {
+    pub async fn create(request: &ExportRequest, on_progress: &'a (dyn Fn(ExportProgress) + Sync)) -> anyhow::Result<Self> {
+        let encoding = resolve_encoding(&request.encoding);
+        let file = tokio::fs::File::create(&request.path).await?;
+        let mut sink = Self {
+            file: BufWriter::with_capacity(WRITE_BUFFER, file),
+            encoder: encoding.new_encoder(),
+            separator: request.separator.clone(),
+            line: String::new(),
+            encoded: Vec::new(),
+            progress: ExportProgress::default(),
+            result_sets: 0,
+            last_report: Instant::now(),
+            on_progress,
+        };
+        if request.bom && encoding == encoding_rs::UTF_8 {
+            sink.file.write_all(b"\xEF\xBB\xBF").await?;
+            sink.progress.bytes += 3;
+        }
+        Ok(sink)
+    }
+
+    /// Encode and write `self.line`.
+    async fn write_line(&mut self) -> anyhow::Result<()> {
+        self.encoded.clear();
+        encode(&mut self.encoder, &self.line, &mut self.encoded);
+        self.file.write_all(&self.encoded).await?;
+        self.progress.bytes += self.encoded.len() as u64;
+        self.line.clear();
+        Ok(())
+    }
+
+    /// Flush the file and report the final totals.
+    pub async fn finish(mut self) -> anyhow::Result<(ExportProgress, usize)> {
+        self.file.flush().await?;
+        self.file.get_mut().sync_all().await?;
+        (self.on_progress)(self.progress);
+        Ok((self.progress, self.result_sets))
+    }
+}
+
+#[async_trait::async_trait]
+impl ResultSink for ExportSink<'_> {
+    async fn columns(&mut self, columns: &[String]) -> anyhow::Result<()> {
+        if self.result_sets > 0 {
+            self.line.push_str("\r\n");
+        }
+        self.result_sets += 1;
+        push_record(&mut self.line, columns.iter().map(|c| Some(c.as_str())), &self.separator);
+        self.write_line().await
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        for row in &rows {
+            let cells: Vec<_> = row.iter().map(cell_text).collect();
+            push_record(&mut self.line, cells.iter().map(|c| c.as_deref()), &self.separator);
+        }
+        self.write_line().await?;
+        self.progress.rows += rows.len() as u64;
+        if self.last_report.elapsed() >= PROGRESS_INTERVAL {
+            self.last_report = Instant::now();
+            (self.on_progress)(self.progress);
+        }
+        Ok(true)
+    }
+}
+
+impl DbClient {
+    /// Run `sql` and write every row to `request.path`. A failed or
+    /// cancelled export deletes the partial file.
+    pub async fn export_query(
+        &self,
+        config: &DbConfig,
+        sql: &str,
+        request: &ExportRequest,
+        control: &QueryControl,
+        on_progress: &(dyn Fn(ExportProgress) + Sync),
+    ) -> anyhow::Result<ExportReport> {
+        let start = Instant::now();
+        let mut sink = ExportSink::create(request, on_progress).await?;
+        let outcome = match self.run_query(config, sql, &mut sink, control).await {
+            Ok(_) => sink.finish().await,
+            Err(e) => {
+                // Close the file first; Windows cannot delete an open one
+                drop(sink);
+                Err(e)
+            }
+        };
+        match outcome {
+            Ok((progress, result_sets)) => Ok(ExportReport {
+                path: request.path.clone(),
+                rows: progress.rows,
+                bytes: progress.bytes,
+                result_sets,
+                elapsed_ms: start.elapsed().as_secs_f64() * 1000.0,
+            }),
+            Err(e) => {
+                let _ = tokio::fs::remove_file(&request.path).await;
+                Err(e)
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_records_quote_only_when_needed() {
+        let mut line = String::new();
+        let fields = [Some("plain"), None, Some("a,b"), Some("say \"hi\""), Some("two\nlines")];
+        push_record(&mut line, fields.into_iter(), ",");
+        assert_eq!(line, "plain,,\"a,b\",\"say \"\"hi\"\"\",\"two\nlines\"\r\n");
+
+        let mut line = String::new();
+        push_record(&mut line, [Some("a,b"), Some("c\td")].into_iter(), "\t");
+        assert_eq!(line, "a,b\t\"c\td\"\r\n");
+    }
+
+    #[test]
+    fn test_encode_shift_jis_replaces_unmappable() {
+        let mut encoder = resolve_encoding("SHIFT_JIS").new_encoder();
+        let mut out = Vec::new();
+        encode(&mut encoder, "日本,😀\r\n", &mut out);
+        assert_eq!(out, b"\x93\xfa\x96\x7b,?\r\n");
+    }
+
+    #[tokio::test]
+    async fn test_export_writes_header_rows_and_bom() {
+        let path = std::env::temp_dir().join(format!("export_test_{}.csv", uuid::Uuid::new_v4()));
+        let request = ExportRequest { path: path.clone(), separator: ";".to_string(), encoding: "UTF-8".to_string(), bom: true };
+        let reports = std::sync::Mutex::new(Vec::new());
+        let on_progress = |p: ExportProgress| reports.lock().unwrap().push(p.rows);
+        let mut sink = ExportSink::create(&request, &on_progress).await.unwrap();
+        sink.columns(&["id".to_string(), "name".to_string()]).await.unwrap();
+        sink.rows(vec![vec![CellValue::Int(1), CellValue::Null], vec![CellValue::Int(2), CellValue::Text("x;y".into())]])
+            .await
+            .unwrap();
+        let (progress, sets) = sink.finish().await.unwrap();
+
+        let written = std::fs::read(&path).unwrap();
+        assert_eq!(written, b"\xEF\xBB\xBFid;name\r\n1;\r\n2;\"x;y\"\r\n");
+        assert_eq!((progress.rows, progress.bytes, sets), (2, written.len() as u64, 1));
+        assert_eq!(reports.lock().unwrap().last(), Some(&2));
+        let _ = std::fs::remove_file(path);
+    }
+}
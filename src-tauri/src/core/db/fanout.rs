@@ -0,0 +1,392 @@
+//! Running one script on several connections at once and diffing the rows.
+//!
+//! Every connection streams its rows into a bounded channel; a single
+//! consumer pulls them in lockstep and compares row hashes against the first
+//! connection (the baseline). Only hashes that have not been matched yet are
+//! held, with the row itself kept for a bounded number of them as samples,
+//! so the sides are never buffered whole. Rows of all result sets are
+//! compared as one sequence. Each side runs fresh, bypassing the result
+//! cache and its connection's row cap, so every row is compared as it is now.
+
+use super::control::QueryControl;
+use super::sink::ResultSink;
+use super::{CellValue, DbClient, DbConfig};
+use serde::{Deserialize, Serialize};
+use std::collections::hash_map::DefaultHasher;
+use std::collections::{HashMap, VecDeque};
+use std::hash::{Hash, Hasher};
+use std::time::Instant;
+use tokio::sync::mpsc;
+use tokio_util::sync::CancellationToken;
+
+/// Row batches a connection may run ahead of the diff.
+const BATCHES_IN_FLIGHT: usize = 4;
+/// Differing rows reported per direction and connection.
+const SAMPLE_ROWS: usize = 20;
+/// Unmatched rows held with their content (for samples) per connection;
+/// past this only their hashes are kept.
+const MAX_HELD_ROWS: usize = 10_000;
+
+#[derive(Debug, Clone, Copy, Default, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum DiffMode {
+    /// Row N must match row N of the baseline.
+    Ordered,
+    /// Rows match regardless of order, duplicates counted.
+    #[default]
+    Multiset,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct SideReport {
+    pub connection_id: String,
+    pub name: String,
+    pub elapsed_ms: f64,
+    pub rows: u64,
+    /// Columns of the first result set.
+    pub columns: Vec<String>,
+    /// The side stopped before its last row; it is left out of the diff.
+    pub truncated: bool,
+    pub error: Option<String>,
+}
+
+/// How one connection's rows differ from the baseline's.
+#[derive(Debug, Clone, Default, Serialize)]
+pub struct SideDiff {
+    pub connection_id: String,
+    /// Rows here that the baseline lacks (or, ordered, that sit where the
+    /// baseline has another row).
+    pub extra: u64,
+    /// Baseline rows missing here, counted the same way.
+    pub missing: u64,
+    /// Ordered mode: index of the first row that does not line up.
+    pub first_difference: Option<u64>,
+    pub columns_match: bool,
+    pub extra_samples: Vec<Vec<CellValue>>,
+    pub missing_samples: Vec<Vec<CellValue>>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct FanoutReport {
+    pub mode: DiffMode,
+    pub baseline_id: String,
+    pub sides: Vec<SideReport>,
+    /// One per connection after the baseline that ran without error or
+    /// truncation.
+    pub diffs: Vec<SideDiff>,
+    pub identical: bool,
+    pub total_ms: f64,
+}
+
+/// Hash of a row's values. Text-like values (dates, decimals, binary as hex)
+/// hash as their text, so the same data decoded differently still matches.
+fn row_hash(row: &[CellValue]) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    for cell in row {
+        match cell {
+            CellValue::Null => 0u8.hash(&mut hasher),
+            CellValue::Int(n) => (1u8, n).hash(&mut hasher),
+            CellValue::Float(f) => (2u8, f.to_bits()).hash(&mut hasher),
+            CellValue::Bool(b) => (3u8, b).hash(&mut hasher),
+            CellValue::Text(s) | CellValue::DateTime(s) | CellValue::Binary(s) | CellValue::Decimal(s) => {
+                (4u8, s).hash(&mut hasher)
+            }
+        }
+    }
+    hasher.finish()
+}
+
+/// Hands each batch to the diff, blocking while it is behind.
+struct ChannelSink {
+    columns: Option<Vec<String>>,
+    rows: u64,
+    tx: mpsc::Sender<Vec<Vec<CellValue>>>,
+}
+
+#[async_trait::async_trait]
+impl ResultSink for ChannelSink {
+    async fn columns(&mut self, columns: &[String]) -> anyhow::Result<()> {
+        self.columns.get_or_insert_with(|| columns.to_vec());
+        Ok(())
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        self.rows += rows.len() as u64;
+        // The diff stops listening only once it is finished with this side
+        Ok(self.tx.send(rows).await.is_ok())
+    }
+}
+
+/// Receiving end of one connection, row by row.
+struct SideRows {
+    rx: mpsc::Receiver<Vec<Vec<CellValue>>>,
+    queue: VecDeque<Vec<CellValue>>,
+}
+
+impl SideRows {
+    async fn next(&mut self) -> Option<Vec<CellValue>> {
+        loop {
+            if let Some(row) = self.queue.pop_front() {
+                return Some(row);
+            }
+            self.queue.extend(self.rx.recv().await?);
+        }
+    }
+}
+
+/// Rows of one connection not yet matched against the baseline: positive
+/// counts are extra rows, negative ones missing rows.
+#[derive(Default)]
+struct Unmatched {
+    counts: HashMap<u64, (i64, Option<Vec<CellValue>>)>,
+    held: usize,
+}
+
+impl Unmatched {
+    fn add(&mut self, row: &[CellValue], delta: i64) {
+        let hash = row_hash(row);
+        let hold = self.held < MAX_HELD_ROWS;
+        let entry = self.counts.entry(hash).or_insert((0, None));
+        entry.0 += delta;
+        if entry.0 == 0 {
+            if self.counts.remove(&hash).and_then(|(_, row)| row).is_some() {
+                self.held -= 1;
+            }
+        } else if entry.1.is_none() && hold {
+            entry.1 = Some(row.to_vec());
+            self.held += 1;
+        }
+    }
+
+    fn into_diff(self, diff: &mut SideDiff) {
+        for (count, row) in self.counts.into_values() {
+            let (total, samples) = if count > 0 {
+                (&mut diff.extra, &mut diff.extra_samples)
+            } else {
+                (&mut diff.missing, &mut diff.missing_samples)
+            };
+            *total += count.unsigned_abs();
+            if let Some(row) = row.filter(|_| samples.len() < SAMPLE_ROWS) {
+                samples.push(row);
+            }
+        }
+    }
+}
+
+fn record_difference(diff: &mut SideDiff, index: u64, extra: Option<Vec<CellValue>>, missing: Option<Vec<CellValue>>) {
+    diff.first_difference.get_or_insert(index);
+    if let Some(row) = extra {
+        diff.extra += 1;
+        if diff.extra_samples.len() < SAMPLE_ROWS {
+            diff.extra_samples.push(row);
+        }
+    }
+    if let Some(row) = missing {
+        diff.missing += 1;
+        if diff.missing_samples.len() < SAMPLE_ROWS {
+            diff.missing_samples.push(row);
+        }
+    }
+}
+
+/// Compare every side with the first as their rows arrive.
+async fn diff_sides(mut sides: Vec<SideRows>, mode: DiffMode) -> Vec<SideDiff> {
+    let mut diffs: Vec<SideDiff> = (1..sides.len()).map(|_| SideDiff::default()).collect();
+    let mut unmatched: Vec<Unmatched> = (1..sides.len()).map(|_| Unmatched::default()).collect();
+    let mut index = 0u64;
+
+    loop {
+        let base = sides[0].next().await;
+        let mut more = base.is_some();
+        for k in 1..sides.len() {
+            let row = sides[k].next().await;
+            more |= row.is_some();
+            match mode {
+                DiffMode::Ordered => {
+                    let same = match (&base, &row) {
+                        (Some(a), Some(b)) => row_hash(a) == row_hash(b),
+                        (None, None) => true,
+                        _ => false,
+                    };
+                    if !same {
+                        record_difference(&mut diffs[k - 1], index, row, base.clone());
+                    }
+                }
+                DiffMode::Multiset => {
+                    if let Some(base) = &base {
+                        unmatched[k - 1].add(base, -1);
+                    }
+                    if let Some(row) = &row {
+                        unmatched[k - 1].add(row, 1);
+                    }
+                }
+            }
+        }
+        if !more {
+            break;
+        }
+        index += 1;
+    }
+
+    for (diff, unmatched) in diffs.iter_mut().zip(unmatched) {
+        unmatched.into_diff(diff);
+    }
+    diffs
+}
+
+impl DbClient {
+    /// Run `sql` on every connection of `configs` concurrently and diff
+    /// their rows against the first. A connection that fails is reported
+    /// with its error and left out of the diff.
+    pub async fn fan_out(
+        &self,
+        configs: &[DbConfig],
+        sql: &str,
+        mode: DiffMode,
+        cancel: CancellationToken,
+    ) -> anyhow::Result<FanoutReport> {
+        if configs.len() < 2 {
+            anyhow::bail!("Choose at least two connections to compare");
+        }
+        let start = Instant::now();
+
+        let mut receivers = Vec::with_capacity(configs.len());
+        let runs = configs.iter().map(|config| {
+            let (tx, rx) = mpsc::channel(BATCHES_IN_FLIGHT);
+            receivers.push(SideRows { rx, queue: VecDeque::new() });
+            let control = QueryControl::for_config(config, cancel.clone()).without_row_cap();
+            async move {
+                let side_start = Instant::now();
+                let mut sink = ChannelSink { columns: None, rows: 0, tx };
+                let outcome = self.run_query(config, sql, &mut sink, &control).await;
+                SideReport {
+                    connection_id: config.id.clone(),
+                    name: config.name.clone(),
+                    elapsed_ms: side_start.elapsed().as_secs_f64() * 1000.0,
+                    rows: sink.rows,
+                    columns: sink.columns.unwrap_or_default(),
+                    truncated: matches!(&outcome, Ok(result) if result.truncated),
+                    error: outcome.err().map(|e| e.to_string()),
+                }
+            }
+        });
+        let runs: Vec<_> = runs.collect();
+        let (sides, diffs) = tokio::join!(futures_util::future::join_all(runs), diff_sides(receivers, mode));
+
+        if cancel.is_cancelled() {
+            anyhow::bail!("Query cancelled");
+        }
+        let baseline = &sides[0];
+        let complete = |side: &SideReport| side.error.is_none() && !side.truncated;
+        let diffs: Vec<SideDiff> = if !complete(baseline) {
+            Vec::new()
+        } else {
+            diffs
+                .into_iter()
+                .zip(&sides[1..])
+                .filter(|(_, side)| complete(side))
+                .map(|(mut diff, side)| {
+                    diff.connection_id = side.connection_id.clone();
+                    diff.columns_match = side.columns == baseline.columns;
+                    diff
+                })
+                .collect()
+        };
+        // A truncated side lacks rows rather than differing, so it neither
+        // counts against nor toward the others matching the baseline
+        let identical = complete(baseline)
+            && sides.iter().all(|s| s.error.is_none())
+            && diffs.iter().all(|d| d.columns_match && d.extra == 0 && d.missing == 0);
+
+        Ok(FanoutReport {
+            mode,
+            baseline_id: baseline.connection_id.clone(),
+            sides,
+            diffs,
+            identical,
+            total_ms: start.elapsed().as_secs_f64() * 1000.0,
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::core::db::DbType;
+
+    fn rows(values: &[i64]) -> Vec<Vec<CellValue>> {
+        values.iter().map(|&v| vec![CellValue::Int(v)]).collect()
+    }
+
+    async fn diff(mode: DiffMode, sides: &[&[i64]]) -> Vec<SideDiff> {
+        let receivers = sides
+            .iter()
+            .map(|values| {
+                // Uneven batches, as result sets of different sizes produce
+                let (tx, rx) = mpsc::channel(values.len() + 1);
+                for chunk in values.chunks(2) {
+                    tx.try_send(rows(chunk)).unwrap();
+                }
+                SideRows { rx, queue: VecDeque::new() }
+            })
+            .collect();
+        diff_sides(receivers, mode).await
+    }
+
+    #[tokio::test]
+    async fn test_multiset_diff_ignores_order() {
+        let diffs = diff(DiffMode::Multiset, &[&[1, 2, 2, 3], &[3, 2, 1, 2], &[1, 2, 4, 4, 5]]).await;
+        assert_eq!((diffs[0].extra, diffs[0].missing), (0, 0));
+        assert_eq!((diffs[1].extra, diffs[1].missing), (3, 2));
+        let mut extra = diffs[1].extra_samples.clone();
+        extra.sort_by_key(|r| match r[0] { CellValue::Int(n) => n, _ => 0 });
+        assert_eq!(extra.len(), 2, "one sample per distinct row");
+        assert_eq!(row_hash(&extra[0]), row_hash(&[CellValue::Int(4)]));
+    }
+
+    #[tokio::test]
+    async fn test_ordered_diff_reports_first_difference() {
+        let diffs = diff(DiffMode::Ordered, &[&[1, 2, 3], &[1, 2, 3], &[1, 3, 2, 4]]).await;
+        assert_eq!(diffs[0].first_difference, None);
+        assert_eq!(diffs[1].first_difference, Some(1));
+        assert_eq!((diffs[1].extra, diffs[1].missing), (3, 2));
+    }
+
+    #[tokio::test]
+    async fn test_fan_out_reads_fresh_rows_past_the_row_cap() {
+        let path = std::env::temp_dir().join(format!("fanout_test_{}.sqlite", uuid::Uuid::new_v4()));
+        let config = |id: &str, max_rows, cache_ttl_secs| DbConfig {
+            id: id.to_string(),
+            db_type: DbType::Sqlite,
+            url: format!("sqlite://{}?mode=rwc", path.to_string_lossy().replace('\\', "/")),
+            max_rows,
+            cache_ttl_secs,
+            ..Default::default()
+        };
+        let (cached, capped) = (config("fanout-cached", 0, 60), config("fanout-capped", 1, 0));
+        let client = DbClient::new();
+        client.execute_query(&cached, "CREATE TABLE t (a INTEGER); INSERT INTO t VALUES (1), (2), (3)").await.unwrap();
+        client.execute_query(&cached, "SELECT a FROM t").await.unwrap();
+        // Written through the other connection, so the first one's cache is stale
+        client.execute_query(&capped, "INSERT INTO t VALUES (4)").await.unwrap();
+
+        let configs = [cached.clone(), capped.clone()];
+        let cancel = CancellationToken::new();
+        let report = client.fan_out(&configs, "SELECT a FROM t", DiffMode::Ordered, cancel).await.unwrap();
+        let sides: Vec<_> = report.sides.iter().map(|s| (s.rows, s.truncated)).collect();
+        assert_eq!(sides, [(4, false), (4, false)]);
+        assert!(report.identical);
+
+        client.invalidate(&cached.id);
+        client.invalidate(&capped.id);
+        let _ = std::fs::remove_file(path);
+    }
+
+    #[test]
+    fn test_row_hash_matches_text_like_values() {
+        let a = [CellValue::Decimal("1.50".into()), CellValue::Null];
+        let b = [CellValue::Text("1.50".into()), CellValue::Null];
+        assert_eq!(row_hash(&a), row_hash(&b));
+        assert_ne!(row_hash(&[CellValue::Int(1)]), row_hash(&[CellValue::Text("1".into())]));
+    }
+}
@@ -0,0 +1,216 @@
+//! Reachability probes of saved connections.
+//!
+//! A probe opens a dedicated connection, bypassing the pools so their warm
+//! logins do not hide the cost, and times the TCP connect, the login and a
+//! `SELECT 1` round trip separately. Connections are probed in parallel, a
+//! bounded number at a time, and the last `HISTORY_LEN` samples of each are
+//! kept for the sidebar.
+
+use super::{pool, DbClient, DbConfig, DbType};
+use crate::utils::perf;
+use serde::Serialize;
+use std::collections::{HashMap, VecDeque};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Mutex;
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+use tokio::net::TcpStream;
+
+/// Samples kept per connection.
+pub const HISTORY_LEN: usize = 30;
+/// Connections probed at the same time.
+const MAX_CONCURRENT_PROBES: usize = 8;
+/// A probe taking longer than this counts as a failure.
+const PROBE_TIMEOUT: Duration = Duration::from_secs(10);
+
+#[derive(Debug, Clone, Default, Serialize)]
+pub struct ProbeSample {
+    /// Unix time of the probe in milliseconds.
+    pub at_ms: u64,
+    /// TCP connect; `None` for file databases or when it failed.
+    pub connect_ms: Option<f64>,
+    /// Login after the TCP connect. sqlx connects on its own, so there it
+    /// includes a second TCP handshake.
+    pub login_ms: Option<f64>,
+    /// `SELECT 1` on the new connection.
+    pub round_trip_ms: Option<f64>,
+    pub error: Option<String>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct ConnectionHealth {
+    pub connection_id: String,
+    /// Oldest first.
+    pub samples: Vec<ProbeSample>,
+}
+
+#[derive(Default)]
+pub struct HealthHistory {
+    samples: Mutex<HashMap<String, VecDeque<ProbeSample>>>,
+    /// A probe round is running; another request only reads the history.
+    probing: AtomicBool,
+}
+
+impl HealthHistory {
+    fn record(&self, id: &str, sample: ProbeSample) {
+        let mut samples = self.samples.lock().unwrap();
+        let history = samples.entry(id.to_string()).or_default();
+        if history.len() == HISTORY_LEN {
+            history.pop_front();
+        }
+        history.push_back(sample);
+    }
+
+    /// History of each of `configs`, in order; drops connections no longer
+    /// saved.
+    fn snapshot(&self, configs: &[DbConfig]) -> Vec<ConnectionHealth> {
+        let mut samples = self.samples.lock().unwrap();
+        samples.retain(|id, _| configs.iter().any(|c| &c.id == id));
+        configs
+            .iter()
+            .map(|c| ConnectionHealth {
+                connection_id: c.id.clone(),
+                samples: samples.get(&c.id).map(|h| h.iter().cloned().collect()).unwrap_or_default(),
+            })
+            .collect()
+    }
+}
+
+/// Host and port of a sqlx URL such as `postgres://user:pw@host:5432/db`.
+fn server_addr(db_type: &DbType, url: &str) -> Option<(String, u16)> {
+    let default_port = match db_type {
+        DbType::Postgres => 5432,
+        DbType::Mysql => 3306,
+        _ => return None,
+    };
+    let rest = url.split_once("://").map_or(url, |(_, rest)| rest);
+    let authority = rest.split(['/', '?']).next()?;
+    let host_port = authority.rsplit_once('@').map_or(authority, |(_, host)| host);
+    let (host, port) = match host_port.strip_prefix('[') {
+        Some(v6) => {
+            let (host, after) = v6.split_once(']')?;
+            (host, after.strip_prefix(':'))
+        }
+        None => match host_port.split_once(':') {
+            Some((host, port)) => (host, Some(port)),
+            None => (host_port, None),
+        },
+    };
+    let port = match port {
+        Some(port) => port.parse().ok()?,
+        None => default_port,
+    };
+    (!host.is_empty()).then(|| (host.to_string(), port))
+}
+
+fn ms_since(start: Instant) -> f64 {
+    start.elapsed().as_secs_f64() * 1000.0
+}
+
+async fn probe_mssql(config: &DbConfig, sample: &mut ProbeSample) -> anyhow::Result<()> {
+    let start = Instant::now();
+    let (t_config, tcp) = pool::open_mssql_socket(config).await?;
+    sample.connect_ms = Some(ms_since(start));
+
+    let start = Instant::now();
+    let mut client = pool::login_mssql(t_config, tcp).await?;
+    sample.login_ms = Some(ms_since(start));
+
+    let start = Instant::now();
+    client.simple_query("SELECT 1").await?.into_results().await?;
+    sample.round_trip_ms = Some(ms_since(start));
+    Ok(())
+}
+
+async fn probe_sqlx(config: &DbConfig, sample: &mut ProbeSample) -> anyhow::Result<()> {
+    use sqlx::Connection;
+
+    if let Some((host, port)) = server_addr(&config.db_type, &config.url) {
+        let start = Instant::now();
+        drop(TcpStream::connect((host.as_str(), port)).await?);
+        sample.connect_ms = Some(ms_since(start));
+    }
+
+    let start = Instant::now();
+    let mut conn = sqlx::AnyConnection::connect(&config.url).await?;
+    sample.login_ms = Some(ms_since(start));
+
+    let start = Instant::now();
+    sqlx::query("SELECT 1").execute(&mut conn).await?;
+    sample.round_trip_ms = Some(ms_since(start));
+    conn.close().await?;
+    Ok(())
+}
+
+async fn probe(config: &DbConfig) -> ProbeSample {
+    let at_ms = SystemTime::now().duration_since(UNIX_EPOCH).map_or(0, |d| d.as_millis() as u64);
+    let mut sample = ProbeSample { at_ms, ..Default::default() };
+    let run = async {
+        match config.db_type {
+            DbType::SqlServer => probe_mssql(config, &mut sample).await,
+            _ => probe_sqlx(config, &mut sample).await,
+        }
+    };
+    let error = match tokio::time::timeout(PROBE_TIMEOUT, run).await {
+        Ok(Ok(())) => None,
+        Ok(Err(e)) => Some(e.to_string()),
+        Err(_) => Some(format!("No answer within {}s", PROBE_TIMEOUT.as_secs())),
+    };
+    sample.error = error;
+    sample
+}
+
+impl DbClient {
+    /// Probe every connection of `configs`, a few at a time, and return
+    /// their histories. While a round is already running this returns the
+    /// history without probing again.
+    pub async fn probe_connections(&self, configs: &[DbConfig]) -> Vec<ConnectionHealth> {
+        use futures_util::stream::StreamExt;
+
+        if self.health.probing.swap(true, Ordering::AcqRel) {
+            return self.health.snapshot(configs);
+        }
+        {
+            let _span = perf::span("probe");
+            futures_util::stream::iter(configs)
+                .map(|config| async move { (config, probe(config).await) })
+                .buffer_unordered(MAX_CONCURRENT_PROBES)
+                .for_each(|(config, sample)| async move { self.health.record(&config.id, sample) })
+                .await;
+        }
+        self.health.probing.store(false, Ordering::Release);
+        self.health.snapshot(configs)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_server_addr() {
+        let addr = |db_type, url| server_addr(&db_type, url);
+        assert_eq!(addr(DbType::Postgres, "postgres://u:p@db.local:6543/app"), Some(("db.local".to_string(), 6543)));
+        assert_eq!(addr(DbType::Postgres, "postgres://u:p@db.local/app?sslmode=require"), Some(("db.local".to_string(), 5432)));
+        assert_eq!(addr(DbType::Mysql, "mysql://root@[::1]:3307/app"), Some(("::1".to_string(), 3307)));
+        assert_eq!(addr(DbType::Mysql, "mysql://u:p@w@host/app"), Some(("host".to_string(), 3306)));
+        assert_eq!(addr(DbType::Sqlite, "sqlite://data.db"), None);
+        assert_eq!(addr(DbType::Postgres, "postgres:///app"), None);
+    }
+
+    #[test]
+    fn test_history_is_bounded_and_follows_saved_connections() {
+        let history = HealthHistory::default();
+        for i in 0..HISTORY_LEN + 5 {
+            history.record("a", ProbeSample { at_ms: i as u64, ..Default::default() });
+        }
+        history.record("gone", ProbeSample::default());
+
+        let config = |id: &str| DbConfig { id: id.to_string(), ..Default::default() };
+        let configs = [config("a"), config("b")];
+        let health = history.snapshot(&configs);
+        assert_eq!(health[0].samples.len(), HISTORY_LEN);
+        assert_eq!(health[0].samples[0].at_ms, 5);
+        assert!(health[1].samples.is_empty());
+        assert!(!history.samples.lock().unwrap().contains_key("gone"));
+    }
+}
@@ -0,0 +1,366 @@
+//! Timed replay of a window of the log, for reproducing load.
+//!
+//! A dispatcher re-issues the logged executions in timestamp order, keeping
+//! their original spacing (scaled by `speed`), and hands them to a fixed set
+//! of workers with one pooled connection each. Parameters are bound as in
+//! `replay`, so each connection prepares a template once. Latencies are
+//! summarised per template.
+
+use super::control::QueryControl;
+use super::pool::{PooledClient, SQLX_MAX_CONNECTIONS};
+use super::replay::{run_mssql, run_sqlx, BindValue, BoundStatement, RunOutcome};
+use super::{DbClient, DbConfig, DbType};
+use crate::core::log_parser::Execution;
+use serde::Serialize;
+use std::collections::HashMap;
+use std::time::{Duration, Instant};
+use tokio::sync::{mpsc, Mutex};
+
+/// Timestamp format of the log lines.
+const LOG_TIMESTAMP: &str = "%Y/%m/%d %H:%M:%S";
+
+#[derive(Debug, Clone)]
+pub struct LoadOptions {
+    /// Inclusive bounds in the log's `YYYY/MM/DD HH:MM:SS` form.
+    pub from: Option<String>,
+    pub to: Option<String>,
+    /// Multiple of the original pace; 0 issues statements as fast as the
+    /// workers take them.
+    pub speed: f64,
+    pub workers: usize,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct TemplateLoad {
+    pub template_sql: String,
+    pub dao_file: String,
+    pub count: usize,
+    pub errors: usize,
+    /// Latency percentiles of the successful runs.
+    pub p50_ms: f64,
+    pub p95_ms: f64,
+    pub p99_ms: f64,
+    pub max_ms: f64,
+    pub first_error: Option<String>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct LoadReport {
+    pub statements: usize,
+    pub errors: usize,
+    pub workers: usize,
+    pub elapsed_ms: f64,
+    pub throughput_per_sec: f64,
+    /// Longest a statement waited past its scheduled start for a free
+    /// worker; large values mean the workers could not keep the pace.
+    pub max_lag_ms: f64,
+    /// Busiest templates first.
+    pub templates: Vec<TemplateLoad>,
+}
+
+/// Executions between `from` and `to`, in timestamp order. Fixed-width log
+/// timestamps compare correctly as strings.
+pub fn select_window<'a>(
+    executions: &'a [Execution],
+    from: Option<&str>,
+    to: Option<&str>,
+) -> Vec<&'a Execution> {
+    let mut window: Vec<&Execution> = executions
+        .iter()
+        .filter(|e| !e.timestamp.is_empty())
+        .filter(|e| from.map_or(true, |from| e.timestamp.as_str() >= from))
+        .filter(|e| to.map_or(true, |to| e.timestamp.as_str() <= to))
+        .collect();
+    window.sort_by(|a, b| a.timestamp.cmp(&b.timestamp));
+    window
+}
+
+/// Offset of each execution from the first; unreadable timestamps keep the
+/// previous offset.
+fn schedule(window: &[&Execution]) -> Vec<Duration> {
+    use tiberius::time::chrono::NaiveDateTime;
+
+    let mut first = None;
+    let mut last = Duration::ZERO;
+    window
+        .iter()
+        .map(|e| {
+            if let Ok(ts) = NaiveDateTime::parse_from_str(&e.timestamp, LOG_TIMESTAMP) {
+                let first = *first.get_or_insert(ts);
+                last = (ts - first).to_std().unwrap_or(last);
+            }
+            last
+        })
+        .collect()
+}
+
+/// Nearest-rank percentile of sorted values.
+pub(super) fn percentile(sorted: &[f64], p: f64) -> f64 {
+    if sorted.is_empty() {
+        return 0.0;
+    }
+    let rank = (p / 100.0 * sorted.len() as f64).ceil() as usize;
+    sorted[rank.clamp(1, sorted.len()) - 1]
+}
+
+struct Job<'a> {
+    template: usize,
+    due: Instant,
+    params: &'a [String],
+}
+
+struct Sample {
+    template: usize,
+    elapsed_ms: f64,
+    lag: Duration,
+    error: Option<String>,
+}
+
+enum WorkerConn {
+    Mssql(PooledClient),
+    Sqlx(sqlx::pool::PoolConnection<sqlx::Any>),
+}
+
+impl WorkerConn {
+    /// Close a connection an interrupted statement left busy, or whose
+    /// session a statement changed.
+    fn discard(self) {
+        match self {
+            WorkerConn::Mssql(client) => drop(client),
+            WorkerConn::Sqlx(conn) => drop(conn.detach()),
+        }
+    }
+
+    fn release(self) {
+        match self {
+            WorkerConn::Mssql(client) => client.release(),
+            WorkerConn::Sqlx(conn) => drop(conn),
+        }
+    }
+}
+
+impl DbClient {
+    /// Replay the executions of `options`' window against `config`. A failed
+    /// statement is counted and the replay goes on; the statement timeout
+    /// applies per statement, cancellation ends the replay.
+    pub async fn replay_load(
+        &self,
+        config: &DbConfig,
+        executions: &[Execution],
+        options: &LoadOptions,
+        control: &QueryControl,
+    ) -> anyhow::Result<LoadReport> {
+        let window = select_window(executions, options.from.as_deref(), options.to.as_deref());
+        let offsets = schedule(&window);
+
+        // One bound statement per template, typed by its first execution
+        let mut templates: Vec<(BoundStatement, &Execution)> = Vec::new();
+        let mut template_of: HashMap<&str, usize> = HashMap::new();
+        let jobs: Vec<(usize, Duration, &[String])> = window
+            .iter()
+            .copied()
+            .zip(&offsets)
+            .map(|(e, offset)| {
+                let template = *template_of.entry(e.sql.as_str()).or_insert_with(|| {
+                    let sample = BindValue::parse_all(&e.params).ok();
+                    let statement = BoundStatement::new(config.db_type.clone(), &e.sql, sample.as_deref());
+                    templates.push((statement, e));
+                    templates.len() - 1
+                });
+                (template, *offset, e.params.as_slice())
+            })
+            .collect();
+
+        // sqlx pools are capped; a worker holds its connection throughout
+        let mut workers = options.workers.max(1);
+        if config.db_type != DbType::SqlServer {
+            workers = workers.min(SQLX_MAX_CONNECTIONS as usize);
+        }
+
+        let (tx, rx) = mpsc::channel::<Job>(workers);
+        let rx = Mutex::new(rx);
+        let statements: Vec<&BoundStatement> = templates.iter().map(|(s, _)| s).collect();
+        let start = Instant::now();
+
+        let dispatcher = async move {
+            for (template, offset, params) in jobs {
+                let due = if options.speed > 0.0 {
+                    let due = start + offset.div_f64(options.speed);
+                    tokio::select! {
+                        _ = tokio::time::sleep_until(due.into()) => {}
+                        _ = control.cancelled() => break,
+                    }
+                    due
+                } else {
+                    Instant::now()
+                };
+                if tx.send(Job { template, due, params }).await.is_err() {
+                    break;
+                }
+            }
+        };
+        let worker_runs = (0..workers).map(|_| self.load_worker(config, &statements, &rx, control));
+        let ((), samples) = tokio::join!(dispatcher, futures_util::future::join_all(worker_runs));
+        // Logged writes ran on the workers' connections, past `run_query`
+        for (_, first) in &templates {
+            self.invalidate_after(config, &first.sql);
+        }
+
+        if control.is_cancelled() {
+            anyhow::bail!("Query cancelled");
+        }
+        let elapsed = start.elapsed();
+        Ok(summarize(&templates, samples.into_iter().flatten().collect(), workers, elapsed))
+    }
+
+    async fn load_worker(
+        &self,
+        config: &DbConfig,
+        statements: &[&BoundStatement],
+        jobs: &Mutex<mpsc::Receiver<Job<'_>>>,
+        control: &QueryControl,
+    ) -> Vec<Sample> {
+        let mut samples = Vec::new();
+        let mut conn: Option<WorkerConn> = None;
+        let mut session_changed = false;
+
+        loop {
+            let Some(job) = jobs.lock().await.recv().await else { break };
+            let lag = job.due.elapsed();
+            let statement = statements[job.template];
+            session_changed |= statement.changes_session;
+            let start = Instant::now();
+
+            let outcome = tokio::select! {
+                res = self.load_run(config, &mut conn, statement, job.params) => res.map_err(|e| e.to_string()),
+                reason = control.interrupted() => {
+                    if let Some(conn) = conn.take() {
+                        conn.discard();
+                    }
+                    Err(reason.to_string())
+                }
+            };
+            samples.push(Sample {
+                template: job.template,
+                elapsed_ms: start.elapsed().as_secs_f64() * 1000.0,
+                lag,
+                error: outcome.err(),
+            });
+        }
+
+        match conn {
+            Some(conn) if session_changed => conn.discard(),
+            Some(conn) => conn.release(),
+            None => {}
+        }
+        samples
+    }
+
+    async fn load_run(
+        &self,
+        config: &DbConfig,
+        conn: &mut Option<WorkerConn>,
+        statement: &BoundStatement,
+        params: &[String],
+    ) -> anyhow::Result<RunOutcome> {
+        if conn.is_none() {
+            *conn = Some(match config.db_type {
+                DbType::SqlServer => WorkerConn::Mssql(self.mssql_executor.pool.checkout(config).await?),
+                _ => WorkerConn::Sqlx(self.sqlx_executor.pools.get(config)?.acquire().await?),
+            });
+        }
+        match conn.as_mut().expect("connected above") {
+            WorkerConn::Mssql(client) => run_mssql(client, statement, params, None).await,
+            WorkerConn::Sqlx(conn) => run_sqlx(conn, sqlx::query(&statement.sql), statement, params, None).await,
+        }
+    }
+}
+
+fn summarize(
+    templates: &[(BoundStatement, &Execution)],
+    samples: Vec<Sample>,
+    workers: usize,
+    elapsed: Duration,
+) -> LoadReport {
+    let mut latencies: Vec<Vec<f64>> = vec![Vec::new(); templates.len()];
+    let mut stats: Vec<TemplateLoad> = templates
+        .iter()
+        .map(|(_, first)| TemplateLoad {
+            template_sql: first.sql.clone(),
+            dao_file: first.dao_file.clone(),
+            count: 0,
+            errors: 0,
+            p50_ms: 0.0,
+            p95_ms: 0.0,
+            p99_ms: 0.0,
+            max_ms: 0.0,
+            first_error: None,
+        })
+        .collect();
+
+    let mut max_lag = Duration::ZERO;
+    for sample in &samples {
+        let template = &mut stats[sample.template];
+        template.count += 1;
+        max_lag = max_lag.max(sample.lag);
+        match &sample.error {
+            Some(error) => {
+                template.errors += 1;
+                template.first_error.get_or_insert_with(|| error.clone());
+            }
+            None => latencies[sample.template].push(sample.elapsed_ms),
+        }
+    }
+    for (template, mut latencies) in stats.iter_mut().zip(latencies) {
+        latencies.sort_by(f64::total_cmp);
+        template.p50_ms = percentile(&latencies, 50.0);
+        template.p95_ms = percentile(&latencies, 95.0);
+        template.p99_ms = percentile(&latencies, 99.0);
+        template.max_ms = latencies.last().copied().unwrap_or(0.0);
+    }
+    stats.sort_by(|a, b| b.count.cmp(&a.count));
+
+    let statements = samples.len();
+    LoadReport {
+        statements,
+        errors: stats.iter().map(|t| t.errors).sum(),
+        workers,
+        elapsed_ms: elapsed.as_secs_f64() * 1000.0,
+        throughput_per_sec: statements as f64 / elapsed.as_secs_f64().max(f64::EPSILON),
+        max_lag_ms: max_lag.as_secs_f64() * 1000.0,
+        templates: stats,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn exec(timestamp: &str) -> Execution {
+        Execution { timestamp: timestamp.to_string(), ..Default::default() }
+    }
+
+    #[test]
+    fn test_window_and_schedule() {
+        let executions = vec![
+            exec("2024/01/01 10:00:05"),
+            exec("2024/01/01 09:59:59"),
+            exec("2024/01/01 10:00:01"),
+            exec(""),
+            exec("2024/01/01 10:01:00"),
+        ];
+        let window = select_window(&executions, Some("2024/01/01 10:00:00"), Some("2024/01/01 10:00:59"));
+        let stamps: Vec<&str> = window.iter().map(|e| e.timestamp.as_str()).collect();
+        assert_eq!(stamps, ["2024/01/01 10:00:01", "2024/01/01 10:00:05"]);
+        assert_eq!(schedule(&window), [Duration::ZERO, Duration::from_secs(4)]);
+    }
+
+    #[test]
+    fn test_percentile() {
+        let sorted: Vec<f64> = (1..=100).map(f64::from).collect();
+        assert_eq!(percentile(&sorted, 50.0), 50.0);
+        assert_eq!(percentile(&sorted, 99.0), 99.0);
+        assert_eq!(percentile(&[7.0], 95.0), 7.0);
+        assert_eq!(percentile(&[], 50.0), 0.0);
+    }
+}
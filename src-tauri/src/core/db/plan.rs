@@ -0,0 +1,183 @@
+//! Actual execution plans and runtime statistics of a statement.
+//!
+//! SQL Server returns the plan of every statement as an extra result set
+//! while `SET STATISTICS XML` is on. Its `QueryTimeStats` and per-operator
+//! `RunTimeCountersPerThread` carry what `STATISTICS TIME` and
+//! `STATISTICS IO` would print as info messages, which tiberius does not
+//! surface. Postgres gets the same from `EXPLAIN (ANALYZE, BUFFERS, FORMAT
+//! JSON)`, which executes the statement a second time and returns no rows.
+//! That run is rolled back, but triggers, locks and sequences would still
+//! see a repeated write, so only read-only statements are captured there.
+
+use super::statement;
+use super::{DbConfig, DbType};
+use serde::{Deserialize, Serialize};
+
+/// Column name of the plan result sets under `SET STATISTICS XML ON`.
+const SHOWPLAN_COLUMN: &str = "Microsoft SQL Server 2005 XML Showplan";
+
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
+pub struct QueryPlan {
+    /// `showplan_xml` or `postgres_json`.
+    pub format: String,
+    /// One plan per statement that produced one.
+    pub plans: Vec<String>,
+    pub cpu_ms: Option<f64>,
+    pub elapsed_ms: Option<f64>,
+    /// Pages read from the buffer cache.
+    pub logical_reads: Option<u64>,
+    /// Pages read from disk.
+    pub physical_reads: Option<u64>,
+    /// Why no plan was captured; the query result itself is unaffected.
+    pub error: Option<String>,
+}
+
+impl QueryPlan {
+    fn failed(error: impl ToString) -> Self {
+        Self { error: Some(error.to_string()), ..Default::default() }
+    }
+}
+
+/// Whether a SQL Server result set is a captured plan rather than data.
+pub(super) fn is_showplan(columns: &[tiberius::Column]) -> bool {
+    matches!(columns, [column] if column.name() == SHOWPLAN_COLUMN)
+}
+
+/// Text of a plan row.
+pub(super) fn showplan_text(row: tiberius::Row) -> Option<String> {
+    match row.into_iter().next()? {
+        tiberius::ColumnData::Xml(Some(xml)) => Some(xml.into_owned().into_string()),
+        tiberius::ColumnData::String(Some(s)) => Some(s.into_owned()),
+        _ => None,
+    }
+}
+
+/// Values of `attr` on every `<element ...>` tag.
+fn attr_values<'a>(xml: &'a str, element: &str, attr: &str) -> Vec<&'a str> {
+    let open = format!("<{} ", element);
+    let key = format!(" {}=\"", attr);
+    let mut values = Vec::new();
+    let mut rest = xml;
+    while let Some(at) = rest.find(&open) {
+        rest = &rest[at + open.len() - 1..];
+        let tag = &rest[..rest.find('>').unwrap_or(rest.len())];
+        if let Some(start) = tag.find(&key) {
+            let value = &tag[start + key.len()..];
+            values.push(&value[..value.find('"').unwrap_or(value.len())]);
+        }
+    }
+    values
+}
+
+/// Statistics summed over the plans of a batch.
+pub(super) fn from_showplans(plans: Vec<String>) -> QueryPlan {
+    let sum = |element: &str, attr: &str| -> Option<u64> {
+        let values: Vec<u64> = plans
+            .iter()
+            .flat_map(|plan| attr_values(plan, element, attr))
+            .filter_map(|v| v.parse().ok())
+            .collect();
+        (!values.is_empty()).then(|| values.iter().sum())
+    };
+    let cpu_ms = sum("QueryTimeStats", "CpuTime").map(|ms| ms as f64);
+    let elapsed_ms = sum("QueryTimeStats", "ElapsedTime").map(|ms| ms as f64);
+    let logical_reads = sum("RunTimeCountersPerThread", "ActualLogicalReads");
+    let physical_reads = sum("RunTimeCountersPerThread", "ActualPhysicalReads");
+
+    QueryPlan {
+        format: "showplan_xml".to_string(),
+        plans,
+        cpu_ms,
+        elapsed_ms,
+        logical_reads,
+        physical_reads,
+        error: None,
+    }
+}
+
+/// Statistics of the top plan node, whose buffer counts include its children.
+fn from_postgres_json(json: String) -> anyhow::Result<QueryPlan> {
+    let value: serde_json::Value = serde_json::from_str(&json)?;
+    let top = value.get(0).ok_or_else(|| anyhow::anyhow!("EXPLAIN returned no plan"))?;
+    let node = &top["Plan"];
+    let hit = node["Shared Hit Blocks"].as_u64();
+    let read = node["Shared Read Blocks"].as_u64();
+    let planning = top["Planning Time"].as_f64();
+    let execution = top["Execution Time"].as_f64();
+
+    Ok(QueryPlan {
+        format: "postgres_json".to_string(),
+        plans: vec![json],
+        cpu_ms: None,
+        elapsed_ms: execution.map(|ms| ms + planning.unwrap_or(0.0)),
+        logical_reads: hit.map(|hit| hit + read.unwrap_or(0)),
+        physical_reads: read,
+        error: None,
+    })
+}
+
+/// Run `sql` under `EXPLAIN ANALYZE` in a transaction that is rolled back.
+/// `Any` connections cannot decode the `json` plan column, so this uses a
+/// dedicated Postgres connection.
+async fn explain_postgres(config: &DbConfig, sql: &str) -> anyhow::Result<QueryPlan> {
+    use sqlx::{Connection, Row};
+
+    let mut conn = sqlx::postgres::PgConnection::connect(&config.url).await?;
+    let mut tx = conn.begin().await?;
+    let explain = format!("EXPLAIN (ANALYZE, BUFFERS, FORMAT JSON) {}", sql.trim().trim_end_matches(';'));
+    let row = sqlx::query(&explain).fetch_one(&mut *tx).await?;
+    let json: String = row.try_get_unchecked(0)?;
+    tx.rollback().await?;
+    conn.close().await?;
+    from_postgres_json(json)
+}
+
+/// Plan of `sql` on a sqlx backend, run after the statement itself. Failures
+/// are reported in the plan rather than failing the query.
+pub(super) async fn capture_sqlx(config: &DbConfig, sql: &str) -> QueryPlan {
+    if !statement::read_only(sql) {
+        return QueryPlan::failed("Plan not captured for writes, which it would run a second time");
+    }
+    match config.db_type {
+        DbType::Postgres => explain_postgres(config, sql).await.unwrap_or_else(QueryPlan::failed),
+        _ => QueryPlan::failed(format!("Plan capture is not supported on {}", config.db_type)),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_showplan_statistics_sum_over_statements() {
+        let plan = |cpu: u32, reads: [u32; 2]| {
+            format!(
+                r#"<ShowPlanXML><QueryPlan><QueryTimeStats CpuTime="{cpu}" ElapsedTime="{}" /><RelOp><RunTimeInformation><RunTimeCountersPerThread Thread="0" ActualRows="5" ActualLogicalReads="{}" ActualPhysicalReads="1" /><RunTimeCountersPerThread Thread="1" ActualLogicalReads="{}" ActualPhysicalReads="0" /></RunTimeInformation></RelOp></QueryPlan></ShowPlanXML>"#,
+                cpu + 1,
+                reads[0],
+                reads[1]
+            )
+        };
+        let summary = from_showplans(vec![plan(3, [10, 20]), plan(4, [5, 0])]);
+        assert_eq!(summary.plans.len(), 2);
+        assert_eq!(summary.cpu_ms, Some(7.0));
+        assert_eq!(summary.elapsed_ms, Some(9.0));
+        assert_eq!(summary.logical_reads, Some(35));
+        assert_eq!(summary.physical_reads, Some(2));
+
+        // Estimated-only plans carry no runtime counters
+        let summary = from_showplans(vec!["<ShowPlanXML />".to_string()]);
+        assert_eq!((summary.cpu_ms, summary.logical_reads), (None, None));
+    }
+
+    #[test]
+    fn test_postgres_plan_statistics() {
+        let json = r#"[{"Plan": {"Node Type": "Seq Scan", "Shared Hit Blocks": 12, "Shared Read Blocks": 3},
+            "Planning Time": 0.5, "Execution Time": 2.25}]"#;
+        let summary = from_postgres_json(json.to_string()).unwrap();
+        assert_eq!(summary.elapsed_ms, Some(2.75));
+        assert_eq!(summary.logical_reads, Some(15));
+        assert_eq!(summary.physical_reads, Some(3));
+        assert!(from_postgres_json("[]".to_string()).is_err());
+    }
+}
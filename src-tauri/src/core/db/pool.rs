@@ -0,0 +1,342 @@
+//! Connection reuse for `DbClient`, keyed by `DbConfig.id`.
+//!
+//! SQL Server connections are tiberius clients kept in a small idle list per
+//! connection; the sqlx backends get one `AnyPool` per connection. Entries
+//! remember a fingerprint of the settings they were opened with, so an edited
+//! connection never reuses a stale login.
+
+use super::{parse_jdbc_url, DbConfig};
+use crate::utils::perf;
+use sqlx::any::{AnyConnectOptions, AnyPool, AnyPoolOptions};
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::hash::{Hash, Hasher};
+use std::str::FromStr;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+use tiberius::{AuthMethod, Client, Config};
+use tokio::net::TcpStream;
+use tokio_util::compat::{Compat, TokioAsyncWriteCompatExt};
+
+pub type TdsClient = Client<Compat<TcpStream>>;
+
+/// Idle connections older than this are closed instead of reused.
+const IDLE_TIMEOUT: Duration = Duration::from_secs(300);
+
+/// Idle connections unused for longer than this are pinged before reuse.
+const HEALTH_CHECK_AFTER: Duration = Duration::from_secs(30);
+
+const MAX_IDLE_PER_CONNECTION: usize = 4;
+pub(super) const SQLX_MAX_CONNECTIONS: u32 = 4;
+const REAP_INTERVAL: Duration = Duration::from_secs(60);
+
+/// Identifies the settings a connection was opened with.
+fn fingerprint(config: &DbConfig) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    config.db_type.to_string().hash(&mut hasher);
+    config.url.hash(&mut hasher);
+    config.user.hash(&mut hasher);
+    config.password.hash(&mut hasher);
+    hasher.finish()
+}
+
+// ─── SQL Server ─────────────────────────────────────────────────────────────
+
+/// Open a new SQL Server connection and log in.
+pub async fn connect_mssql(config: &DbConfig) -> anyhow::Result<TdsClient> {
+    let _span = perf::span("connect");
+    let (t_config, tcp) = open_mssql_socket(config).await?;
+    login_mssql(t_config, tcp).await
+}
+
+/// The TCP half of `connect_mssql`.
+pub(super) async fn open_mssql_socket(config: &DbConfig) -> anyhow::Result<(Config, TcpStream)> {
+    let parsed = parse_jdbc_url(&config.url)
+        .map_err(|e| anyhow::anyhow!("Failed to parse JDBC URL: {}", e))?;
+
+    let mut t_config = Config::new();
+    t_config.host(&parsed.host);
+    t_config.port(parsed.port);
+    t_config.authentication(AuthMethod::sql_server(&config.user, &config.password));
+
+    if let Some(inst) = parsed.instance {
+        t_config.instance_name(inst);
+    }
+
+    if let Some(db) = parsed.database {
+        t_config.database(db);
+    }
+
+    if parsed.encrypt {
+         t_config.encryption(tiberius::EncryptionLevel::Required);
+    } else {
+         t_config.encryption(tiberius::EncryptionLevel::NotSupported);
+    }
+
+    if parsed.trust_cert {
+        t_config.trust_cert();
+    }
+
+    let tcp = TcpStream::connect(t_config.get_addr()).await.map_err(|e| anyhow::anyhow!("Failed to connect to {}:{} - {}", parsed.host, parsed.port, e))?;
+    tcp.set_nodelay(true)?;
+    Ok((t_config, tcp))
+}
+
+/// The TDS login half of `connect_mssql`.
+pub(super) async fn login_mssql(t_config: Config, tcp: TcpStream) -> anyhow::Result<TdsClient> {
+    Client::connect(t_config, tcp.compat_write()).await.map_err(|e| anyhow::anyhow!("Login failed: {}", e))
+}
+
+/// Run a batch and discard its results.
+async fn run_batch(client: &mut TdsClient, sql: &str) -> bool {
+    match client.simple_query(sql).await {
+        Ok(stream) => stream.into_results().await.is_ok(),
+        Err(_) => false,
+    }
+}
+
+/// Statements that put a returned connection back into the state a fresh
+/// login would have: no open transaction and the configured database.
+/// tiberius cannot send the TDS reset flag, so temp tables and `SET` options
+/// survive this; callers close connections whose batches may have left those
+/// (`statement::changes_session`) instead of releasing them.
+fn reset_sql(config: &DbConfig) -> String {
+    let mut sql = "IF @@TRANCOUNT > 0 ROLLBACK TRANSACTION".to_string();
+    if let Ok(Some(db)) = parse_jdbc_url(&config.url).map(|p| p.database) {
+        sql.push_str(&format!("; USE [{}]", db.replace(']', "]]")));
+    }
+    sql
+}
+
+struct IdleClient {
+    client: TdsClient,
+    idle_since: Instant,
+}
+
+struct MssqlEntry {
+    fingerprint: u64,
+    idle: Vec<IdleClient>,
+}
+
+#[derive(Default)]
+pub struct MssqlPool {
+    entries: Mutex<HashMap<String, MssqlEntry>>,
+    reaper_started: AtomicBool,
+}
+
+impl MssqlPool {
+    /// Take a healthy idle connection for `config`, or open a new one.
+    pub async fn checkout(self: &Arc<Self>, config: &DbConfig) -> anyhow::Result<PooledClient> {
+        let fingerprint = fingerprint(config);
+
+        while let Some(idle) = self.take_idle(&config.id, fingerprint) {
+            let mut client = idle.client;
+            let healthy = idle.idle_since.elapsed() < HEALTH_CHECK_AFTER || {
+                let _span = perf::span("health_check");
+                run_batch(&mut client, "SELECT 1").await
+            };
+            if healthy {
+                return Ok(self.guard(config, fingerprint, client));
+            }
+            // Dropped by the server or the network; try the next one
+        }
+
+        let client = connect_mssql(config).await?;
+        Ok(self.guard(config, fingerprint, client))
+    }
+
+    /// Open a connection in the background unless one is already idle.
+    pub async fn warm(self: &Arc<Self>, config: &DbConfig) -> anyhow::Result<()> {
+        let fingerprint = fingerprint(config);
+        let has_idle = {
+            let entries = self.entries.lock().unwrap();
+            matches!(entries.get(&config.id), Some(e) if e.fingerprint == fingerprint && !e.idle.is_empty())
+        };
+        if !has_idle {
+            let client = connect_mssql(config).await?;
+            self.checkin(config.id.clone(), fingerprint, client);
+        }
+        Ok(())
+    }
+
+    /// Close every idle connection of `id`, e.g. after it was edited.
+    pub fn invalidate(&self, id: &str) {
+        self.entries.lock().unwrap().remove(id);
+    }
+
+    fn guard(self: &Arc<Self>, config: &DbConfig, fingerprint: u64, client: TdsClient) -> PooledClient {
+        PooledClient {
+            client: Some(client),
+            pool: Arc::clone(self),
+            id: config.id.clone(),
+            fingerprint,
+            reset_sql: reset_sql(config),
+        }
+    }
+
+    fn take_idle(&self, id: &str, fingerprint: u64) -> Option<IdleClient> {
+        let mut entries = self.entries.lock().unwrap();
+        let entry = entries.get_mut(id)?;
+        if entry.fingerprint != fingerprint {
+            entries.remove(id);
+            return None;
+        }
+        entry.idle.retain(|c| c.idle_since.elapsed() < IDLE_TIMEOUT);
+        entry.idle.pop()
+    }
+
+    fn checkin(self: &Arc<Self>, id: String, fingerprint: u64, client: TdsClient) {
+        {
+            let mut entries = self.entries.lock().unwrap();
+            let entry = entries.entry(id).or_insert_with(|| MssqlEntry {
+                fingerprint,
+                idle: Vec::new(),
+            });
+            // The connection was edited while this client was in use
+            if entry.fingerprint != fingerprint || entry.idle.len() >= MAX_IDLE_PER_CONNECTION {
+                return;
+            }
+            entry.idle.push(IdleClient { client, idle_since: Instant::now() });
+        }
+        self.start_reaper();
+    }
+
+    /// Close idle connections past the timeout even if nothing asks for them.
+    fn start_reaper(self: &Arc<Self>) {
+        if self.reaper_started.swap(true, Ordering::Relaxed) {
+            return;
+        }
+        let weak = Arc::downgrade(self);
+        tokio::spawn(async move {
+            loop {
+                tokio::time::sleep(REAP_INTERVAL).await;
+                let Some(pool) = weak.upgrade() else { break };
+                let mut entries = pool.entries.lock().unwrap();
+                for entry in entries.values_mut() {
+                    entry.idle.retain(|c| c.idle_since.elapsed() < IDLE_TIMEOUT);
+                }
+                entries.retain(|_, e| !e.idle.is_empty());
+            }
+        });
+    }
+}
+
+/// A checked-out SQL Server connection. It goes back to the pool only
+/// through `release`; dropping it (e.g. on an error mid-stream) closes it.
+pub struct PooledClient {
+    client: Option<TdsClient>,
+    pool: Arc<MssqlPool>,
+    id: String,
+    fingerprint: u64,
+    reset_sql: String,
+}
+
+impl PooledClient {
+    /// Reset the session in the background and return it to the pool.
+    /// Only call this once every result of the last batch has been read.
+    pub fn release(self) {
+        let PooledClient { client, pool, id, fingerprint, reset_sql } = self;
+        let Some(mut client) = client else { return };
+        tokio::spawn(async move {
+            if run_batch(&mut client, &reset_sql).await {
+                pool.checkin(id, fingerprint, client);
+            }
+        });
+    }
+}
+
+impl std::ops::Deref for PooledClient {
+    type Target = TdsClient;
+
+    fn deref(&self) -> &TdsClient {
+        self.client.as_ref().expect("client taken by release")
+    }
+}
+
+impl std::ops::DerefMut for PooledClient {
+    fn deref_mut(&mut self) -> &mut TdsClient {
+        self.client.as_mut().expect("client taken by release")
+    }
+}
+
+// ─── sqlx ───────────────────────────────────────────────────────────────────
+
+struct SqlxEntry {
+    fingerprint: u64,
+    pool: AnyPool,
+}
+
+#[derive(Default)]
+pub struct SqlxPools {
+    entries: Mutex<HashMap<String, SqlxEntry>>,
+}
+
+impl SqlxPools {
+    /// The pool for `config`, created lazily; connections open on first use.
+    pub fn get(&self, config: &DbConfig) -> anyhow::Result<AnyPool> {
+        let fingerprint = fingerprint(config);
+        let mut entries = self.entries.lock().unwrap();
+        if let Some(entry) = entries.get(&config.id) {
+            if entry.fingerprint == fingerprint && !entry.pool.is_closed() {
+                return Ok(entry.pool.clone());
+            }
+        }
+
+        let opts = AnyConnectOptions::from_str(&config.url)?;
+        let pool = AnyPoolOptions::new()
+            .max_connections(SQLX_MAX_CONNECTIONS)
+            .min_connections(0)
+            .idle_timeout(IDLE_TIMEOUT)
+            .test_before_acquire(true)
+            // A statement may have left a transaction open; a fresh
+            // connection would not have one
+            .after_release(|conn, _meta| {
+                Box::pin(async move {
+                    let _ = sqlx::query("ROLLBACK").execute(&mut *conn).await;
+                    Ok(true)
+                })
+            })
+            .connect_lazy_with(opts);
+
+        // A replaced pool closes once its in-flight queries drop their handles
+        entries.insert(config.id.clone(), SqlxEntry { fingerprint, pool: pool.clone() });
+        Ok(pool)
+    }
+
+    pub fn invalidate(&self, id: &str) {
+        self.entries.lock().unwrap().remove(id);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_fingerprint_changes_with_login() {
+        let config = DbConfig {
+            id: "a".to_string(),
+            url: "jdbc:sqlserver://localhost:1433;databaseName=test".to_string(),
+            user: "sa".to_string(),
+            ..Default::default()
+        };
+        let mut edited = config.clone();
+        assert_eq!(fingerprint(&config), fingerprint(&edited));
+
+        edited.password = "changed".to_string();
+        assert_ne!(fingerprint(&config), fingerprint(&edited));
+    }
+
+    #[test]
+    fn test_reset_sql_restores_database() {
+        let config = DbConfig {
+            url: "jdbc:sqlserver://localhost:1433;databaseName=we]ird".to_string(),
+            ..Default::default()
+        };
+        assert_eq!(
+            reset_sql(&config),
+            "IF @@TRANCOUNT > 0 ROLLBACK TRANSACTION; USE [we]]ird]"
+        );
+    }
+}
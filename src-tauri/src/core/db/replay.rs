@@ -0,0 +1,444 @@
+//! Replaying logged executions of one SQL template with their parameters
+//! bound, as the application sent them, instead of inlined as literals.
+//!
+//! Bound parameters let the server reuse one plan for every execution, so
+//! latencies are comparable to production. SQL Server receives each run as
+//! an `sp_executesql` call (tiberius' `Query`); sqlx backends prepare the
+//! statement once on the connection and execute it per run.
+
+use super::{statement, CellValue, DbClient, DbConfig, DbType};
+use super::control::QueryControl;
+use super::decode::{MssqlDecoder, SqlxDecoder};
+use super::pool::TdsClient;
+use crate::utils::perf;
+use serde::{Deserialize, Serialize};
+use std::time::Instant;
+
+/// One logged execution to replay.
+#[derive(Debug, Clone, Deserialize)]
+pub struct ReplayExecution {
+    pub execution_index: i32,
+    /// Parameters as logged, `TYPE:INDEX:VALUE`.
+    pub params: Vec<String>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct ReplayRun {
+    pub execution_index: i32,
+    pub elapsed_ms: f64,
+    /// Rows returned, or affected for statements without a result set.
+    pub rows: u64,
+    pub error: Option<String>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct ReplayReport {
+    /// The statement as sent, with the driver's placeholders.
+    pub sql: String,
+    /// Time to prepare the statement; `None` on SQL Server, where the first
+    /// run compiles it.
+    pub prepare_ms: Option<f64>,
+    pub runs: Vec<ReplayRun>,
+    pub total_ms: f64,
+}
+
+/// A logged parameter, typed for binding.
+#[derive(Debug, Clone, PartialEq)]
+pub enum BindValue {
+    Null,
+    Text(String),
+    Int(i64),
+    Float(f64),
+    Bool(bool),
+    /// Kept as text so no digits are lost on the way.
+    Decimal(String),
+    Timestamp(String),
+}
+
+impl BindValue {
+    /// Parse `TYPE:INDEX:VALUE` parameters into binding order.
+    pub fn parse_all(params: &[String]) -> anyhow::Result<Vec<BindValue>> {
+        let mut indexed = Vec::with_capacity(params.len());
+        for param in params {
+            let parts: Vec<&str> = param.splitn(3, ':').collect();
+            let [kind, index, value] = parts[..] else {
+                anyhow::bail!("Malformed parameter '{}'", param);
+            };
+            let index: usize = index
+                .parse()
+                .map_err(|_| anyhow::anyhow!("Invalid parameter index in '{}'", param))?;
+            indexed.push((index, Self::parse(kind, value)?));
+        }
+        indexed.sort_by_key(|(index, _)| *index);
+
+        for (expected, (index, _)) in indexed.iter().enumerate() {
+            if *index != expected + 1 {
+                anyhow::bail!("Missing value for position {}", expected + 1);
+            }
+        }
+        Ok(indexed.into_iter().map(|(_, value)| value).collect())
+    }
+
+    fn parse(kind: &str, value: &str) -> anyhow::Result<BindValue> {
+        if value == "null" {
+            return Ok(BindValue::Null);
+        }
+        let invalid = || anyhow::anyhow!("Invalid {} value '{}'", kind, value);
+        Ok(match kind.to_lowercase().as_str() {
+            "int" | "integer" | "long" | "short" | "byte" => {
+                BindValue::Int(value.parse().map_err(|_| invalid())?)
+            }
+            "float" | "double" => BindValue::Float(value.parse().map_err(|_| invalid())?),
+            "boolean" => BindValue::Bool(value.parse().map_err(|_| invalid())?),
+            "bigdecimal" | "number" => BindValue::Decimal(value.to_string()),
+            "timestamp" | "date" | "time" => BindValue::Timestamp(value.to_string()),
+            _ => BindValue::Text(value.to_string()),
+        })
+    }
+
+    fn bind_mssql<'a>(self, query: &mut tiberius::Query<'a>) {
+        use tiberius::time::chrono::{NaiveDate, NaiveDateTime};
+
+        match self {
+            BindValue::Null => query.bind(Option::<String>::None),
+            BindValue::Text(s) => query.bind(s),
+            BindValue::Int(n) => query.bind(n),
+            BindValue::Float(f) => query.bind(f),
+            BindValue::Bool(b) => query.bind(b),
+            BindValue::Decimal(s) => match mssql_numeric(&s) {
+                Some(n) => query.bind(n),
+                None => query.bind(s),
+            },
+            BindValue::Timestamp(s) => {
+                if let Ok(ts) = NaiveDateTime::parse_from_str(&s, "%Y-%m-%d %H:%M:%S%.f") {
+                    query.bind(ts)
+                } else if let Ok(date) = NaiveDate::parse_from_str(&s, "%Y-%m-%d") {
+                    query.bind(date)
+                } else {
+                    query.bind(s)
+                }
+            }
+        }
+    }
+
+    fn bind_sqlx<'q>(
+        self,
+        query: sqlx::query::Query<'q, sqlx::Any, sqlx::any::AnyArguments<'q>>,
+    ) -> sqlx::query::Query<'q, sqlx::Any, sqlx::any::AnyArguments<'q>> {
+        match self {
+            BindValue::Null => query.bind(Option::<String>::None),
+            BindValue::Text(s) | BindValue::Decimal(s) | BindValue::Timestamp(s) => query.bind(s),
+            BindValue::Int(n) => query.bind(n),
+            BindValue::Float(f) => query.bind(f),
+            BindValue::Bool(b) => query.bind(b),
+        }
+    }
+
+    /// Cast appended to a Postgres placeholder. The `Any` driver only binds
+    /// text for these, and Postgres does not compare text to them implicitly.
+    fn postgres_cast(&self) -> &'static str {
+        match self {
+            BindValue::Decimal(_) => "::text::numeric",
+            BindValue::Timestamp(_) => "::text::timestamp",
+            _ => "",
+        }
+    }
+}
+
+/// `-12.50` as a SQL Server numeric with scale 2.
+fn mssql_numeric(s: &str) -> Option<tiberius::numeric::Numeric> {
+    let (int, frac) = s.split_once('.').unwrap_or((s, ""));
+    if !frac.bytes().all(|b| b.is_ascii_digit()) || frac.len() > 37 {
+        return None;
+    }
+    let value: i128 = format!("{}{}", int, frac).parse().ok()?;
+    Some(tiberius::numeric::Numeric::new_with_scale(value, frac.len() as u8))
+}
+
+fn elapsed_ms(start: Instant) -> f64 {
+    start.elapsed().as_secs_f64() * 1000.0
+}
+
+impl DbClient {
+    /// Run `template` (with JDBC `?` placeholders) once per execution, in
+    /// order, on one pooled connection. A failed run is reported and the
+    /// replay goes on; cancellation or a statement timeout ends it.
+    pub async fn replay(
+        &self,
+        config: &DbConfig,
+        template: &str,
+        executions: &[ReplayExecution],
+        control: &QueryControl,
+    ) -> anyhow::Result<ReplayReport> {
+        let start = Instant::now();
+        let report = match config.db_type {
+            DbType::SqlServer => self.replay_mssql(config, template, executions, control).await,
+            _ => self.replay_sqlx(config, template, executions, control).await,
+        };
+        self.invalidate_after(config, template);
+        let mut report = report?;
+        report.total_ms = elapsed_ms(start);
+        Ok(report)
+    }
+
+    async fn replay_mssql(
+        &self,
+        config: &DbConfig,
+        template: &str,
+        executions: &[ReplayExecution],
+        control: &QueryControl,
+    ) -> anyhow::Result<ReplayReport> {
+        let statement = BoundStatement::new(DbType::SqlServer, template, None);
+        let mut client = {
+            let _span = perf::span("connect");
+            self.mssql_executor.pool.checkout(config).await?
+        };
+
+        let mut runs = Vec::with_capacity(executions.len());
+        for execution in executions {
+            let start = Instant::now();
+            // An interrupted run drops `client`, closing its connection
+            let outcome = tokio::select! {
+                res = run_mssql(&mut client, &statement, &execution.params, None) => Ok(res),
+                reason = control.interrupted() => Err(reason),
+            }?;
+            runs.push(ReplayRun::new(execution, start, outcome));
+        }
+        if !statement.changes_session {
+            client.release();
+        }
+
+        Ok(ReplayReport { sql: statement.sql, prepare_ms: None, runs, total_ms: 0.0 })
+    }
+
+    async fn replay_sqlx(
+        &self,
+        config: &DbConfig,
+        template: &str,
+        executions: &[ReplayExecution],
+        control: &QueryControl,
+    ) -> anyhow::Result<ReplayReport> {
+        use sqlx::{Executor, Statement};
+
+        let sample = executions.iter().find_map(|e| BindValue::parse_all(&e.params).ok());
+        let statement = BoundStatement::new(config.db_type.clone(), template, sample.as_deref());
+
+        let pool = self.sqlx_executor.pools.get(config)?;
+        let mut conn = {
+            let _span = perf::span("connect");
+            pool.acquire().await?
+        };
+
+        // An interrupted statement would keep the connection busy; it is
+        // dropped instead of going back to the pool
+        let prepare_start = Instant::now();
+        let prepared = match tokio::select! {
+            res = (&mut *conn).prepare(&statement.sql) => Ok(res),
+            reason = control.interrupted() => Err(reason),
+        } {
+            Ok(res) => res?,
+            Err(reason) => {
+                drop(conn.detach());
+                return Err(reason);
+            }
+        };
+        let prepare_ms = elapsed_ms(prepare_start);
+
+        let mut runs = Vec::with_capacity(executions.len());
+        for execution in executions {
+            let start = Instant::now();
+            let run = run_sqlx(&mut conn, prepared.query(), &statement, &execution.params, None);
+            let outcome = match tokio::select! {
+                res = run => Ok(res),
+                reason = control.interrupted() => Err(reason),
+            } {
+                Ok(res) => res,
+                Err(reason) => {
+                    drop(conn.detach());
+                    return Err(reason);
+                }
+            };
+            runs.push(ReplayRun::new(execution, start, outcome));
+        }
+        drop(prepared);
+        if statement.changes_session {
+            drop(conn.detach());
+        }
+
+        Ok(ReplayReport { sql: statement.sql, prepare_ms: Some(prepare_ms), runs, total_ms: 0.0 })
+    }
+}
+
+impl ReplayRun {
+    fn new(execution: &ReplayExecution, start: Instant, outcome: anyhow::Result<RunOutcome>) -> Self {
+        let elapsed_ms = elapsed_ms(start);
+        let (rows, error) = match outcome {
+            Ok(outcome) => (outcome.rows, None),
+            Err(e) => (0, Some(e.to_string())),
+        };
+        Self { execution_index: execution.execution_index, elapsed_ms, rows, error }
+    }
+}
+
+/// A logged template rewritten with the placeholders of one driver.
+pub(super) struct BoundStatement {
+    pub sql: String,
+    pub placeholders: usize,
+    pub returns_rows: bool,
+    /// The connection must not be reused after it (see
+    /// `statement::changes_session`).
+    pub changes_session: bool,
+}
+
+impl BoundStatement {
+    /// `sample` types the Postgres placeholders (see `postgres_cast`).
+    pub fn new(db_type: DbType, template: &str, sample: Option<&[BindValue]>) -> Self {
+        let (sql, placeholders) = match db_type {
+            DbType::SqlServer => statement::bind_placeholders(template, |n| format!("@P{}", n)),
+            DbType::Postgres => statement::bind_placeholders(template, |n| {
+                let cast = sample
+                    .and_then(|values| values.get(n - 1))
+                    .map_or("", BindValue::postgres_cast);
+                format!("${}{}", n, cast)
+            }),
+            // MySQL and SQLite take `?` as logged
+            DbType::Mysql | DbType::Sqlite => statement::bind_placeholders(template, |_| "?".to_string()),
+        };
+        Self {
+            sql,
+            placeholders,
+            returns_rows: statement::returns_rows(template),
+            changes_session: statement::changes_session(template),
+        }
+    }
+
+    fn bind_values(&self, params: &[String]) -> anyhow::Result<Vec<BindValue>> {
+        let values = BindValue::parse_all(params)?;
+        if values.len() != self.placeholders {
+            anyhow::bail!("Statement takes {} parameters, {} were logged", self.placeholders, values.len());
+        }
+        Ok(values)
+    }
+}
+
+/// What one run of a statement produced.
+#[derive(Debug, Default)]
+pub(super) struct RunOutcome {
+    /// Rows returned, or affected for statements without a result set.
+    pub rows: u64,
+    pub columns: Vec<String>,
+    /// The first row, decoded when a preview was asked for.
+    pub first_row: Option<Vec<CellValue>>,
+}
+
+/// Run `statement` once. Rows are counted, not decoded, unless `preview`
+/// names the connection whose encoding decodes the first one.
+pub(super) async fn run_mssql(
+    client: &mut TdsClient,
+    statement: &BoundStatement,
+    params: &[String],
+    preview: Option<&DbConfig>,
+) -> anyhow::Result<RunOutcome> {
+    use futures_util::stream::TryStreamExt;
+
+    let mut query = tiberius::Query::new(statement.sql.as_str());
+    for value in statement.bind_values(params)? {
+        value.bind_mssql(&mut query);
+    }
+
+    let mut outcome = RunOutcome::default();
+    if !statement.returns_rows {
+        outcome.rows = query.execute(client).await?.total();
+        return Ok(outcome);
+    }
+
+    let mut stream = query.query(client).await?;
+    let mut decoders = Vec::new();
+    if let Some(columns) = stream.columns().await? {
+        outcome.columns = columns.iter().map(|c| c.name().to_string()).collect();
+        if let Some(config) = preview {
+            decoders = MssqlDecoder::for_columns(columns, config.encoding.as_deref());
+        }
+    }
+    while let Some(item) = stream.try_next().await? {
+        if let tiberius::QueryItem::Row(row) = item {
+            if outcome.rows == 0 && preview.is_some() {
+                outcome.first_row = Some(decoders.iter().zip(row).map(|(d, data)| d.decode(data)).collect());
+            }
+            outcome.rows += 1;
+        }
+    }
+    Ok(outcome)
+}
+
+/// Run `query` (`statement` prepared, or its text) once with `params`;
+/// `preview` as for `run_mssql`.
+pub(super) async fn run_sqlx<'q>(
+    conn: &mut sqlx::AnyConnection,
+    mut query: sqlx::query::Query<'q, sqlx::Any, sqlx::any::AnyArguments<'q>>,
+    statement: &BoundStatement,
+    params: &[String],
+    preview: Option<&DbConfig>,
+) -> anyhow::Result<RunOutcome> {
+    use futures_util::stream::TryStreamExt;
+    use sqlx::{Column, Row};
+
+    for value in statement.bind_values(params)? {
+        query = value.bind_sqlx(query);
+    }
+
+    let mut outcome = RunOutcome::default();
+    if !statement.returns_rows {
+        outcome.rows = query.execute(&mut *conn).await?.rows_affected();
+        return Ok(outcome);
+    }
+
+    let mut stream = query.fetch(&mut *conn);
+    while let Some(row) = stream.try_next().await? {
+        if outcome.rows == 0 {
+            outcome.columns = row.columns().iter().map(|c| c.name().to_string()).collect();
+            if let Some(config) = preview {
+                let decoders = SqlxDecoder::for_columns(row.columns(), config.encoding.as_deref());
+                outcome.first_row = Some(decoders.iter().enumerate().map(|(i, d)| d.decode(&row, i)).collect());
+            }
+        }
+        outcome.rows += 1;
+    }
+    Ok(outcome)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_parse_bind_values() {
+        let params = vec![
+            "String:2:O'Brien".to_string(),
+            "Int:1:42".to_string(),
+            "BigDecimal:3:12.50".to_string(),
+            "Timestamp:4:2024-01-01 10:00:00.0".to_string(),
+            "String:5:null".to_string(),
+        ];
+        assert_eq!(
+            BindValue::parse_all(&params).unwrap(),
+            vec![
+                BindValue::Int(42),
+                BindValue::Text("O'Brien".into()),
+                BindValue::Decimal("12.50".into()),
+                BindValue::Timestamp("2024-01-01 10:00:00.0".into()),
+                BindValue::Null,
+            ]
+        );
+
+        assert!(BindValue::parse_all(&["Int:1:abc".to_string()]).is_err());
+        assert!(BindValue::parse_all(&["Int:2:1".to_string()]).is_err());
+    }
+
+    #[test]
+    fn test_mssql_numeric() {
+        let n = mssql_numeric("-12.50").unwrap();
+        assert_eq!((n.value(), n.scale()), (-1250, 2));
+        assert!(mssql_numeric("1e5").is_none());
+    }
+}
@@ -0,0 +1,217 @@
+//! Replaying every statement of one logged ID, writes included, inside a
+//! transaction that is always rolled back.
+//!
+//! Statements run in log order on one pooled connection with their
+//! parameters bound. The first failure stops the replay, since later
+//! statements of a session usually depend on earlier ones. An interrupted
+//! replay closes its connection, which makes the server roll back.
+
+use super::control::QueryControl;
+use super::pool::TdsClient;
+use super::replay::{run_mssql, run_sqlx, BindValue, BoundStatement, RunOutcome};
+use super::{statement, CellValue, DbClient, DbConfig, DbType};
+use crate::utils::perf;
+use serde::{Deserialize, Serialize};
+use std::time::Instant;
+
+/// One logged statement of the session.
+#[derive(Debug, Clone, Deserialize)]
+pub struct SessionStatement {
+    pub execution_index: i32,
+    /// Template with JDBC `?` placeholders.
+    pub sql: String,
+    /// Parameters as logged, `TYPE:INDEX:VALUE`.
+    pub params: Vec<String>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct SessionStep {
+    pub execution_index: i32,
+    pub sql: String,
+    pub elapsed_ms: f64,
+    /// Rows returned, or affected for statements without a result set.
+    pub rows: u64,
+    pub columns: Vec<String>,
+    pub first_row: Option<Vec<CellValue>>,
+    pub error: Option<String>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct SessionReport {
+    pub steps: Vec<SessionStep>,
+    /// Statements not run because an earlier one failed.
+    pub skipped: usize,
+    pub total_ms: f64,
+}
+
+impl SessionStep {
+    fn new(statement: &SessionStatement, start: Instant, outcome: anyhow::Result<RunOutcome>) -> Self {
+        let elapsed_ms = start.elapsed().as_secs_f64() * 1000.0;
+        let (outcome, error) = match outcome {
+            Ok(outcome) => (outcome, None),
+            Err(e) => (RunOutcome::default(), Some(e.to_string())),
+        };
+        Self {
+            execution_index: statement.execution_index,
+            sql: statement.sql.clone(),
+            elapsed_ms,
+            rows: outcome.rows,
+            columns: outcome.columns,
+            first_row: outcome.first_row,
+            error,
+        }
+    }
+}
+
+fn bind(db_type: &DbType, statement: &SessionStatement) -> BoundStatement {
+    let sample = BindValue::parse_all(&statement.params).ok();
+    BoundStatement::new(db_type.clone(), &statement.sql, sample.as_deref())
+}
+
+/// Whether the connection must be closed after the session; its rollback
+/// does not undo `SET` options and the like.
+fn changes_session(statements: &[SessionStatement]) -> bool {
+    statements.iter().any(|s| statement::changes_session(&s.sql))
+}
+
+/// Committing statements would make the rollback a lie; refuse the session.
+fn check_no_commit(statements: &[SessionStatement]) -> anyhow::Result<()> {
+    match statements.iter().find(|s| statement::commits(&s.sql)) {
+        Some(s) => anyhow::bail!(
+            "Execution #{} commits, so the session cannot be rolled back",
+            s.execution_index
+        ),
+        None => Ok(()),
+    }
+}
+
+impl DbClient {
+    /// Run `statements` in order inside a transaction and roll it back.
+    /// The statement timeout applies per statement.
+    pub async fn replay_session(
+        &self,
+        config: &DbConfig,
+        statements: &[SessionStatement],
+        control: &QueryControl,
+    ) -> anyhow::Result<SessionReport> {
+        check_no_commit(statements)?;
+        let start = Instant::now();
+
+        let steps = match config.db_type {
+            DbType::SqlServer => {
+                let mut client = {
+                    let _span = perf::span("connect");
+                    self.mssql_executor.pool.checkout(config).await?
+                };
+                // On error `client` is dropped, closing the connection and
+                // with it the transaction
+                let steps = session_mssql(&mut client, config, statements, control).await?;
+                if !changes_session(statements) {
+                    client.release();
+                }
+                steps
+            }
+            _ => {
+                let pool = self.sqlx_executor.pools.get(config)?;
+                let mut conn = {
+                    let _span = perf::span("connect");
+                    pool.acquire().await?
+                };
+                match session_sqlx(&mut conn, config, statements, control).await {
+                    Ok(steps) => {
+                        if changes_session(statements) {
+                            drop(conn.detach());
+                        }
+                        steps
+                    }
+                    Err(e) => {
+                        drop(conn.detach());
+                        return Err(e);
+                    }
+                }
+            }
+        };
+
+        Ok(SessionReport {
+            skipped: statements.len() - steps.len(),
+            steps,
+            total_ms: start.elapsed().as_secs_f64() * 1000.0,
+        })
+    }
+}
+
+async fn session_mssql(
+    client: &mut TdsClient,
+    config: &DbConfig,
+    statements: &[SessionStatement],
+    control: &QueryControl,
+) -> anyhow::Result<Vec<SessionStep>> {
+    client.execute("BEGIN TRANSACTION", &[]).await?;
+
+    let mut steps = Vec::with_capacity(statements.len());
+    for statement in statements {
+        let bound = bind(&config.db_type, statement);
+        let start = Instant::now();
+        let outcome = tokio::select! {
+            res = run_mssql(client, &bound, &statement.params, Some(config)) => res,
+            reason = control.interrupted() => return Err(reason),
+        };
+        let step = SessionStep::new(statement, start, outcome);
+        let failed = step.error.is_some();
+        steps.push(step);
+        if failed {
+            break;
+        }
+    }
+
+    // A failed statement may already have ended the transaction
+    client.execute("IF @@TRANCOUNT > 0 ROLLBACK TRANSACTION", &[]).await?;
+    Ok(steps)
+}
+
+async fn session_sqlx(
+    conn: &mut sqlx::AnyConnection,
+    config: &DbConfig,
+    statements: &[SessionStatement],
+    control: &QueryControl,
+) -> anyhow::Result<Vec<SessionStep>> {
+    use sqlx::Connection;
+
+    let mut tx = conn.begin().await?;
+
+    let mut steps = Vec::with_capacity(statements.len());
+    for statement in statements {
+        let bound = bind(&config.db_type, statement);
+        let start = Instant::now();
+        let run = run_sqlx(&mut tx, sqlx::query(&bound.sql), &bound, &statement.params, Some(config));
+        let outcome = tokio::select! {
+            res = run => res,
+            reason = control.interrupted() => return Err(reason),
+        };
+        let step = SessionStep::new(statement, start, outcome);
+        let failed = step.error.is_some();
+        steps.push(step);
+        if failed {
+            break;
+        }
+    }
+
+    tx.rollback().await?;
+    Ok(steps)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_sessions_that_commit_are_refused() {
+        let statement = |sql: &str| SessionStatement {
+            execution_index: 1,
+            sql: sql.to_string(),
+            params: Vec::new(),
+        };
+        assert!(check_no_commit(&[statement("UPDATE t SET a = ?"), statement("SELECT 1")]).is_ok());
+        assert!(check_no_commit(&[statement("UPDATE t SET a = ?"), statement("COMMIT")]).is_err());
+    }
+}
@@ -0,0 +1,181 @@
+//! Where executors deliver result rows.
+//!
+//! Executors decode rows as they arrive and hand them to a `ResultSink` in
+//! batches of `ROW_BATCH_SIZE`, so a consumer can start on the first rows
+//! while the rest are still on the wire. A sink that is slow to accept a batch
+//! stops the executor from reading further, which in turn lets the server's
+//! send buffer fill up instead of ours.
+
+use super::{approx_row_size, CellValue, QueryResult, ResultSet};
+use crate::utils::memory::{Charge, Subsystem};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+pub const ROW_BATCH_SIZE: usize = 500;
+
+#[async_trait::async_trait]
+pub trait ResultSink: Send {
+    /// Column names at the start of each result set, before its rows.
+    async fn columns(&mut self, columns: &[String]) -> anyhow::Result<()>;
+
+    /// A batch of decoded rows. `Ok(false)` asks the executor to stop
+    /// reading; the result is then reported as truncated.
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool>;
+}
+
+/// Buffers every row for callers that want the whole `QueryResult`, up to the
+/// global memory budget.
+pub struct CollectSink {
+    rows: Vec<Vec<CellValue>>,
+    charge: Charge,
+}
+
+impl CollectSink {
+    pub fn new() -> Self {
+        Self { rows: Vec::new(), charge: Charge::new(Subsystem::DbResults) }
+    }
+
+    /// Attach the collected rows to the summary returned by the executor.
+    pub fn into_result(self, mut result: QueryResult) -> QueryResult {
+        result.rows = self.rows;
+        result.charge = Some(Arc::new(self.charge));
+        result
+    }
+}
+
+#[async_trait::async_trait]
+impl ResultSink for CollectSink {
+    async fn columns(&mut self, _columns: &[String]) -> anyhow::Result<()> {
+        Ok(())
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        for row in rows {
+            if !self.charge.try_add(approx_row_size(&row)) {
+                return Ok(false);
+            }
+            self.rows.push(row);
+        }
+        Ok(true)
+    }
+}
+
+/// Groups decoded rows into batches for a sink, timing how long the sink
+/// holds the executor up so it is not counted as network wait. Also enforces
+/// the row cap of the statement and counts the rows of each result set.
+pub(super) struct RowBatcher<'a> {
+    sink: &'a mut dyn ResultSink,
+    batch: Vec<Vec<CellValue>>,
+    pushed: u64,
+    max_rows: Option<u64>,
+    pub sink_time: Duration,
+    pub result_sets: Vec<ResultSet>,
+}
+
+impl<'a> RowBatcher<'a> {
+    pub fn new(sink: &'a mut dyn ResultSink, max_rows: Option<u64>) -> Self {
+        Self {
+            sink,
+            batch: Vec::with_capacity(ROW_BATCH_SIZE),
+            pushed: 0,
+            max_rows,
+            sink_time: Duration::ZERO,
+            result_sets: Vec::new(),
+        }
+    }
+
+    /// Start a result set; rows of the previous one go out first, so batches
+    /// never mix sets. `Ok(false)` as for `flush`.
+    pub async fn columns(&mut self, columns: &[String]) -> anyhow::Result<bool> {
+        if !self.flush().await? {
+            return Ok(false);
+        }
+        self.result_sets.push(ResultSet { columns: columns.to_vec(), row_count: 0 });
+        let start = Instant::now();
+        let res = self.sink.columns(columns).await;
+        self.sink_time += start.elapsed();
+        res.map(|()| true)
+    }
+
+    /// Queue a row; `Ok(false)` when the row is past the cap or the sink
+    /// refused the batch it completed. Rows still queued go out with `flush`.
+    pub async fn push(&mut self, row: Vec<CellValue>) -> anyhow::Result<bool> {
+        if self.max_rows.is_some_and(|max| self.pushed >= max) {
+            return Ok(false);
+        }
+        self.pushed += 1;
+        if let Some(set) = self.result_sets.last_mut() {
+            set.row_count += 1;
+        }
+        self.batch.push(row);
+        if self.batch.len() >= ROW_BATCH_SIZE {
+            self.flush().await
+        } else {
+            Ok(true)
+        }
+    }
+
+    pub async fn flush(&mut self) -> anyhow::Result<bool> {
+        if self.batch.is_empty() {
+            return Ok(true);
+        }
+        let batch = std::mem::replace(&mut self.batch, Vec::with_capacity(ROW_BATCH_SIZE));
+        let start = Instant::now();
+        let res = self.sink.rows(batch).await;
+        self.sink_time += start.elapsed();
+        res
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[tokio::test]
+    async fn test_batcher_batches_and_caps_rows() {
+        struct Counting(Vec<usize>);
+
+        #[async_trait::async_trait]
+        impl ResultSink for Counting {
+            async fn columns(&mut self, _columns: &[String]) -> anyhow::Result<()> {
+                Ok(())
+            }
+            async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+                self.0.push(rows.len());
+                Ok(true)
+            }
+        }
+
+        let mut sink = Counting(Vec::new());
+        let mut batcher = RowBatcher::new(&mut sink, None);
+        for i in 0..(ROW_BATCH_SIZE * 2 + 3) {
+            assert!(batcher.push(vec![CellValue::Int(i as i64)]).await.unwrap());
+        }
+        assert!(batcher.flush().await.unwrap());
+        assert_eq!(sink.0, vec![ROW_BATCH_SIZE, ROW_BATCH_SIZE, 3]);
+
+        // A new result set flushes the rows of the previous one
+        let mut sink = Counting(Vec::new());
+        let mut batcher = RowBatcher::new(&mut sink, None);
+        assert!(batcher.columns(&["a".to_string()]).await.unwrap());
+        assert!(batcher.push(vec![CellValue::Int(1)]).await.unwrap());
+        assert!(batcher.columns(&["b".to_string()]).await.unwrap());
+        for i in 0..2 {
+            assert!(batcher.push(vec![CellValue::Int(i)]).await.unwrap());
+        }
+        assert!(batcher.flush().await.unwrap());
+        let counts: Vec<u64> = batcher.result_sets.iter().map(|s| s.row_count).collect();
+        assert_eq!(counts, [1, 2]);
+        assert_eq!(sink.0, vec![1, 2]);
+
+        // The row past the cap is refused; the ones before it still arrive
+        let mut sink = Counting(Vec::new());
+        let mut batcher = RowBatcher::new(&mut sink, Some(3));
+        for i in 0..3 {
+            assert!(batcher.push(vec![CellValue::Int(i)]).await.unwrap());
+        }
+        assert!(!batcher.push(vec![CellValue::Int(3)]).await.unwrap());
+        assert!(batcher.flush().await.unwrap());
+        assert_eq!(sink.0, vec![3]);
+    }
+}
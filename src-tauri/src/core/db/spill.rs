@@ -0,0 +1,277 @@
+//! Spilling large results to disk.
+//!
+//! Past a row or byte threshold, `SpillSink` stops passing rows on and
+//! appends them to a temporary file as columnar frames instead, so neither
+//! side holds more than the threshold in memory. The file keeps an index
+//! of its frames; a page of rows is read back by decoding only the frames
+//! it overlaps. Files are deleted when dropped, and leftovers of a crashed
+//! run when the next one starts.
+
+use super::columnar;
+use super::sink::ResultSink;
+use super::{approx_row_size, CellValue};
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::fs::File;
+use std::io::{Read, Seek, SeekFrom, Write};
+use std::path::PathBuf;
+use std::sync::{Arc, Mutex};
+
+const FILE_PREFIX: &str = "log-helper-spill-";
+
+/// When to start spilling; 0 disables a limit.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct SpillLimits {
+    pub rows: u64,
+    pub bytes: u64,
+}
+
+impl SpillLimits {
+    fn reached(&self, rows: u64, bytes: u64) -> bool {
+        (self.rows > 0 && rows >= self.rows) || (self.bytes > 0 && bytes >= self.bytes)
+    }
+}
+
+/// The rows of one result set that went to disk.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SpilledSet {
+    /// Index of the result set in the script.
+    pub result_set: usize,
+    /// Rows before this one were delivered as usual.
+    pub from_row: u64,
+    pub rows: u64,
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SpillSummary {
+    /// Names the file in `fetch_result_page` and `close_result`.
+    pub result_id: String,
+    pub sets: Vec<SpilledSet>,
+}
+
+#[derive(Debug, Clone, Copy)]
+struct Frame {
+    result_set: usize,
+    first_row: u64,
+    rows: u64,
+    offset: u64,
+    len: usize,
+}
+
+pub struct SpillFile {
+    path: PathBuf,
+    file: Mutex<File>,
+    /// In write order, hence sorted by result set and row.
+    frames: Vec<Frame>,
+    written: u64,
+}
+
+impl SpillFile {
+    fn create(result_id: &str) -> anyhow::Result<Self> {
+        let path = std::env::temp_dir().join(format!("{}{}.bin", FILE_PREFIX, result_id));
+        let file = File::options().read(true).write(true).create(true).truncate(true).open(&path)?;
+        Ok(Self { path, file: Mutex::new(file), frames: Vec::new(), written: 0 })
+    }
+
+    fn append(&mut self, result_set: usize, first_row: u64, rows: &[Vec<CellValue>], column_count: usize) -> anyhow::Result<()> {
+        let frame = columnar::encode_batch(rows, column_count);
+        self.file.get_mut().unwrap().write_all(&frame)?;
+        self.frames.push(Frame { result_set, first_row, rows: rows.len() as u64, offset: self.written, len: frame.len() });
+        self.written += frame.len() as u64;
+        Ok(())
+    }
+
+    /// Up to `limit` rows of `result_set` from row `offset` on, counted from
+    /// the start of the result set. Rows that were not spilled are not here.
+    pub fn page(&self, result_set: usize, offset: u64, limit: u64) -> anyhow::Result<Vec<Vec<CellValue>>> {
+        let end = offset.saturating_add(limit);
+        let first = self
+            .frames
+            .partition_point(|f| (f.result_set, f.first_row + f.rows) <= (result_set, offset));
+        let mut file = self.file.lock().unwrap();
+        let mut rows = Vec::new();
+        for frame in self.frames[first..].iter().take_while(|f| f.result_set == result_set && f.first_row < end) {
+            let mut buf = vec![0; frame.len];
+            file.seek(SeekFrom::Start(frame.offset))?;
+            file.read_exact(&mut buf)?;
+            let skip = offset.saturating_sub(frame.first_row) as usize;
+            let take = (end - frame.first_row.max(offset)) as usize;
+            rows.extend(columnar::decode_batch(&buf)?.into_iter().skip(skip).take(take));
+        }
+        Ok(rows)
+    }
+}
+
+impl Drop for SpillFile {
+    fn drop(&mut self) {
+        let _ = std::fs::remove_file(&self.path);
+    }
+}
+
+/// Spill files of finished queries, by result ID.
+pub struct SpillStore {
+    files: Mutex<HashMap<String, Arc<SpillFile>>>,
+}
+
+impl SpillStore {
+    /// Also deletes files a previous run left behind.
+    pub fn new() -> Self {
+        if let Ok(entries) = std::fs::read_dir(std::env::temp_dir()) {
+            for entry in entries.flatten() {
+                if entry.file_name().to_string_lossy().starts_with(FILE_PREFIX) {
+                    let _ = std::fs::remove_file(entry.path());
+                }
+            }
+        }
+        Self { files: Mutex::new(HashMap::new()) }
+    }
+
+    pub fn insert(&self, result_id: String, file: SpillFile) {
+        self.files.lock().unwrap().insert(result_id, Arc::new(file));
+    }
+
+    pub fn get(&self, result_id: &str) -> Option<Arc<SpillFile>> {
+        self.files.lock().unwrap().get(result_id).cloned()
+    }
+
+    /// Forget a result; its file is deleted once no page read holds it.
+    pub fn close(&self, result_id: &str) {
+        self.files.lock().unwrap().remove(result_id);
+    }
+}
+
+/// Passes rows on until `limits` are reached, then writes the rest to a
+/// spill file. Column names of later result sets are still passed on.
+pub struct SpillSink<'a> {
+    inner: &'a mut dyn ResultSink,
+    limits: SpillLimits,
+    result_id: String,
+    passed_rows: u64,
+    passed_bytes: u64,
+    /// Index, row count so far and width of the current result set.
+    result_set: Option<usize>,
+    set_rows: u64,
+    column_count: usize,
+    file: Option<SpillFile>,
+    sets: Vec<SpilledSet>,
+}
+
+impl<'a> SpillSink<'a> {
+    pub fn new(inner: &'a mut dyn ResultSink, limits: SpillLimits, result_id: &str) -> Self {
+        Self {
+            inner,
+            limits,
+            result_id: result_id.to_string(),
+            passed_rows: 0,
+            passed_bytes: 0,
+            result_set: None,
+            set_rows: 0,
+            column_count: 0,
+            file: None,
+            sets: Vec::new(),
+        }
+    }
+
+    /// The spill file and what went into it, if anything was spilled.
+    pub fn finish(self) -> Option<(SpillFile, SpillSummary)> {
+        let file = self.file?;
+        Some((file, SpillSummary { result_id: self.result_id, sets: self.sets }))
+    }
+}
+
+#[async_trait::async_trait]
+impl ResultSink for SpillSink<'_> {
+    async fn columns(&mut self, columns: &[String]) -> anyhow::Result<()> {
+        self.result_set = Some(self.result_set.map_or(0, |i| i + 1));
+        self.set_rows = 0;
+        self.column_count = columns.len();
+        self.inner.columns(columns).await
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        let count = rows.len() as u64;
+        let result_set = self.result_set.unwrap_or(0);
+        if self.file.is_none() && !self.limits.reached(self.passed_rows, self.passed_bytes) {
+            self.passed_rows += count;
+            self.passed_bytes += rows.iter().map(|r| approx_row_size(r) as u64).sum::<u64>();
+            self.set_rows += count;
+            return self.inner.rows(rows).await;
+        }
+
+        let file = match &mut self.file {
+            Some(file) => file,
+            None => self.file.insert(SpillFile::create(&self.result_id)?),
+        };
+        file.append(result_set, self.set_rows, &rows, self.column_count)?;
+        match self.sets.last_mut() {
+            Some(set) if set.result_set == result_set => set.rows += count,
+            _ => self.sets.push(SpilledSet { result_set, from_row: self.set_rows, rows: count }),
+        }
+        self.set_rows += count;
+        Ok(true)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    struct Counting(u64);
+
+    #[async_trait::async_trait]
+    impl ResultSink for Counting {
+        async fn columns(&mut self, _columns: &[String]) -> anyhow::Result<()> {
+            Ok(())
+        }
+
+        async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+            self.0 += rows.len() as u64;
+            Ok(true)
+        }
+    }
+
+    fn batch(from: i64, len: i64) -> Vec<Vec<CellValue>> {
+        (from..from + len).map(|i| vec![CellValue::Int(i), CellValue::Text(format!("r{}", i))]).collect()
+    }
+
+    #[tokio::test]
+    async fn test_rows_past_the_limit_are_paged_from_disk() {
+        let mut inner = Counting(0);
+        let limits = SpillLimits { rows: 150, bytes: 0 };
+        let mut sink = SpillSink::new(&mut inner, limits, &uuid::Uuid::new_v4().to_string());
+        let columns = ["id".to_string(), "name".to_string()];
+        sink.columns(&columns).await.unwrap();
+        for start in (0..1000).step_by(100) {
+            assert!(sink.rows(batch(start, 100)).await.unwrap());
+        }
+        sink.columns(&columns).await.unwrap();
+        sink.rows(batch(0, 30)).await.unwrap();
+        let (file, summary) = sink.finish().expect("spilled");
+        assert_eq!(inner.0, 200, "whole batches until the limit");
+
+        let sets: Vec<_> = summary.sets.iter().map(|s| (s.result_set, s.from_row, s.rows)).collect();
+        assert_eq!(sets, vec![(0, 200, 800), (1, 0, 30)]);
+
+        let page = file.page(0, 250, 120).unwrap();
+        assert_eq!(page.len(), 120);
+        assert!(matches!(page[0][0], CellValue::Int(250)));
+        assert!(matches!(page[119][0], CellValue::Int(369)));
+        assert_eq!(file.page(0, 950, 100).unwrap().len(), 50);
+        assert!(matches!(file.page(1, 10, 5).unwrap()[0][0], CellValue::Int(10)));
+        assert!(file.page(2, 0, 5).unwrap().is_empty());
+
+        let path = file.path.clone();
+        drop(file);
+        assert!(!path.exists());
+    }
+
+    #[tokio::test]
+    async fn test_nothing_spills_under_the_limit() {
+        let mut inner = Counting(0);
+        let mut sink = SpillSink::new(&mut inner, SpillLimits::default(), "unused");
+        sink.columns(&["id".to_string()]).await.unwrap();
+        sink.rows(batch(0, 500)).await.unwrap();
+        assert!(sink.finish().is_none());
+        assert_eq!(inner.0, 500);
+    }
+}
@@ -0,0 +1,437 @@
+//! Lexical inspection of SQL text, for decisions that have to be made before
+//! a batch is sent. Only words, parentheses, `;`, `?` and `GO` lines are
+//! recognised; comments, string literals and quoted identifiers are skipped.
+
+/// Leading verbs of statements that return no result set.
+const NON_QUERY_VERBS: &[&str] = &[
+    "INSERT", "UPDATE", "DELETE", "MERGE", "TRUNCATE", "CREATE", "ALTER", "DROP", "SET",
+    "DECLARE", "USE", "GRANT", "REVOKE", "DENY", "BEGIN", "COMMIT", "ROLLBACK", "SAVE",
+];
+
+/// Besides the non-query verbs, words that make a batch more than a read.
+const NOT_READ_ONLY_WORDS: &[&str] = &["INTO", "EXEC", "EXECUTE", "OUTPUT", "WAITFOR"];
+
+/// If a comment, string literal or quoted identifier starts at `i`, the index
+/// just past it.
+fn skip_inert(bytes: &[u8], mut i: usize) -> Option<usize> {
+    match bytes[i] {
+        b'-' if bytes.get(i + 1) == Some(&b'-') => {
+            while i < bytes.len() && bytes[i] != b'\n' {
+                i += 1;
+            }
+            Some(i)
+        }
+        b'/' if bytes.get(i + 1) == Some(&b'*') => {
+            // T-SQL block comments nest
+            let mut nesting = 0;
+            while i < bytes.len() {
+                if bytes[i] == b'/' && bytes.get(i + 1) == Some(&b'*') {
+                    nesting += 1;
+                    i += 2;
+                } else if bytes[i] == b'*' && bytes.get(i + 1) == Some(&b'/') {
+                    nesting -= 1;
+                    i += 2;
+                    if nesting == 0 {
+                        break;
+                    }
+                } else {
+                    i += 1;
+                }
+            }
+            Some(i)
+        }
+        quote @ (b'\'' | b'"' | b'[' | b'`') => {
+            let close = if quote == b'[' { b']' } else { quote };
+            i += 1;
+            while i < bytes.len() {
+                if bytes[i] == close {
+                    // A doubled closing quote is an escaped one
+                    if bytes.get(i + 1) == Some(&close) {
+                        i += 1;
+                    } else {
+                        break;
+                    }
+                }
+                i += 1;
+            }
+            Some((i + 1).min(bytes.len()))
+        }
+        _ => None,
+    }
+}
+
+/// Words and `;` outside parentheses, upper-cased.
+fn top_level_words(sql: &str) -> Vec<String> {
+    let bytes = sql.as_bytes();
+    let mut words = Vec::new();
+    let mut depth = 0usize;
+    let mut i = 0;
+
+    // Only ASCII is matched, so multi-byte UTF-8 sequences are passed over
+    // byte by byte without splitting anything that matters
+    while i < bytes.len() {
+        if let Some(next) = skip_inert(bytes, i) {
+            i = next;
+            continue;
+        }
+        match bytes[i] {
+            b'(' => depth += 1,
+            b')' => depth = depth.saturating_sub(1),
+            b';' if depth == 0 => words.push(";".to_string()),
+            c if c.is_ascii_alphabetic() || c == b'_' || c == b'@' || c == b'#' => {
+                let start = i;
+                while i < bytes.len()
+                    && (bytes[i].is_ascii_alphanumeric() || matches!(bytes[i], b'_' | b'@' | b'#' | b'$'))
+                {
+                    i += 1;
+                }
+                if depth == 0 {
+                    words.push(sql[start..i].to_ascii_uppercase());
+                }
+                continue;
+            }
+            _ => {}
+        }
+        i += 1;
+    }
+    words
+}
+
+/// Repeat count of a `GO` separator line (`GO` or `GO n`), as SSMS and
+/// sqlcmd accept it.
+fn go_count(line: &str) -> Option<usize> {
+    let line = line.split("--").next().unwrap_or("");
+    let mut words = line.split_whitespace();
+    if !words.next()?.eq_ignore_ascii_case("GO") {
+        return None;
+    }
+    match (words.next(), words.next()) {
+        (None, _) => Some(1),
+        (Some(count), None) => count.parse().ok().filter(|&n| n > 0),
+        _ => None,
+    }
+}
+
+/// Split a script into the batches between its `GO` lines, repeating a
+/// batch for `GO n`. `GO` inside comments and literals does not count;
+/// empty batches are dropped.
+pub fn split_batches(script: &str) -> Vec<String> {
+    let bytes = script.as_bytes();
+    let mut batches = Vec::new();
+    let mut push = |batch: &str, count: usize| {
+        if !batch.trim().is_empty() {
+            batches.extend(std::iter::repeat(batch.trim().to_string()).take(count));
+        }
+    };
+    let mut start = 0;
+    let mut line_start = true;
+    let mut i = 0;
+
+    while i < bytes.len() {
+        if line_start {
+            line_start = false;
+            let end = script[i..].find('\n').map_or(bytes.len(), |n| i + n);
+            if let Some(count) = go_count(&script[i..end]) {
+                push(&script[start..i], count);
+                start = end;
+                i = end;
+                continue;
+            }
+        }
+        if let Some(next) = skip_inert(bytes, i) {
+            i = next;
+            continue;
+        }
+        if bytes[i] == b'\n' {
+            line_start = true;
+        }
+        i += 1;
+    }
+    push(&script[start..], 1);
+    batches
+}
+
+/// Whether a batch only reads: queries, with no writes, `SELECT INTO`,
+/// variables or procedure calls. Such batches can share a round trip.
+pub fn read_only(sql: &str) -> bool {
+    let words = top_level_words(sql);
+    matches!(words.first().map(String::as_str), Some("SELECT" | "WITH"))
+        && !words.iter().any(|w| {
+            NON_QUERY_VERBS.contains(&w.as_str()) || NOT_READ_ONLY_WORDS.contains(&w.as_str()) || w.starts_with('@')
+        })
+}
+
+/// `sql` without its trailing comments, whitespace and `;`.
+fn trim_statement_end(sql: &str) -> &str {
+    let bytes = sql.as_bytes();
+    let mut end = 0;
+    let mut i = 0;
+    while i < bytes.len() {
+        if let Some(next) = skip_inert(bytes, i) {
+            if !matches!(&bytes[i..(i + 2).min(bytes.len())], b"--" | b"/*") {
+                end = next;
+            }
+            i = next;
+            continue;
+        }
+        if !bytes[i].is_ascii_whitespace() && bytes[i] != b';' {
+            end = i + 1;
+        }
+        i += 1;
+    }
+    // `end` follows an ASCII byte or a closing quote, so it is a char boundary
+    &sql[..end]
+}
+
+/// Whether a batch can share a round trip with its neighbours: it only
+/// reads and does not start with a CTE, whose `WITH` needs the statement
+/// before it terminated. Variables are batch-scoped, so `read_only` already
+/// excludes `DECLARE`.
+fn pipelinable(sql: &str) -> bool {
+    read_only(sql) && top_level_words(sql).first().map(String::as_str) != Some("WITH")
+}
+
+/// Join each run of consecutive pipelinable batches into one script, each
+/// statement terminated by a `;` line, so it is sent in one round trip on
+/// one connection. Other batches stay as they are, keeping their own batch
+/// scope.
+pub fn pipeline(batches: Vec<String>) -> Vec<String> {
+    let mut out: Vec<String> = Vec::with_capacity(batches.len());
+    let mut last_joinable = false;
+    for batch in batches {
+        let joinable = pipelinable(&batch);
+        match out.last_mut() {
+            Some(last) if joinable && last_joinable => {
+                // A trailing `--` comment would swallow anything on its line
+                last.truncate(trim_statement_end(last).len());
+                last.push_str("\n;\n");
+                last.push_str(&batch);
+            }
+            _ => out.push(batch),
+        }
+        last_joinable = joinable;
+    }
+    out
+}
+
+/// `sql` with whitespace runs outside literals and comments collapsed to one
+/// space and trailing `;` dropped, so reformatted copies of a query compare
+/// equal. The line break ending a `--` comment is kept as one, since the
+/// comment would otherwise swallow what follows.
+pub fn normalize(sql: &str) -> String {
+    let sql = sql.trim();
+    let bytes = sql.as_bytes();
+    let mut out = String::with_capacity(sql.len());
+    let mut after_line_comment = false;
+    let mut i = 0;
+    while i < bytes.len() {
+        if let Some(next) = skip_inert(bytes, i) {
+            after_line_comment = sql[i..].starts_with("--");
+            let inert = &sql[i..next];
+            out.push_str(if after_line_comment { inert.trim_end_matches('\r') } else { inert });
+            i = next;
+            continue;
+        }
+        let start = i;
+        while i < bytes.len() && bytes[i].is_ascii_whitespace() {
+            i += 1;
+        }
+        if i > start {
+            out.push(if std::mem::take(&mut after_line_comment) { '\n' } else { ' ' });
+            continue;
+        }
+        // Copy up to the next byte of interest, keeping UTF-8 sequences whole
+        while i < bytes.len() && !bytes[i].is_ascii_whitespace() && skip_inert(bytes, i).is_none() {
+            i += 1;
+        }
+        out.push_str(&sql[start..i]);
+    }
+    out.trim_end_matches(|c: char| c == ';' || c.is_ascii_whitespace()).to_string()
+}
+
+/// Whether a batch may leave session state behind that a pooled connection's
+/// reset (rollback and `USE`) does not clear: temporary tables, `SET`
+/// options, context info, impersonation or cursors. Such connections are
+/// closed instead of reused. Errs towards `true`.
+pub fn changes_session(sql: &str) -> bool {
+    let words = top_level_words(sql);
+    // The first `SET` after an `UPDATE` (or `MERGE ... UPDATE`) is its own
+    let mut update_set = false;
+    for (i, word) in words.iter().enumerate() {
+        let next = words.get(i + 1).map_or("", String::as_str);
+        let previous = if i > 0 { words[i - 1].as_str() } else { "" };
+        match word.as_str() {
+            w if w.starts_with('#') => return true,
+            "TEMP" | "TEMPORARY" if matches!(previous, "CREATE" | "GLOBAL" | "LOCAL" | "INTO") => return true,
+            "UPDATE" => update_set = next != "STATISTICS",
+            "SET" if update_set => update_set = false,
+            // `SET @var` is batch-scoped; `SET @@var` and options are not
+            "SET" if !next.starts_with('@') || next.starts_with("@@") => return true,
+            "EXEC" | "EXECUTE" if next == "AS" => return true,
+            "SETUSER" | "SP_SET_SESSION_CONTEXT" | "SP_SETAPPROLE" | "CURSOR" => return true,
+            ";" => update_set = false,
+            _ => {}
+        }
+    }
+    false
+}
+
+/// Whether a batch ends the transaction it runs in, so a replay inside one
+/// could not roll it back.
+pub fn commits(sql: &str) -> bool {
+    top_level_words(sql).iter().any(|w| w == "COMMIT")
+}
+
+/// Replace JDBC `?` placeholders with `placeholder(n)` (1-based), leaving
+/// literals, quoted identifiers and comments alone. Also returns how many
+/// there were.
+pub fn bind_placeholders(sql: &str, mut placeholder: impl FnMut(usize) -> String) -> (String, usize) {
+    let bytes = sql.as_bytes();
+    let mut out = String::with_capacity(sql.len() + 16);
+    let mut count = 0;
+    let mut copied = 0;
+    let mut i = 0;
+
+    while i < bytes.len() {
+        if let Some(next) = skip_inert(bytes, i) {
+            i = next;
+            continue;
+        }
+        if bytes[i] == b'?' {
+            count += 1;
+            out.push_str(&sql[copied..i]);
+            out.push_str(&placeholder(count));
+            copied = i + 1;
+        }
+        i += 1;
+    }
+    out.push_str(&sql[copied..]);
+    (out, count)
+}
+
+/// Whether a batch may return a result set, so executors can pick the one
+/// call that sends it. Errs towards `true`: a false positive only loses the
+/// affected-row count, a false negative would lose rows.
+pub fn returns_rows(sql: &str) -> bool {
+    let words = top_level_words(sql);
+    match words.first() {
+        None => return false,
+        Some(first) if !NON_QUERY_VERBS.contains(&first.as_str()) => return true,
+        Some(_) => {}
+    }
+
+    // The first SELECT after an INSERT (and those set operators join to it)
+    // feeds the insert; any other top-level SELECT is a query of its own
+    let mut in_insert = false;
+    for (i, word) in words.iter().enumerate() {
+        let previous = if i > 0 { words[i - 1].as_str() } else { "" };
+        match word.as_str() {
+            "OUTPUT" | "RETURNING" | "EXEC" | "EXECUTE" => return true,
+            "SELECT" if in_insert => in_insert = false,
+            "SELECT" if matches!(previous, "UNION" | "ALL" | "EXCEPT" | "INTERSECT") => {}
+            "SELECT" => return true,
+            "INSERT" => in_insert = true,
+            "VALUES" | ";" => in_insert = false,
+            _ => {}
+        }
+    }
+    false
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_returns_rows() {
+        assert!(returns_rows("SELECT * FROM users"));
+        assert!(returns_rows("-- DAO query\n/* nested /* comment */ */ select 1"));
+        assert!(returns_rows("WITH t AS (SELECT 1 AS a) SELECT a FROM t"));
+        assert!(returns_rows("UPDATE users SET name = 'x'; SELECT * FROM users"));
+        assert!(returns_rows("INSERT INTO t VALUES (1) SELECT * FROM t"));
+        assert!(returns_rows("DELETE FROM t OUTPUT deleted.id WHERE id = 1"));
+        assert!(returns_rows("INSERT INTO t SELECT * FROM s SELECT * FROM t"));
+
+        assert!(!returns_rows("UPDATE users SET name = 'SELECT' WHERE id = (SELECT MAX(id) FROM users)"));
+        assert!(!returns_rows("INSERT INTO [select] (a) SELECT a FROM src"));
+        assert!(!returns_rows("INSERT INTO t (a) SELECT a FROM s UNION ALL SELECT b FROM s2"));
+        assert!(!returns_rows("SET NOCOUNT ON; DELETE FROM t -- SELECT\n"));
+        assert!(!returns_rows("   "));
+    }
+
+    #[test]
+    fn test_split_batches() {
+        let script = "CREATE PROC p AS SELECT 1\ngo\n\nSELECT 'GO\nGO'\n/*\nGO\n*/\n  GO 2 -- twice\nSELECT 2\nGO\n";
+        assert_eq!(
+            split_batches(script),
+            ["CREATE PROC p AS SELECT 1", "SELECT 'GO\nGO'\n/*\nGO\n*/", "SELECT 'GO\nGO'\n/*\nGO\n*/", "SELECT 2"]
+        );
+        assert_eq!(split_batches("SELECT 1 AS go"), ["SELECT 1 AS go"]);
+        assert!(split_batches("GO\n  \nGO").is_empty());
+    }
+
+    #[test]
+    fn test_pipeline_joins_read_only_runs() {
+        assert!(read_only("WITH t AS (SELECT 1 AS a) SELECT a FROM t; SELECT 2"));
+        assert!(!read_only("SELECT * INTO #t FROM users"));
+        assert!(!read_only("SELECT @n = COUNT(*) FROM users"));
+        assert!(!read_only("UPDATE users SET name = 'x'"));
+
+        let join = |batches: &[&str]| pipeline(batches.iter().map(|b| b.to_string()).collect());
+        let batches = join(&["SELECT 1", "SELECT 2", "DECLARE @n INT = 1", "SELECT 3", "SELECT 4;"]);
+        assert_eq!(batches, ["SELECT 1\n;\nSELECT 2", "DECLARE @n INT = 1", "SELECT 3\n;\nSELECT 4;"]);
+
+        // A CTE needs the statement before it terminated, so it goes alone
+        let batches = join(&["SELECT 1", "WITH t AS (SELECT 1 AS a) SELECT a FROM t", "SELECT 2"]);
+        assert_eq!(batches, ["SELECT 1", "WITH t AS (SELECT 1 AS a) SELECT a FROM t", "SELECT 2"]);
+
+        // The `;` must not end up inside a trailing comment
+        let batches = join(&["SELECT '--' AS a; -- first\n/* done */", "SELECT 2"]);
+        assert_eq!(batches, ["SELECT '--' AS a\n;\nSELECT 2"]);
+    }
+
+    #[test]
+    fn test_normalize() {
+        assert_eq!(
+            normalize("  SELECT *\n\tFROM  users\r\n WHERE name = 'a  b' -- x  y\n;; "),
+            "SELECT * FROM users WHERE name = 'a  b' -- x  y"
+        );
+        assert_eq!(normalize("SELECT a -- x\r\n   FROM t1"), "SELECT a -- x\nFROM t1");
+        assert_eq!(normalize("SELECT 'é'  ,1"), "SELECT 'é' ,1");
+    }
+
+    #[test]
+    fn test_changes_session() {
+        assert!(changes_session("SELECT * INTO #t FROM users"));
+        assert!(changes_session("CREATE TABLE #t (id INT)"));
+        assert!(changes_session("SET IDENTITY_INSERT t ON"));
+        assert!(changes_session("UPDATE t SET a = 1 SET LANGUAGE us_english"));
+        assert!(changes_session("SET CONTEXT_INFO 0x01"));
+        assert!(changes_session("EXECUTE AS USER = 'app'"));
+        assert!(changes_session("CREATE TEMP TABLE t AS SELECT 1"));
+
+        assert!(!changes_session("SELECT * FROM users WHERE name = '#t'"));
+        assert!(!changes_session("UPDATE users SET name = 'x' WHERE id = 1"));
+        assert!(!changes_session("DECLARE @n INT; SET @n = 1; SELECT @n"));
+        assert!(!changes_session("MERGE t USING s ON t.id = s.id WHEN MATCHED THEN UPDATE SET a = s.a;"));
+        assert!(!changes_session("SELECT temp FROM readings"));
+    }
+
+    #[test]
+    fn test_commits() {
+        assert!(commits("UPDATE t SET a = 1; COMMIT"));
+        assert!(commits("commit transaction"));
+        assert!(!commits("INSERT INTO audit (action) VALUES ('COMMIT')"));
+    }
+
+    #[test]
+    fn test_bind_placeholders() {
+        let (sql, count) = bind_placeholders(
+            "SELECT '?', [a?] FROM t /* ? */ WHERE a = ? -- ?\n AND b IN (?, ?)",
+            |n| format!("@P{}", n),
+        );
+        assert_eq!(sql, "SELECT '?', [a?] FROM t /* ? */ WHERE a = @P1 -- ?\n AND b IN (@P2, @P3)");
+        assert_eq!(count, 3);
+        assert_eq!(bind_placeholders("SELECT 1", |n| n.to_string()), ("SELECT 1".to_string(), 0));
+    }
+}
@@ -0,0 +1,702 @@
+//! Sort, filter and aggregate over result sets kept in the backend.
+//!
+//! `RetainSink` keeps a copy of the rows it passes on, charged to the memory
+//! budget, so the webview can ask for a sorted or filtered page instead of
+//! holding every row itself. Large sets are filtered and sorted on several
+//! threads, each taking a slice of the rows; sorted slices are then merged.
+//! The row order of the last view is kept, so paging through it does not
+//! sort again.
+
+use super::sink::ResultSink;
+use super::{approx_row_size, CellValue};
+use crate::utils::memory::{Charge, Subsystem};
+use serde::{Deserialize, Serialize};
+use std::borrow::Cow;
+use std::cmp::Ordering;
+use std::collections::{HashMap, VecDeque};
+use std::sync::{Arc, Mutex};
+
+/// Results kept at most; the oldest is dropped first.
+const MAX_RETAINED: usize = 4;
+/// Sets smaller than this are sorted and filtered on the calling thread.
+const PARALLEL_MIN_ROWS: usize = 50_000;
+/// Groups returned by an aggregate at most.
+const MAX_GROUPS: usize = 10_000;
+
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct SortKey {
+    pub column: usize,
+    #[serde(default)]
+    pub descending: bool,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum FilterOp {
+    /// Case-insensitive substring of the cell text.
+    Contains,
+    Equals,
+    NotEquals,
+    Greater,
+    Less,
+    IsNull,
+    NotNull,
+}
+
+/// A predicate on one column. `value` is compared as a number against
+/// numeric cells and as text otherwise; NULL matches only `IsNull`.
+#[derive(Debug, Clone, PartialEq, Deserialize)]
+pub struct ColumnFilter {
+    pub column: usize,
+    pub op: FilterOp,
+    #[serde(default)]
+    pub value: String,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct ViewRequest {
+    pub result_set: usize,
+    #[serde(default)]
+    pub sort: Vec<SortKey>,
+    #[serde(default)]
+    pub filters: Vec<ColumnFilter>,
+    pub offset: u64,
+    pub limit: u64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct ViewPage {
+    pub rows: Vec<Vec<CellValue>>,
+    /// Rows matching the filters.
+    pub matched: u64,
+    /// Rows the view was computed over.
+    pub retained: u64,
+    /// Every fetched row was retained; otherwise the view covers only the
+    /// first `retained`.
+    pub complete: bool,
+}
+
+#[derive(Debug, Clone, Copy, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum AggregateOp {
+    Count,
+    Sum,
+    Min,
+    Max,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct Aggregate {
+    pub op: AggregateOp,
+    /// `None` with `Count` counts rows; otherwise NULLs are skipped.
+    #[serde(default)]
+    pub column: Option<usize>,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+pub struct AggregateRequest {
+    pub result_set: usize,
+    #[serde(default)]
+    pub group_by: Vec<usize>,
+    pub aggregates: Vec<Aggregate>,
+    #[serde(default)]
+    pub filters: Vec<ColumnFilter>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct AggregateResult {
+    pub columns: Vec<String>,
+    /// One row per group, ordered by the group columns.
+    pub rows: Vec<Vec<CellValue>>,
+    /// More than `MAX_GROUPS` groups; the rest are left out.
+    pub truncated: bool,
+}
+
+// ─── Comparison ─────────────────────────────────────────────────────────────
+
+fn number(cell: &CellValue) -> Option<f64> {
+    match cell {
+        CellValue::Int(n) => Some(*n as f64),
+        CellValue::Float(f) => Some(*f),
+        CellValue::Decimal(s) => s.parse().ok(),
+        _ => None,
+    }
+}
+
+fn text(cell: &CellValue) -> Cow<'_, str> {
+    match cell {
+        CellValue::Text(s) | CellValue::DateTime(s) | CellValue::Binary(s) | CellValue::Decimal(s) => Cow::Borrowed(s),
+        other => Cow::Owned(other.to_string()),
+    }
+}
+
+/// Sort class of a cell: NULL, booleans, numbers, then everything else as
+/// text. A decimal that does not parse counts as text.
+fn class(cell: &CellValue) -> u8 {
+    match cell {
+        CellValue::Null => 0,
+        CellValue::Bool(_) => 1,
+        CellValue::Int(_) | CellValue::Float(_) => 2,
+        CellValue::Decimal(_) if number(cell).is_some() => 2,
+        _ => 3,
+    }
+}
+
+/// Total order over cells: by class, then numbers by value and the rest as
+/// text.
+fn compare_cells(a: &CellValue, b: &CellValue) -> Ordering {
+    class(a).cmp(&class(b)).then_with(|| match (a, b) {
+        (CellValue::Int(x), CellValue::Int(y)) => x.cmp(y),
+        (CellValue::Bool(x), CellValue::Bool(y)) => x.cmp(y),
+        _ => match (number(a), number(b)) {
+            // Equal values of different kinds go by kind, as large ints round
+            // to the same float and would otherwise break transitivity
+            (Some(x), Some(y)) => x.total_cmp(&y).then_with(|| numeric_kind(a).cmp(&numeric_kind(b))),
+            _ => text(a).cmp(&text(b)),
+        },
+    })
+}
+
+fn numeric_kind(cell: &CellValue) -> u8 {
+    match cell {
+        CellValue::Int(_) => 0,
+        CellValue::Float(_) => 1,
+        _ => 2,
+    }
+}
+
+fn compare_rows(a: &[CellValue], b: &[CellValue], keys: &[SortKey]) -> Ordering {
+    for key in keys {
+        let ord = compare_cells(&a[key.column], &b[key.column]);
+        if ord != Ordering::Equal {
+            return if key.descending { ord.reverse() } else { ord };
+        }
+    }
+    Ordering::Equal
+}
+
+impl ColumnFilter {
+    /// `value` lowercased once for `Contains`.
+    fn prepare(&self) -> Self {
+        match self.op {
+            FilterOp::Contains => Self { value: self.value.to_lowercase(), ..self.clone() },
+            _ => self.clone(),
+        }
+    }
+
+    fn compare(&self, cell: &CellValue) -> Ordering {
+        match (number(cell), self.value.trim().parse::<f64>()) {
+            (Some(x), Ok(y)) => x.total_cmp(&y),
+            _ => match (cell, self.value.trim().parse::<bool>()) {
+                (CellValue::Bool(x), Ok(y)) => x.cmp(&y),
+                _ => text(cell).as_ref().cmp(self.value.as_str()),
+            },
+        }
+    }
+
+    fn matches(&self, row: &[CellValue]) -> bool {
+        let cell = &row[self.column];
+        match self.op {
+            FilterOp::IsNull => matches!(cell, CellValue::Null),
+            FilterOp::NotNull => !matches!(cell, CellValue::Null),
+            _ if matches!(cell, CellValue::Null) => false,
+            FilterOp::Contains => text(cell).to_lowercase().contains(&self.value),
+            FilterOp::Equals => self.compare(cell) == Ordering::Equal,
+            FilterOp::NotEquals => self.compare(cell) != Ordering::Equal,
+            FilterOp::Greater => self.compare(cell) == Ordering::Greater,
+            FilterOp::Less => self.compare(cell) == Ordering::Less,
+        }
+    }
+}
+
+// ─── Sort and Filter ────────────────────────────────────────────────────────
+
+/// Threads to split `len` rows over.
+fn workers(len: usize) -> usize {
+    if len < PARALLEL_MIN_ROWS {
+        return 1;
+    }
+    std::thread::available_parallelism().map_or(1, |n| n.get()).min(8)
+}
+
+/// Indices of the rows matching every filter, in row order.
+fn filter_rows(rows: &[Vec<CellValue>], filters: &[ColumnFilter]) -> Vec<u32> {
+    if filters.is_empty() {
+        return (0..rows.len() as u32).collect();
+    }
+    let filters: Vec<ColumnFilter> = filters.iter().map(ColumnFilter::prepare).collect();
+    let chunk = rows.len().div_ceil(workers(rows.len())).max(1);
+    std::thread::scope(|s| {
+        let parts: Vec<_> = rows
+            .chunks(chunk)
+            .enumerate()
+            .map(|(i, part)| {
+                let filters = &filters;
+                s.spawn(move || {
+                    part.iter()
+                        .enumerate()
+                        .filter(|(_, row)| filters.iter().all(|f| f.matches(row)))
+                        .map(|(j, _)| (i * chunk + j) as u32)
+                        .collect::<Vec<_>>()
+                })
+            })
+            .collect();
+        parts.into_iter().flat_map(|part| part.join().unwrap()).collect()
+    })
+}
+
+fn merge(a: &[u32], b: &[u32], cmp: &impl Fn(&u32, &u32) -> Ordering) -> Vec<u32> {
+    let mut out = Vec::with_capacity(a.len() + b.len());
+    let (mut i, mut j) = (0, 0);
+    while i < a.len() && j < b.len() {
+        // Ties take from `a`, which holds the earlier rows, keeping the sort stable
+        if cmp(&b[j], &a[i]) == Ordering::Less {
+            out.push(b[j]);
+            j += 1;
+        } else {
+            out.push(a[i]);
+            i += 1;
+        }
+    }
+    out.extend_from_slice(&a[i..]);
+    out.extend_from_slice(&b[j..]);
+    out
+}
+
+/// Stable sort of `order` by `keys`: slices sorted on their own threads,
+/// then merged pairwise.
+fn sort_rows(rows: &[Vec<CellValue>], order: &mut Vec<u32>, keys: &[SortKey]) {
+    if keys.is_empty() {
+        return;
+    }
+    let cmp = |a: &u32, b: &u32| compare_rows(&rows[*a as usize], &rows[*b as usize], keys);
+    let threads = workers(order.len());
+    if threads == 1 {
+        order.sort_by(cmp);
+        return;
+    }
+    let chunk = order.len().div_ceil(threads);
+    std::thread::scope(|s| {
+        for part in order.chunks_mut(chunk) {
+            let cmp = &cmp;
+            s.spawn(move || part.sort_by(cmp));
+        }
+    });
+    let mut runs: Vec<Vec<u32>> = order.chunks(chunk).map(<[u32]>::to_vec).collect();
+    while runs.len() > 1 {
+        runs = runs
+            .chunks(2)
+            .map(|pair| match pair {
+                [a, b] => merge(a, b, &cmp),
+                [a] => a.clone(),
+                _ => unreachable!(),
+            })
+            .collect();
+    }
+    *order = runs.pop().unwrap_or_default();
+}
+
+// ─── Aggregates ─────────────────────────────────────────────────────────────
+
+enum Accumulator {
+    Count(i64),
+    Sum { int: i64, float: f64, floats: bool, any: bool },
+    Min(CellValue),
+    Max(CellValue),
+}
+
+impl Accumulator {
+    fn new(op: AggregateOp) -> Self {
+        match op {
+            AggregateOp::Count => Self::Count(0),
+            AggregateOp::Sum => Self::Sum { int: 0, float: 0.0, floats: false, any: false },
+            AggregateOp::Min => Self::Min(CellValue::Null),
+            AggregateOp::Max => Self::Max(CellValue::Null),
+        }
+    }
+
+    /// `cell` is `None` for `count(*)`.
+    fn add(&mut self, cell: Option<&CellValue>) {
+        if matches!(cell, Some(CellValue::Null)) {
+            return;
+        }
+        match (self, cell) {
+            (Self::Count(n), _) => *n += 1,
+            (Self::Sum { int, float, floats, any }, Some(cell)) => {
+                let sum = match cell {
+                    CellValue::Int(n) => int.checked_add(*n),
+                    _ => None,
+                };
+                match (sum, number(cell)) {
+                    (Some(sum), _) => *int = sum,
+                    (None, Some(x)) => {
+                        *float += x;
+                        *floats = true;
+                    }
+                    (None, None) => return,
+                }
+                *any = true;
+            }
+            (Self::Min(min), Some(cell)) => {
+                if matches!(min, CellValue::Null) || compare_cells(cell, min) == Ordering::Less {
+                    *min = cell.clone();
+                }
+            }
+            (Self::Max(max), Some(cell)) => {
+                if compare_cells(cell, max) == Ordering::Greater {
+                    *max = cell.clone();
+                }
+            }
+            _ => {}
+        }
+    }
+
+    fn finish(self) -> CellValue {
+        match self {
+            Self::Count(n) => CellValue::Int(n),
+            Self::Sum { any: false, .. } => CellValue::Null,
+            Self::Sum { int, float, floats: true, .. } => CellValue::Float(float + int as f64),
+            Self::Sum { int, .. } => CellValue::Int(int),
+            Self::Min(cell) | Self::Max(cell) => cell,
+        }
+    }
+}
+
+/// Grouping key of a cell: its type and text, so `1` and `'1'` stay apart.
+fn group_key(cell: &CellValue) -> (u8, String) {
+    let tag = match cell {
+        CellValue::Null => 0,
+        CellValue::Text(_) => 1,
+        CellValue::Int(_) => 2,
+        CellValue::Float(_) => 3,
+        CellValue::Bool(_) => 4,
+        CellValue::DateTime(_) => 5,
+        CellValue::Binary(_) => 6,
+        CellValue::Decimal(_) => 7,
+    };
+    (tag, text(cell).into_owned())
+}
+
+fn aggregate(set: &RetainedSet, request: &AggregateRequest) -> AggregateResult {
+    let order = filter_rows(&set.rows, &request.filters);
+    let mut index: HashMap<Vec<(u8, String)>, usize> = HashMap::new();
+    let mut groups: Vec<(Vec<CellValue>, Vec<Accumulator>)> = Vec::new();
+    for &i in &order {
+        let row = &set.rows[i as usize];
+        let key: Vec<_> = request.group_by.iter().map(|&c| group_key(&row[c])).collect();
+        let group = *index.entry(key).or_insert_with(|| {
+            let cells = request.group_by.iter().map(|&c| row[c].clone()).collect();
+            groups.push((cells, request.aggregates.iter().map(|a| Accumulator::new(a.op)).collect()));
+            groups.len() - 1
+        });
+        for (acc, agg) in groups[group].1.iter_mut().zip(&request.aggregates) {
+            acc.add(agg.column.map(|c| &row[c]));
+        }
+    }
+    if request.group_by.is_empty() && groups.is_empty() {
+        groups.push((Vec::new(), request.aggregates.iter().map(|a| Accumulator::new(a.op)).collect()));
+    }
+
+    groups.sort_by(|(a, _), (b, _)| {
+        a.iter().zip(b).map(|(x, y)| compare_cells(x, y)).find(|o| o.is_ne()).unwrap_or(Ordering::Equal)
+    });
+    let truncated = groups.len() > MAX_GROUPS;
+    groups.truncate(MAX_GROUPS);
+
+    let mut columns: Vec<String> = request.group_by.iter().map(|&c| set.columns[c].clone()).collect();
+    columns.extend(request.aggregates.iter().map(|a| {
+        let name = format!("{:?}", a.op).to_lowercase();
+        match a.column {
+            Some(c) => format!("{}({})", name, set.columns[c]),
+            None => format!("{}(*)", name),
+        }
+    }));
+    let rows = groups
+        .into_iter()
+        .map(|(mut cells, accs)| {
+            cells.extend(accs.into_iter().map(Accumulator::finish));
+            cells
+        })
+        .collect();
+    AggregateResult { columns, rows, truncated }
+}
+
+// ─── Retained Results ───────────────────────────────────────────────────────
+
+pub struct RetainedSet {
+    columns: Vec<String>,
+    rows: Vec<Vec<CellValue>>,
+    /// Sort keys, filters and resulting row order of the last view.
+    last_view: Mutex<Option<(Vec<SortKey>, Vec<ColumnFilter>, Arc<Vec<u32>>)>>,
+}
+
+impl RetainedSet {
+    fn check_column(&self, column: usize) -> anyhow::Result<()> {
+        if column >= self.columns.len() {
+            anyhow::bail!("Column {} is out of range; the result has {}", column, self.columns.len());
+        }
+        Ok(())
+    }
+
+    fn order(&self, sort: &[SortKey], filters: &[ColumnFilter]) -> Arc<Vec<u32>> {
+        if let Some((s, f, order)) = &*self.last_view.lock().unwrap() {
+            if s == sort && f == filters {
+                return Arc::clone(order);
+            }
+        }
+        let mut order = filter_rows(&self.rows, filters);
+        sort_rows(&self.rows, &mut order, sort);
+        let order = Arc::new(order);
+        *self.last_view.lock().unwrap() = Some((sort.to_vec(), filters.to_vec(), Arc::clone(&order)));
+        order
+    }
+}
+
+pub struct RetainedResult {
+    sets: Vec<RetainedSet>,
+    complete: bool,
+    _charge: Charge,
+}
+
+impl RetainedResult {
+    fn set(&self, index: usize) -> anyhow::Result<&RetainedSet> {
+        self.sets.get(index).ok_or_else(|| anyhow::anyhow!("The result has no result set {}", index + 1))
+    }
+
+    /// A page of `request.result_set` after filtering and sorting. CPU-bound
+    /// on large sets; call it off the async runtime.
+    pub fn view(&self, request: &ViewRequest) -> anyhow::Result<ViewPage> {
+        let set = self.set(request.result_set)?;
+        for column in request.sort.iter().map(|k| k.column).chain(request.filters.iter().map(|f| f.column)) {
+            set.check_column(column)?;
+        }
+        let order = set.order(&request.sort, &request.filters);
+        let rows = order
+            .iter()
+            .skip(request.offset as usize)
+            .take(request.limit as usize)
+            .map(|&i| set.rows[i as usize].clone())
+            .collect();
+        Ok(ViewPage {
+            rows,
+            matched: order.len() as u64,
+            retained: set.rows.len() as u64,
+            complete: self.complete,
+        })
+    }
+
+    /// Group-by aggregates over `request.result_set`. CPU-bound as `view`.
+    pub fn aggregate(&self, request: &AggregateRequest) -> anyhow::Result<AggregateResult> {
+        let set = self.set(request.result_set)?;
+        if let Some(a) = request.aggregates.iter().find(|a| a.column.is_none() && !matches!(a.op, AggregateOp::Count)) {
+            anyhow::bail!("{:?} needs a column", a.op);
+        }
+        let aggregate_columns = request.aggregates.iter().filter_map(|a| a.column);
+        for column in request.group_by.iter().copied().chain(aggregate_columns) {
+            set.check_column(column)?;
+        }
+        for filter in &request.filters {
+            set.check_column(filter.column)?;
+        }
+        Ok(aggregate(set, request))
+    }
+}
+
+/// Retained results of recent executions, by result ID.
+#[derive(Default)]
+pub struct ResultStore {
+    results: Mutex<VecDeque<(String, Arc<RetainedResult>)>>,
+}
+
+impl ResultStore {
+    pub fn insert(&self, result_id: String, result: RetainedResult) {
+        let mut results = self.results.lock().unwrap();
+        if results.len() == MAX_RETAINED {
+            results.pop_front();
+        }
+        results.push_back((result_id, Arc::new(result)));
+    }
+
+    pub fn get(&self, result_id: &str) -> Option<Arc<RetainedResult>> {
+        let results = self.results.lock().unwrap();
+        results.iter().find(|(id, _)| id == result_id).map(|(_, r)| Arc::clone(r))
+    }
+
+    pub fn close(&self, result_id: &str) {
+        self.results.lock().unwrap().retain(|(id, _)| id != result_id);
+    }
+}
+
+/// Passes everything on and keeps a copy of the rows until the memory
+/// budget runs out.
+pub struct RetainSink<'a> {
+    inner: &'a mut dyn ResultSink,
+    sets: Vec<RetainedSet>,
+    charge: Charge,
+    complete: bool,
+}
+
+impl<'a> RetainSink<'a> {
+    pub fn new(inner: &'a mut dyn ResultSink) -> Self {
+        Self { inner, sets: Vec::new(), charge: Charge::new(Subsystem::DbResults), complete: true }
+    }
+
+    /// The retained rows. `spilled` marks them incomplete, as rows that went
+    /// to disk never reached this sink.
+    pub fn finish(self, spilled: bool) -> RetainedResult {
+        RetainedResult { sets: self.sets, complete: self.complete && !spilled, _charge: self.charge }
+    }
+}
+
+#[async_trait::async_trait]
+impl ResultSink for RetainSink<'_> {
+    async fn columns(&mut self, columns: &[String]) -> anyhow::Result<()> {
+        self.sets.push(RetainedSet { columns: columns.to_vec(), rows: Vec::new(), last_view: Mutex::new(None) });
+        self.inner.columns(columns).await
+    }
+
+    async fn rows(&mut self, rows: Vec<Vec<CellValue>>) -> anyhow::Result<bool> {
+        if self.complete {
+            let bytes = rows.iter().map(|r| approx_row_size(r)).sum();
+            match self.sets.last_mut() {
+                Some(set) if self.charge.try_add(bytes) => set.rows.extend(rows.iter().cloned()),
+                _ => self.complete = false,
+            }
+        }
+        self.inner.rows(rows).await
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn row(id: i64, name: &str, amount: Option<f64>) -> Vec<CellValue> {
+        vec![
+            CellValue::Int(id),
+            CellValue::Text(name.to_string()),
+            amount.map_or(CellValue::Null, CellValue::Float),
+        ]
+    }
+
+    fn retained(rows: Vec<Vec<CellValue>>) -> RetainedResult {
+        let columns = ["id", "name", "amount"].map(str::to_string).to_vec();
+        let set = RetainedSet { columns, rows, last_view: Mutex::new(None) };
+        RetainedResult { sets: vec![set], complete: true, _charge: Charge::new(Subsystem::DbResults) }
+    }
+
+    #[test]
+    fn test_parallel_sort_is_stable_and_matches_sequential() {
+        let rows: Vec<_> = (0..PARALLEL_MIN_ROWS as i64 * 2)
+            .map(|i| row(i, &format!("n{}", (i * 7919) % 1000), Some((i % 13) as f64)))
+            .collect();
+        let keys = [SortKey { column: 2, descending: true }, SortKey { column: 1, descending: false }];
+        let mut parallel: Vec<u32> = (0..rows.len() as u32).collect();
+        sort_rows(&rows, &mut parallel, &keys);
+        let mut sequential: Vec<u32> = (0..rows.len() as u32).collect();
+        sequential.sort_by(|a, b| compare_rows(&rows[*a as usize], &rows[*b as usize], &keys));
+        assert_eq!(parallel, sequential);
+    }
+
+    #[test]
+    fn test_mixed_types_sort_by_class_then_value() {
+        let cells = [
+            CellValue::Int(10),
+            CellValue::Text("5x".into()),
+            CellValue::Bool(true),
+            CellValue::Decimal("9.5".into()),
+            CellValue::Null,
+            CellValue::Text("9".into()),
+            CellValue::Float(9.0),
+            CellValue::Int(9),
+            CellValue::Decimal("n/a".into()),
+        ];
+        let mut sorted = cells.to_vec();
+        sorted.sort_by(compare_cells);
+        let shown: Vec<_> = sorted.iter().map(|c| c.to_string()).collect();
+        assert_eq!(shown, ["NULL", "true", "9", "9", "9.5", "10", "5x", "9", "n/a"]);
+        assert!(matches!(sorted[2], CellValue::Int(9)) && matches!(sorted[7], CellValue::Text(_)));
+
+        let rows: Vec<_> = (0..PARALLEL_MIN_ROWS * 2).map(|i| vec![cells[(i * 7) % cells.len()].clone()]).collect();
+        let keys = [SortKey { column: 0, descending: false }];
+        let mut parallel: Vec<u32> = (0..rows.len() as u32).collect();
+        sort_rows(&rows, &mut parallel, &keys);
+        let mut sequential: Vec<u32> = (0..rows.len() as u32).collect();
+        sequential.sort_by(|a, b| compare_rows(&rows[*a as usize], &rows[*b as usize], &keys));
+        assert_eq!(parallel, sequential);
+    }
+
+    #[test]
+    fn test_view_filters_sorts_and_pages() {
+        let result = retained(vec![
+            row(1, "Alice", Some(10.0)),
+            row(2, "bob", None),
+            row(3, "Carol", Some(2.5)),
+            row(4, "alan", Some(7.0)),
+        ]);
+        let request = |filters, offset| ViewRequest {
+            result_set: 0,
+            sort: vec![SortKey { column: 2, descending: false }],
+            filters,
+            offset,
+            limit: 2,
+        };
+        let filter = |column, op, value: &str| ColumnFilter { column, op, value: value.to_string() };
+
+        let page = result.view(&request(vec![], 0)).unwrap();
+        assert_eq!((page.matched, page.retained), (4, 4));
+        assert!(matches!(page.rows[0][0], CellValue::Int(2)), "NULL sorts first");
+        let page = result.view(&request(vec![], 2)).unwrap();
+        assert!(matches!(page.rows[0][0], CellValue::Int(4)));
+
+        let page = result.view(&request(vec![filter(1, FilterOp::Contains, "AL")], 0)).unwrap();
+        let ids: Vec<_> = page.rows.iter().map(|r| r[0].to_string()).collect();
+        assert_eq!(ids, ["4", "1"]);
+        let page = result.view(&request(vec![filter(2, FilterOp::Greater, "5")], 0)).unwrap();
+        assert_eq!(page.matched, 2);
+        let page = result.view(&request(vec![filter(2, FilterOp::IsNull, "")], 0)).unwrap();
+        assert_eq!(page.matched, 1);
+
+        assert!(result.view(&ViewRequest { result_set: 1, ..request(vec![], 0) }).is_err());
+        assert!(result.view(&request(vec![filter(9, FilterOp::NotNull, "")], 0)).is_err());
+    }
+
+    #[test]
+    fn test_aggregate_groups_and_skips_nulls() {
+        let result = retained(vec![
+            row(1, "a", Some(1.5)),
+            row(2, "b", None),
+            row(3, "a", Some(2.0)),
+            row(4, "b", Some(4.0)),
+        ]);
+        let agg = |op, column| Aggregate { op, column };
+        let request = AggregateRequest {
+            result_set: 0,
+            group_by: vec![1],
+            aggregates: vec![
+                agg(AggregateOp::Count, None),
+                agg(AggregateOp::Count, Some(2)),
+                agg(AggregateOp::Sum, Some(0)),
+                agg(AggregateOp::Max, Some(2)),
+            ],
+            filters: vec![],
+        };
+        let out = result.aggregate(&request).unwrap();
+        assert_eq!(out.columns, ["name", "count(*)", "count(amount)", "sum(id)", "max(amount)"]);
+        let rows: Vec<Vec<String>> = out.rows.iter().map(|r| r.iter().map(|c| c.to_string()).collect()).collect();
+        assert_eq!(rows, [["a", "2", "2", "4", "2"], ["b", "2", "1", "6", "4"]]);
+
+        let typed = retained(vec![
+            vec![CellValue::Int(1), CellValue::Int(1), CellValue::Null],
+            vec![CellValue::Int(2), CellValue::Text("1".into()), CellValue::Null],
+            vec![CellValue::Int(3), CellValue::Int(1), CellValue::Null],
+        ]);
+        let out = typed.aggregate(&AggregateRequest { group_by: vec![1], ..request.clone() }).unwrap();
+        let counts: Vec<_> = out.rows.iter().map(|r| r[1].to_string()).collect();
+        assert_eq!(counts, ["2", "1"], "Int(1) and Text(\"1\") are separate groups");
+
+        let total = AggregateRequest { group_by: vec![], aggregates: vec![agg(AggregateOp::Sum, Some(2))], ..request };
+        let out = result.aggregate(&total).unwrap();
+        assert!(matches!(out.rows[0][0], CellValue::Float(x) if x == 7.5));
+    }
+}
@@ -0,0 +1,306 @@
+//! Persistent history of executed queries.
+//!
+//! Executions are kept in a local SQLite file, indexed by connection and
+//! time, with an FTS5 index over the SQL text. `record` only queues the
+//! entry: a background task writes queued entries in batches, so history
+//! never adds latency to a query, and entries are dropped rather than
+//! waited for when the writer falls behind. The oldest entries are pruned
+//! past `MAX_ENTRIES`.
+
+use super::db::{DbConfig, QueryResult};
+use serde::{Deserialize, Serialize};
+use sqlx::sqlite::{SqliteConnectOptions, SqlitePool, SqlitePoolOptions};
+use sqlx::Row;
+use std::path::PathBuf;
+use std::sync::{Arc, OnceLock};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+use tokio::sync::{mpsc, OnceCell};
+
+/// Entries kept; older ones are deleted as new ones arrive.
+pub const MAX_ENTRIES: i64 = 200_000;
+/// Entries waiting for the writer before new ones are dropped.
+const WRITE_QUEUE: usize = 1024;
+/// Entries written per transaction at most.
+const WRITE_BATCH: usize = 256;
+const DEFAULT_LIMIT: u32 = 200;
+
+const SCHEMA: &[&str] = &[
+    "CREATE TABLE IF NOT EXISTS history (
+        id INTEGER PRIMARY KEY,
+        executed_at_ms INTEGER NOT NULL,
+        connection_id TEXT NOT NULL,
+        connection_name TEXT NOT NULL,
+        sql TEXT NOT NULL,
+        duration_ms REAL NOT NULL,
+        row_count INTEGER NOT NULL,
+        error TEXT
+    )",
+    "CREATE INDEX IF NOT EXISTS history_by_connection ON history (connection_id, executed_at_ms)",
+    "CREATE INDEX IF NOT EXISTS history_by_time ON history (executed_at_ms)",
+    "CREATE VIRTUAL TABLE IF NOT EXISTS history_fts USING fts5 (sql, content = 'history', content_rowid = 'id')",
+    "CREATE TRIGGER IF NOT EXISTS history_fts_insert AFTER INSERT ON history BEGIN
+        INSERT INTO history_fts (rowid, sql) VALUES (new.id, new.sql);
+    END",
+    "CREATE TRIGGER IF NOT EXISTS history_fts_delete AFTER DELETE ON history BEGIN
+        INSERT INTO history_fts (history_fts, rowid, sql) VALUES ('delete', old.id, old.sql);
+    END",
+];
+
+/// One execution as recorded.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct HistoryEntry {
+    /// Assigned on write; increases with execution order.
+    #[serde(default)]
+    pub id: i64,
+    /// Unix time the execution finished, in milliseconds.
+    pub executed_at_ms: i64,
+    pub connection_id: String,
+    pub connection_name: String,
+    pub sql: String,
+    pub duration_ms: f64,
+    /// Rows returned, or affected for statements without a result set.
+    pub rows: i64,
+    pub error: Option<String>,
+}
+
+impl HistoryEntry {
+    /// Entry for running `sql` on `config`, finished just now.
+    pub fn new(config: &DbConfig, sql: &str, elapsed: Duration, outcome: Result<&QueryResult, &String>) -> Self {
+        let (rows, error) = match outcome {
+            Ok(result) if result.result_sets.is_empty() => (result.affected_rows, None),
+            Ok(result) => (result.result_sets.iter().map(|set| set.row_count).sum(), None),
+            Err(e) => (0, Some(e.clone())),
+        };
+        Self {
+            id: 0,
+            executed_at_ms: SystemTime::now().duration_since(UNIX_EPOCH).map_or(0, |d| d.as_millis() as i64),
+            connection_id: config.id.clone(),
+            connection_name: config.name.clone(),
+            sql: sql.to_string(),
+            duration_ms: elapsed.as_secs_f64() * 1000.0,
+            rows: rows as i64,
+            error,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Default, Deserialize)]
+pub struct HistoryFilter {
+    /// Words that must all occur in the SQL, each as a prefix.
+    #[serde(default)]
+    pub text: Option<String>,
+    #[serde(default)]
+    pub connection_id: Option<String>,
+    /// Only entries older than this ID, for paging back.
+    #[serde(default)]
+    pub before_id: Option<i64>,
+    /// Entries returned at most (0 = default).
+    #[serde(default)]
+    pub limit: u32,
+}
+
+pub struct QueryHistory {
+    path: PathBuf,
+    pool: OnceCell<SqlitePool>,
+    writer: OnceLock<mpsc::Sender<HistoryEntry>>,
+}
+
+/// FTS5 query requiring every word of `text` as a prefix. Words are quoted
+/// so operators and punctuation in SQL are taken literally.
+fn match_expression(text: &str) -> Option<String> {
+    let terms: Vec<String> = text
+        .split_whitespace()
+        .map(|word| format!("\"{}\"*", word.replace('"', "\"\"")))
+        .collect();
+    (!terms.is_empty()).then(|| terms.join(" "))
+}
+
+impl QueryHistory {
+    /// History stored in `path`; the file is created on first use.
+    pub fn new(path: PathBuf) -> Self {
+        Self { path, pool: OnceCell::new(), writer: OnceLock::new() }
+    }
+
+    /// The file next to the saved connections.
+    pub fn default_path() -> PathBuf {
+        directories::ProjectDirs::from("com", "loghelper", "sql-log-parser")
+            .map(|dirs| dirs.data_dir().to_path_buf())
+            .filter(|dir| std::fs::create_dir_all(dir).is_ok())
+            .unwrap_or_default()
+            .join("query_history.sqlite")
+    }
+
+    async fn pool(&self) -> anyhow::Result<&SqlitePool> {
+        self.pool
+            .get_or_try_init(|| async {
+                let opts = SqliteConnectOptions::new()
+                    .filename(&self.path)
+                    .create_if_missing(true)
+                    .journal_mode(sqlx::sqlite::SqliteJournalMode::Wal);
+                let pool = SqlitePoolOptions::new().max_connections(2).connect_with(opts).await?;
+                for statement in SCHEMA {
+                    sqlx::query(statement).execute(&pool).await?;
+                }
+                Ok(pool)
+            })
+            .await
+    }
+
+    /// Queue `entry` for writing. Must be called within the Tokio runtime.
+    pub fn record(self: &Arc<Self>, entry: HistoryEntry) {
+        let writer = self.writer.get_or_init(|| {
+            let (tx, rx) = mpsc::channel(WRITE_QUEUE);
+            tokio::spawn(Arc::clone(self).write_loop(rx));
+            tx
+        });
+        if writer.try_send(entry).is_err() {
+            eprintln!("Query history is behind; an entry was dropped");
+        }
+    }
+
+    async fn write_loop(self: Arc<Self>, mut rx: mpsc::Receiver<HistoryEntry>) {
+        let mut batch = Vec::with_capacity(WRITE_BATCH);
+        while rx.recv_many(&mut batch, WRITE_BATCH).await > 0 {
+            if let Err(e) = self.write(&batch).await {
+                eprintln!("Failed to write query history: {}", e);
+            }
+            batch.clear();
+        }
+    }
+
+    async fn write(&self, entries: &[HistoryEntry]) -> anyhow::Result<()> {
+        let pool = self.pool().await?;
+        let mut tx = pool.begin().await?;
+        for entry in entries {
+            sqlx::query(
+                "INSERT INTO history (executed_at_ms, connection_id, connection_name, sql, duration_ms, row_count, error)
+                 VALUES (?, ?, ?, ?, ?, ?, ?)",
+            )
+            .bind(entry.executed_at_ms)
+            .bind(&entry.connection_id)
+            .bind(&entry.connection_name)
+            .bind(&entry.sql)
+            .bind(entry.duration_ms)
+            .bind(entry.rows)
+            .bind(&entry.error)
+            .execute(&mut *tx)
+            .await?;
+        }
+        sqlx::query("DELETE FROM history WHERE id <= (SELECT MAX(id) FROM history) - ?")
+            .bind(MAX_ENTRIES)
+            .execute(&mut *tx)
+            .await?;
+        tx.commit().await?;
+        Ok(())
+    }
+
+    /// Newest entries first that match `filter`.
+    pub async fn search(&self, filter: &HistoryFilter) -> anyhow::Result<Vec<HistoryEntry>> {
+        let pool = self.pool().await?;
+        let expression = filter.text.as_deref().and_then(match_expression);
+
+        let mut sql = String::from(
+            "SELECT h.id, h.executed_at_ms, h.connection_id, h.connection_name, h.sql, h.duration_ms, h.row_count, h.error
+             FROM history h",
+        );
+        let mut conditions = Vec::new();
+        if expression.is_some() {
+            sql.push_str(" JOIN history_fts f ON f.rowid = h.id");
+            conditions.push("f.history_fts MATCH ?");
+        }
+        if filter.connection_id.is_some() {
+            conditions.push("h.connection_id = ?");
+        }
+        if filter.before_id.is_some() {
+            conditions.push("h.id < ?");
+        }
+        if !conditions.is_empty() {
+            sql.push_str(" WHERE ");
+            sql.push_str(&conditions.join(" AND "));
+        }
+        sql.push_str(" ORDER BY h.id DESC LIMIT ?");
+
+        let mut query = sqlx::query(&sql);
+        if let Some(expression) = expression {
+            query = query.bind(expression);
+        }
+        if let Some(connection_id) = &filter.connection_id {
+            query = query.bind(connection_id.as_str());
+        }
+        if let Some(before_id) = filter.before_id {
+            query = query.bind(before_id);
+        }
+        let limit = if filter.limit == 0 { DEFAULT_LIMIT } else { filter.limit };
+        let rows = query.bind(limit).fetch_all(pool).await?;
+        rows.iter()
+            .map(|row| {
+                Ok(HistoryEntry {
+                    id: row.try_get(0)?,
+                    executed_at_ms: row.try_get(1)?,
+                    connection_id: row.try_get(2)?,
+                    connection_name: row.try_get(3)?,
+                    sql: row.try_get(4)?,
+                    duration_ms: row.try_get(5)?,
+                    rows: row.try_get(6)?,
+                    error: row.try_get(7)?,
+                })
+            })
+            .collect()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_match_expression_quotes_words() {
+        assert_eq!(match_expression("  "), None);
+        assert_eq!(match_expression("sel users"), Some("\"sel\"* \"users\"*".to_string()));
+        assert_eq!(match_expression("a\"b OR"), Some("\"a\"\"b\"* \"OR\"*".to_string()));
+    }
+
+    #[tokio::test]
+    async fn test_recorded_entries_are_searchable() {
+        let path = std::env::temp_dir().join(format!("history_test_{}.sqlite", uuid::Uuid::new_v4()));
+        let history = QueryHistory::new(path.clone());
+        let entry = |id: &str, sql: &str| HistoryEntry {
+            id: 0,
+            executed_at_ms: 1_700_000_000_000,
+            connection_id: id.to_string(),
+            connection_name: id.to_uppercase(),
+            sql: sql.to_string(),
+            duration_ms: 1.5,
+            rows: 3,
+            error: None,
+        };
+        history
+            .write(&[
+                entry("dev", "SELECT * FROM users WHERE id = 1"),
+                entry("dev", "UPDATE orders SET status = 'x'"),
+                entry("prod", "SELECT name FROM users_archive"),
+            ])
+            .await
+            .unwrap();
+
+        let search = |text: &str, connection_id: Option<&str>| HistoryFilter {
+            text: Some(text.to_string()),
+            connection_id: connection_id.map(str::to_string),
+            ..Default::default()
+        };
+        let found = history.search(&search("user", None)).await.unwrap();
+        assert_eq!(found.len(), 2);
+        assert_eq!(found[0].connection_id, "prod", "newest first");
+        let found = history.search(&search("users sel", Some("dev"))).await.unwrap();
+        assert_eq!(found.len(), 1);
+        assert_eq!(found[0].rows, 3);
+
+        let all = history.search(&HistoryFilter::default()).await.unwrap();
+        assert_eq!(all.len(), 3);
+        let older = HistoryFilter { before_id: Some(all[1].id), ..Default::default() };
+        assert_eq!(history.search(&older).await.unwrap().len(), 1);
+
+        history.pool().await.unwrap().close().await;
+        let _ = std::fs::remove_file(path);
+    }
+}
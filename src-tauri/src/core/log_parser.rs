@@ -6,8 +6,13 @@
 use once_cell::sync::Lazy;
 use regex::Regex;
 use serde::Serialize;
-use crate::utils::encoding::{self, read_file_lines};
+use std::collections::{HashMap, VecDeque};
+use std::fs::File;
+use std::time::{Duration, Instant};
+use crate::utils::encoding::{read_file_lines, LineReader};
 use crate::utils::file_helper;
+use crate::utils::memory::{Charge, Subsystem};
+use crate::utils::perf;
 use super::sql_formatter;
 
 /// Result of parsing a single query from the log.
@@ -39,6 +44,20 @@ pub struct Execution {
     pub is_expanded: bool,
 }
 
+impl Execution {
+    /// Estimated heap footprint, for memory accounting.
+    pub fn approx_size(&self) -> usize {
+        std::mem::size_of::<Execution>()
+            + self.id.len()
+            + self.timestamp.len()
+            + self.dao_file.len()
+            + self.sql.len()
+            + self.filled_sql.len()
+            + self.formatted_sql.len()
+            + self.params.iter().map(|p| std::mem::size_of::<String>() + p.len()).sum::<usize>()
+    }
+}
+
 /// Summary information about an ID in the log.
 #[derive(Debug, Clone, Default, Serialize)]
 pub struct IdInfo {
@@ -109,6 +128,7 @@ impl LogParser {
         // Original behavior: `captures` finds first match.
         let mut found_sql = false;
         let mut found_params = false;
+        let _span = perf::span("regex_match");
 
         for line in lines {
             if !found_sql {
@@ -144,22 +164,25 @@ impl LogParser {
     /// Parse log file with advanced metadata extraction.
     /// capturing all executions for a specific ID.
     pub fn parse_log_file_advanced(&self, log_file_path: &str, target_id: &str) -> Vec<Execution> {
+        let mut executions = self.extract_executions(log_file_path, target_id);
+        format_executions(&mut executions);
+        executions
+    }
+
+    /// Same as `parse_log_file_advanced` but leaves `formatted_sql` empty,
+    /// so parsing and formatting can be timed separately.
+    pub fn extract_executions(&self, log_file_path: &str, target_id: &str) -> Vec<Execution> {
         let mut executions = Vec::new();
 
         if !file_helper::file_exists(log_file_path) {
             return executions;
         }
 
-        let content = match encoding::read_file_as_utf8(log_file_path, &self.encoding) {
-            Ok(c) => c,
-            Err(_) => return executions,
+        let mut window = match LineWindow::open(log_file_path, &self.encoding) {
+            Some(w) => w,
+            None => return executions,
         };
-
-        if content.is_empty() {
-            return executions;
-        }
-
-        let lines: Vec<&str> = content.lines().collect();
+        let mut charge = Charge::new(Subsystem::Parser);
         
         // State for parsing
         let mut current_sql = String::new();
@@ -178,8 +201,11 @@ impl LogParser {
         let full_line_regex = Regex::new(&full_line_pattern).ok();
         let simple_sql_regex = Regex::new(&simple_sql_pattern).ok();
         let params_regex = Regex::new(&params_pattern).ok();
+        let mut timings = ScanTimings::start();
+
+        while window.advance() {
+            let line = window.current();
 
-        for (i, line) in lines.iter().enumerate() {
             // 1. Check for SQL (Full or Simple)
             let mut found_new_sql = false;
             let mut extracted_sql = String::new();
@@ -190,7 +216,7 @@ impl LogParser {
                 if let Some(caps) = regex.captures(line) {
                     extracted_ts = caps.get(1).map(|m| m.as_str().to_string()).unwrap_or_default();
                     extracted_sql = caps.get(3).map(|m| m.as_str().to_string()).unwrap_or_default();
-                    extracted_dao = self.find_dao_class_name(&lines, i);
+                    extracted_dao = perf::accumulate(&mut timings.dao, || self.find_dao_class_name(window.following()));
                     found_new_sql = true;
                 }
             }
@@ -203,13 +229,13 @@ impl LogParser {
                         // Try to find timestamp in this line or previous
                         if let Some(ts_caps) = TIMESTAMP_REGEX.captures(line) {
                             extracted_ts = ts_caps.get(1).map(|m| m.as_str().to_string()).unwrap_or_default();
-                        } else if i > 0 {
-                            if let Some(ts_caps) = TIMESTAMP_REGEX.captures(lines[i - 1]) {
+                        } else if let Some(prev) = window.previous() {
+                            if let Some(ts_caps) = TIMESTAMP_REGEX.captures(prev) {
                                 extracted_ts = ts_caps.get(1).map(|m| m.as_str().to_string()).unwrap_or_default();
                             }
                         }
                         
-                        extracted_dao = self.find_dao_class_name(&lines, i);
+                        extracted_dao = perf::accumulate(&mut timings.dao, || self.find_dao_class_name(window.following()));
                         found_new_sql = true;
                     }
                 }
@@ -229,7 +255,6 @@ impl LogParser {
                     // Only process params if we have a current SQL context
                     if !current_sql.is_empty() {
                          let params_str = caps.get(1).map(|m| m.as_str()).unwrap_or("");
-                         let params = self.parse_params_string(params_str);
                          
                          // Determine timestamp for this execution
                          // Use line timestamp if available, otherwise fallback to SQL timestamp
@@ -240,24 +265,21 @@ impl LogParser {
                             
                          execution_count += 1;
 
-                         let filled_sql = sql_formatter::replace_placeholders(&current_sql, &params)
-                             .unwrap_or_else(|_| current_sql.clone());
-
-                         executions.push(Execution {
-                             id: target_id.to_string(),
-                             timestamp: ts,
-                             dao_file: current_dao.clone(),
-                             sql: current_sql.clone(),
-                             formatted_sql: sql_formatter::format_sql(&filled_sql),
-                             filled_sql,
-                             params,
-                             execution_index: execution_count,
-                             is_expanded: false,
-                         });
+                         let exec = perf::accumulate(&mut timings.fill, || build_execution(
+                             target_id,
+                             ts,
+                             &current_dao,
+                             &current_sql,
+                             self.parse_params_string(params_str),
+                             execution_count,
+                         ));
+                         charge.add(exec.approx_size());
+                         executions.push(exec);
                     }
                 }
             }
         }
+        timings.finish(window.io_time());
         
         // Edge case: SQL found but NO params found at all?
         // Logic above only adds execution if params found.
@@ -276,7 +298,7 @@ impl LogParser {
                  timestamp: current_timestamp,
                  dao_file: current_dao,
                  sql: current_sql.clone(),
-                 formatted_sql: sql_formatter::format_sql(&current_sql),
+                 formatted_sql: String::new(),
                  filled_sql: current_sql,
                  params: Vec::new(),
                  execution_index: 1,
@@ -287,6 +309,143 @@ impl LogParser {
         executions
     }
 
+    /// Parse every execution of every ID in a single pass.
+    ///
+    /// Produces the same executions as calling `parse_log_file_advanced` for each
+    /// ID reported by `get_all_ids`, but scans the file only once.
+    pub fn parse_all_executions(&self, log_file_path: &str) -> Vec<Execution> {
+        let mut executions = self.extract_all_executions(log_file_path, |_| true);
+        format_executions(&mut executions);
+        executions
+    }
+
+    /// Same as `parse_all_executions` but only for IDs `wanted` accepts, and
+    /// leaves `formatted_sql` empty. Executions are in log order.
+    pub fn extract_all_executions(&self, log_file_path: &str, wanted: impl Fn(&str) -> bool) -> Vec<Execution> {
+        let mut executions = Vec::new();
+
+        if !file_helper::file_exists(log_file_path) {
+            return executions;
+        }
+
+        let mut window = match LineWindow::open(log_file_path, &self.encoding) {
+            Some(w) => w,
+            None => return executions,
+        };
+        let mut charge = Charge::new(Subsystem::Parser);
+
+        // Per-ID state, kept in order of first appearance
+        let mut sessions: Vec<SessionState> = Vec::new();
+        let mut session_by_id: HashMap<String, usize> = HashMap::new();
+        let mut timings = ScanTimings::start();
+
+        while window.advance() {
+            let line = window.current();
+
+            // 1. SQL line starts (or replaces) the current statement of its ID
+            if let Some(caps) = ID_SQL_REGEX.captures(line) {
+                let (id_match, whole) = match (caps.get(1), caps.get(0)) {
+                    (Some(id), Some(whole)) => (id, whole),
+                    _ => continue,
+                };
+                let sql = line[whole.end()..].trim_start();
+                if sql.is_empty() {
+                    continue;
+                }
+
+                let timestamp = TIMESTAMP_REGEX
+                    .captures(line)
+                    .or_else(|| window.previous().and_then(|prev| TIMESTAMP_REGEX.captures(prev)))
+                    .and_then(|c| c.get(1))
+                    .map(|m| m.as_str())
+                    .unwrap_or("");
+
+                let idx = match session_by_id.get(id_match.as_str()) {
+                    Some(&idx) => idx,
+                    None if !wanted(id_match.as_str()) => continue,
+                    None => {
+                        session_by_id.insert(id_match.as_str().to_string(), sessions.len());
+                        sessions.push(SessionState {
+                            id: id_match.as_str().to_string(),
+                            ..Default::default()
+                        });
+                        sessions.len() - 1
+                    }
+                };
+                let session = &mut sessions[idx];
+                session.sql = sql.to_string();
+                session.timestamp = timestamp.to_string();
+                session.position = executions.len();
+                session.dao = perf::accumulate(&mut timings.dao, || self.find_dao_class_name(window.following()));
+                continue;
+            }
+
+            // 2. Params line produces one execution of the ID's current statement
+            if let Some(caps) = ID_PARAMS_REGEX.captures(line) {
+                let (id_match, whole) = match (caps.get(1), caps.get(0)) {
+                    (Some(id), Some(whole)) => (id, whole),
+                    _ => continue,
+                };
+                let session = match session_by_id.get(id_match.as_str()) {
+                    Some(&idx) => &mut sessions[idx],
+                    None => continue,
+                };
+
+                let params_str = &line[whole.end()..];
+                if params_str.len() < 2 || !params_str.starts_with('[') {
+                    continue;
+                }
+
+                let ts = TIMESTAMP_REGEX.captures(line)
+                    .and_then(|c| c.get(1))
+                    .map(|m| m.as_str())
+                    .unwrap_or(&session.timestamp);
+
+                session.execution_count += 1;
+                let exec = perf::accumulate(&mut timings.fill, || build_execution(
+                    &session.id,
+                    ts.to_string(),
+                    &session.dao,
+                    &session.sql,
+                    self.parse_params_string(params_str),
+                    session.execution_count,
+                ));
+                charge.add(exec.approx_size());
+                executions.push(exec);
+            }
+        }
+        timings.finish(window.io_time());
+
+        // Same edge case as `parse_log_file_advanced`: SQL without any params
+        // line. It goes where its SQL line was, to keep log order.
+        let mut pending: Vec<&SessionState> = sessions.iter().filter(|s| s.execution_count == 0).collect();
+        if pending.is_empty() {
+            return executions;
+        }
+        // Sessions are in order of first appearance, not of their last SQL line
+        pending.sort_by_key(|s| s.position);
+        let mut ordered = Vec::with_capacity(executions.len() + pending.len());
+        let mut parameterized = executions.into_iter();
+        let mut taken = 0;
+        for session in pending {
+            ordered.extend(parameterized.by_ref().take(session.position - taken));
+            taken = session.position;
+            ordered.push(Execution {
+                id: session.id.clone(),
+                timestamp: session.timestamp.clone(),
+                dao_file: session.dao.clone(),
+                sql: session.sql.clone(),
+                formatted_sql: String::new(),
+                filled_sql: session.sql.clone(),
+                params: Vec::new(),
+                execution_index: 1,
+                is_expanded: false,
+            });
+        }
+        ordered.extend(parameterized);
+        ordered
+    }
+
     /// Get all unique IDs from a log file.
     pub fn get_all_ids(&self, log_file_path: &str) -> Vec<IdInfo> {
         let mut ids = Vec::new();
@@ -296,15 +455,17 @@ impl LogParser {
             return ids;
         }
 
-        // Use full read to enable lookahead/DAO extraction
-        let content = match encoding::read_file_as_utf8(log_file_path, &self.encoding) {
-            Ok(c) => c,
-            Err(_) => return ids, // Fallback or empty
+        // Streamed with a lookahead window for DAO extraction
+        let mut window = match LineWindow::open(log_file_path, &self.encoding) {
+            Some(w) => w,
+            None => return ids, // Fallback or empty
         };
-        
-        let lines: Vec<&str> = content.lines().collect();
+        let mut charge = Charge::new(Subsystem::Parser);
+        let mut timings = ScanTimings::start();
+
+        while window.advance() {
+            let line = window.current();
 
-        for (i, line) in lines.iter().enumerate() {
             // Check for ID + SQL
             if let Some(caps) = ID_SQL_REGEX.captures(line) {
                  if let Some(id_match) = caps.get(1) {
@@ -313,8 +474,9 @@ impl LogParser {
                         seen_ids.insert(id.clone());
                         
                         // Extract DAO name
-                        let dao_name = self.find_dao_class_name(&lines, i);
+                        let dao_name = perf::accumulate(&mut timings.dao, || self.find_dao_class_name(window.following()));
                         
+                        charge.add(std::mem::size_of::<IdInfo>() + 2 * id.len() + dao_name.len());
                         ids.push(IdInfo {
                             id,
                             dao_name,
@@ -339,6 +501,7 @@ impl LogParser {
                 }
             }
         }
+        timings.finish(window.io_time());
 
         ids
     }
@@ -357,6 +520,7 @@ impl LogParser {
         };
 
         // State machine approach: track the last ID/SQL seen
+        let _span = perf::span("regex_match");
         for line in lines {
             // Check for ID + SQL (Start of a new execution or same ID different SQL)
             if let Some(caps) = ID_SQL_REGEX.captures(&line) {
@@ -400,11 +564,9 @@ impl LogParser {
     }
 
     /// Find DAO class name from lines after SQL statement.
-    fn find_dao_class_name(&self, lines: &[&str], sql_line_index: usize) -> String {
-        let search_end = std::cmp::min(lines.len(), sql_line_index + 50);
-
-        for i in (sql_line_index + 1)..search_end {
-            if let Some(caps) = DAO_REGEX.captures(lines[i]) {
+    fn find_dao_class_name<'a>(&self, following: impl Iterator<Item = &'a str>) -> String {
+        for line in following {
+            if let Some(caps) = DAO_REGEX.captures(line) {
                 if let Some(dao_match) = caps.get(1) {
                     return dao_match.as_str().to_string();
                 }
@@ -415,7 +577,7 @@ impl LogParser {
     }
 
     /// Parse parameters string like `[type:index:value][type:index:value]...`
-    fn parse_params_string(&self, params_str: &str) -> Vec<String> {
+    pub fn parse_params_string(&self, params_str: &str) -> Vec<String> {
         PARAM_REGEX
             .captures_iter(params_str)
             .filter_map(|caps| caps.get(1).map(|m| m.as_str().to_string()))
@@ -423,6 +585,135 @@ impl LogParser {
     }
 }
 
+/// Current statement of one ID while scanning in `extract_all_executions`.
+#[derive(Default)]
+struct SessionState {
+    id: String,
+    sql: String,
+    timestamp: String,
+    dao: String,
+    execution_count: i32,
+    /// Executions before the current SQL line.
+    position: usize,
+}
+
+/// Lines `find_dao_class_name` looks at, counting the SQL line itself.
+const DAO_LOOKAHEAD: usize = 50;
+
+/// Sliding window over a streamed log: the current line, the one before it
+/// and the lines after it that the DAO lookahead may need. Only the window is
+/// kept in memory, never the whole file.
+struct LineWindow {
+    source: LineReader<File>,
+    prev: Option<String>,
+    /// Current line first, then up to `DAO_LOOKAHEAD - 1` following lines.
+    ahead: VecDeque<String>,
+    started: bool,
+}
+
+impl LineWindow {
+    fn open(path: &str, encoding: &str) -> Option<Self> {
+        let source = read_file_lines(path, encoding).ok()?;
+        Some(Self {
+            source,
+            prev: None,
+            ahead: VecDeque::with_capacity(DAO_LOOKAHEAD),
+            started: false,
+        })
+    }
+
+    /// Move to the next line; `false` at end of file.
+    fn advance(&mut self) -> bool {
+        if self.started {
+            self.prev = self.ahead.pop_front();
+        }
+        self.started = true;
+        while self.ahead.len() < DAO_LOOKAHEAD {
+            match self.source.next() {
+                Some(line) => self.ahead.push_back(line),
+                None => break,
+            }
+        }
+        !self.ahead.is_empty()
+    }
+
+    fn current(&self) -> &str {
+        &self.ahead[0]
+    }
+
+    fn previous(&self) -> Option<&str> {
+        self.prev.as_deref()
+    }
+
+    fn following(&self) -> impl Iterator<Item = &str> {
+        self.ahead.iter().skip(1).map(String::as_str)
+    }
+
+    fn io_time(&self) -> Duration {
+        self.source.io_time()
+    }
+}
+
+/// Phase timings of one scan loop. The DAO lookahead and params fill run
+/// inside the loop, so they are accumulated and subtracted from the scan
+/// rather than recorded per call.
+struct ScanTimings {
+    start: Instant,
+    dao: Duration,
+    fill: Duration,
+}
+
+impl ScanTimings {
+    fn start() -> Self {
+        Self { start: Instant::now(), dao: Duration::ZERO, fill: Duration::ZERO }
+    }
+
+    /// `io` is the reading and decoding time spent inside the loop, which the
+    /// line reader records itself.
+    fn finish(self, io: Duration) {
+        let scan = self.start.elapsed().saturating_sub(io + self.dao + self.fill);
+        perf::record("regex_match", scan);
+        perf::record("dao_lookahead", self.dao);
+        if !self.fill.is_zero() {
+            perf::record("fill_params", self.fill);
+        }
+    }
+}
+
+/// Pretty-print the filled SQL of each execution into `formatted_sql`.
+pub fn format_executions(executions: &mut [Execution]) {
+    let _span = perf::span("format");
+    for exec in executions.iter_mut() {
+        exec.formatted_sql = sql_formatter::format_sql(&exec.filled_sql);
+    }
+}
+
+/// Build an execution with its placeholders filled; formatting happens later
+/// in `format_executions`.
+fn build_execution(
+    id: &str,
+    timestamp: String,
+    dao_file: &str,
+    sql: &str,
+    params: Vec<String>,
+    execution_index: i32,
+) -> Execution {
+    let filled_sql = sql_formatter::replace_placeholders(sql, &params)
+        .unwrap_or_else(|_| sql.to_string());
+
+    Execution {
+        id: id.to_string(),
+        timestamp,
+        dao_file: dao_file.to_string(),
+        sql: sql.to_string(),
+        formatted_sql: String::new(),
+        filled_sql,
+        params,
+        execution_index,
+        is_expanded: false,
+    }
+}
+
 impl Default for LogParser {
     fn default() -> Self {
         Self::new("SHIFT_JIS".to_string())
@@ -570,6 +861,67 @@ mod tests {
         cleanup_temp_file(&path);
     }
 
+    #[test]
+    fn test_parse_all_executions_matches_per_id_parse() {
+        let content = r#"2024/01/01 10:00:00,INFO,Test,id=abc123 sql=SELECT * FROM users WHERE id = ?
+2024/01/01 10:00:01,INFO,Test,id=def456 sql=UPDATE orders SET qty = ? WHERE id = ?
+2024/01/01 10:00:02,INFO,Test,id=abc123 params=[Int:1:1]
+2024/01/01 10:00:03,INFO,Test,id=def456 params=[Int:1:5][Int:2:7]
+2024/01/01 10:00:04,INFO,Test,id=abc123 params=[Int:1:2]
+2024/01/01 10:00:05,INFO,Test,id=fff000 sql=SELECT 1"#;
+
+        let path = create_temp_file(content);
+        let parser = LogParser::default();
+        let all = parser.parse_all_executions(&path);
+
+        assert_eq!(all.len(), 4);
+        for id in ["abc123", "def456", "fff000"] {
+            let expected = parser.parse_log_file_advanced(&path, id);
+            let actual: Vec<&Execution> = all.iter().filter(|e| e.id == id).collect();
+            assert_eq!(actual.len(), expected.len());
+            for (a, e) in actual.iter().zip(expected.iter()) {
+                assert_eq!(a.timestamp, e.timestamp);
+                assert_eq!(a.filled_sql, e.filled_sql);
+                assert_eq!(a.execution_index, e.execution_index);
+            }
+        }
+
+        cleanup_temp_file(&path);
+    }
+
+    #[test]
+    fn test_extract_all_executions_filters_and_keeps_log_order() {
+        let content = r#"2024/01/01 10:00:00,INFO,Test,id=aaa111 sql=SELECT 1
+2024/01/01 10:00:01,INFO,Test,id=bbb222 sql=SELECT * FROM t WHERE id = ?
+2024/01/01 10:00:02,INFO,Test,id=bbb222 params=[Int:1:1]
+2024/01/01 10:00:03,INFO,Test,id=ccc333 sql=SELECT 2
+2024/01/01 10:00:04,INFO,Test,id=bbb222 params=[Int:1:2]"#;
+
+        let path = create_temp_file(content);
+        let parser = LogParser::default();
+        let order: Vec<_> = parser
+            .extract_all_executions(&path, |_| true)
+            .into_iter()
+            .map(|e| (e.id, e.timestamp))
+            .collect();
+        assert_eq!(
+            order,
+            [
+                ("aaa111", "2024/01/01 10:00:00"),
+                ("bbb222", "2024/01/01 10:00:02"),
+                ("ccc333", "2024/01/01 10:00:03"),
+                ("bbb222", "2024/01/01 10:00:04"),
+            ]
+            .map(|(id, ts)| (id.to_string(), ts.to_string()))
+        );
+
+        let only = parser.extract_all_executions(&path, |id| id == "ccc333");
+        assert_eq!(only.len(), 1);
+        assert!(only[0].formatted_sql.is_empty());
+
+        cleanup_temp_file(&path);
+    }
+
     #[test]
     fn test_get_last_query_sql_with_special_chars() {
         let content = r#"2024/01/01 10:00:00,INFO,Test,id=abc123 sql=SELECT * FROM users WHERE name LIKE '%test%' AND status IN (1, 2, 3)"#;
@@ -4,3 +4,4 @@ pub mod log_parser;
 pub mod query_processor;
 pub mod sql_formatter;
 pub mod db;
+pub mod history;
@@ -5,7 +5,9 @@
 use crate::core::log_parser::{Execution, LogParser, QueryResult};
 use crate::core::sql_formatter;
 use crate::utils::clipboard;
+use crate::utils::perf;
 use serde::Serialize;
+use std::collections::HashMap;
 
 /// Group of executions sharing the same SQL template.
 #[derive(Debug, Clone, Default, Serialize)]
@@ -67,41 +69,68 @@ impl QueryProcessor {
         log_file_path: &str,
         auto_copy: bool,
     ) -> ProcessResult {
-        let mut result = ProcessResult::default();
-
-        // Use advanced parsing to get all executions
-        result.executions = self.parser.parse_log_file_advanced(log_file_path, target_id);
+        let executions = self.parser.parse_log_file_advanced(log_file_path, target_id);
 
-        if result.executions.is_empty() {
-             result.error = Some(format!("ID not found: {}", target_id));
-             return result;
+        if executions.is_empty() {
+            return ProcessResult {
+                error: Some(format!("ID not found: {}", target_id)),
+                ..Default::default()
+            };
         }
 
-        // Grouping Logic
-        // We preserve order of appearance of templates.
-        for exec in &result.executions {
-            let mut group_found = false;
-            for group in &mut result.groups {
-                if group.template_sql == exec.sql {
-                    group.executions.push(exec.clone());
-                    group_found = true;
-                    break;
+        let mut groups = {
+            let _span = perf::span("group");
+            Self::group_executions(&executions)
+        };
+        Self::format_groups(&mut groups);
+        Self::build_result(executions, groups, auto_copy)
+    }
+
+    /// Group executions by SQL template, preserving order of first appearance.
+    ///
+    /// `formatted_template_sql` is left empty; see `format_groups`.
+    pub fn group_executions(executions: &[Execution]) -> Vec<QueryGroup> {
+        let mut groups: Vec<QueryGroup> = Vec::new();
+        let mut group_by_template: HashMap<&str, usize> = HashMap::new();
+
+        for exec in executions {
+            match group_by_template.get(exec.sql.as_str()) {
+                Some(&idx) => groups[idx].executions.push(exec.clone()),
+                None => {
+                    group_by_template.insert(&exec.sql, groups.len());
+                    groups.push(QueryGroup {
+                        template_sql: exec.sql.clone(),
+                        formatted_template_sql: String::new(),
+                        executions: vec![exec.clone()],
+                        is_expanded: false,
+                        is_template_expanded: false,
+                    });
                 }
             }
-            
-            if !group_found {
-                 result.groups.push(QueryGroup {
-                     template_sql: exec.sql.clone(),
-                     formatted_template_sql: sql_formatter::format_sql(&exec.sql),
-                     executions: vec![exec.clone()],
-                     is_expanded: false,
-                     is_template_expanded: false,
-                 });
-            }
         }
 
+        groups
+    }
+
+    /// Pretty-print each group's template SQL.
+    pub fn format_groups(groups: &mut [QueryGroup]) {
+        let _span = perf::span("format");
+        for group in groups.iter_mut() {
+            group.formatted_template_sql = sql_formatter::format_sql(&group.template_sql);
+        }
+    }
+
+    /// Assemble the result for parsed and grouped executions, optionally
+    /// copying the last filled SQL to the clipboard.
+    pub fn build_result(
+        executions: Vec<Execution>,
+        mut groups: Vec<QueryGroup>,
+        auto_copy: bool,
+    ) -> ProcessResult {
+        let mut result = ProcessResult::default();
+
         // Auto-expand the first execution of the first group
-        if let Some(first_group) = result.groups.first_mut() {
+        if let Some(first_group) = groups.first_mut() {
             if let Some(first_exec) = first_group.executions.first_mut() {
                 first_exec.is_expanded = true;
             }
@@ -109,22 +138,28 @@ impl QueryProcessor {
 
         // To maintain backward compatibility with UI parts using `result.query`:
         // Populate single `query` field from the LAST execution (most likely what user wants if single view).
-        if let Some(last_exec) = result.executions.last() {
+        if let Some(last_exec) = executions.last() {
              result.query = QueryResult {
                  id: last_exec.id.clone(),
                  sql: last_exec.sql.clone(),
                  params: last_exec.params.clone(),
              };
              
-             result.formatted_sql = sql_formatter::format_sql(&last_exec.sql);
-             result.formatted_params = sql_formatter::format_params(&last_exec.params);
+             {
+                 let _span = perf::span("format");
+                 result.formatted_sql = sql_formatter::format_sql(&last_exec.sql);
+                 result.formatted_params = sql_formatter::format_params(&last_exec.params);
+             }
              result.filled_sql = last_exec.filled_sql.clone();
              
              if auto_copy && !result.filled_sql.is_empty() {
+                 let _span = perf::span("clipboard");
                  result.copied_to_clipboard = clipboard::copy_to_clipboard(&result.filled_sql);
              }
         }
 
+        result.executions = executions;
+        result.groups = groups;
         result
     }
 
@@ -139,9 +174,15 @@ impl QueryProcessor {
             return result;
         }
 
-        result.formatted_sql = sql_formatter::format_sql(&result.query.sql);
-        result.formatted_params = sql_formatter::format_params(&result.query.params);
-        result.filled_sql = self.get_filled_query(&result.query);
+        {
+            let _span = perf::span("format");
+            result.formatted_sql = sql_formatter::format_sql(&result.query.sql);
+            result.formatted_params = sql_formatter::format_params(&result.query.params);
+        }
+        {
+            let _span = perf::span("fill_params");
+            result.filled_sql = self.get_filled_query(&result.query);
+        }
 
         // Synthesize a group for UI consistency
         // Note: Execution struct requires timestamp etc which we don't have fully in QueryResult
@@ -168,6 +209,7 @@ impl QueryProcessor {
         });
 
         if auto_copy && !result.filled_sql.is_empty() {
+            let _span = perf::span("clipboard");
             result.copied_to_clipboard = clipboard::copy_to_clipboard(&result.filled_sql);
         }
 
@@ -215,6 +257,23 @@ mod tests {
         assert_eq!(processor.get_filled_query(&query), "SELECT 1");
     }
 
+    #[test]
+    fn test_group_executions_preserves_template_order() {
+        let exec = |sql: &str, index: i32| Execution {
+            sql: sql.to_string(),
+            execution_index: index,
+            ..Default::default()
+        };
+        let executions = vec![exec("B", 1), exec("A", 1), exec("B", 2), exec("A", 2), exec("B", 3)];
+
+        let groups = QueryProcessor::group_executions(&executions);
+        assert_eq!(groups.len(), 2);
+        assert_eq!(groups[0].template_sql, "B");
+        assert_eq!(groups[0].executions.len(), 3);
+        assert_eq!(groups[1].template_sql, "A");
+        assert_eq!(groups[1].executions[1].execution_index, 2);
+    }
+
     #[test]
     fn test_get_filled_query_with_params() {
         let processor = QueryProcessor::new();
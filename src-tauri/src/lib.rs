@@ -1,11 +1,15 @@
+#[cfg(feature = "gui")]
 mod commands;
-mod config;
-mod core;
+pub mod config;
+pub mod core;
+#[cfg(feature = "gui")]
 mod state;
-mod utils;
+pub mod utils;
 
+#[cfg(feature = "gui")]
 use state::AppState;
 
+#[cfg(feature = "gui")]
 #[cfg_attr(mobile, tauri::mobile_entry_point)]
 pub fn run() {
     tauri::Builder::default()
@@ -21,12 +25,30 @@ pub fn run() {
             commands::update_connection,
             commands::delete_connection,
             commands::test_connection,
+            commands::warm_connection,
+            commands::probe_connections,
             commands::execute_query,
+            commands::search_history,
+            commands::ack_result_batches,
+            commands::fetch_result_page,
+            commands::view_result,
+            commands::aggregate_result,
+            commands::close_result,
+            commands::cancel_query,
+            commands::invalidate_result_cache,
+            commands::replay_group,
+            commands::replay_session,
+            commands::fan_out_query,
+            commands::compare_table_checksums,
+            commands::benchmark_query,
+            commands::export_query,
             commands::load_config,
             commands::save_config,
             commands::copy_to_clipboard,
             commands::parse_jdbc_url_cmd,
             commands::build_jdbc_url_cmd,
+            commands::get_perf_stats,
+            commands::get_memory_stats,
         ])
         .run(tauri::generate_context!())
         .expect("error while running tauri application");
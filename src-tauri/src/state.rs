@@ -1,15 +1,51 @@
-use std::sync::Mutex;
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex};
+use tokio::sync::Semaphore;
+use tokio_util::sync::CancellationToken;
 
 use crate::config::{Config, ConfigManager};
+use crate::core::db::spill::SpillStore;
+use crate::core::db::view::ResultStore;
 use crate::core::db::{ConnectionManager, DbClient};
+use crate::core::history::QueryHistory;
 use crate::core::query_processor::QueryProcessor;
 
+/// A streaming `execute_query` or a replay in flight.
+pub struct RunningQuery {
+    /// Row batches the webview may still receive unacknowledged; replays
+    /// stream nothing.
+    pub window: Option<Arc<Semaphore>>,
+    pub cancel: CancellationToken,
+}
+
+/// Keeps a query in `AppState::running_queries` until dropped, so an entry
+/// goes away even when the command's future is dropped mid-query (e.g. with
+/// its webview).
+pub struct RunningQueryGuard<'a> {
+    queries: &'a Mutex<HashMap<String, RunningQuery>>,
+    id: String,
+    pub cancel: CancellationToken,
+}
+
+impl Drop for RunningQueryGuard<'_> {
+    fn drop(&mut self) {
+        self.queries.lock().unwrap().remove(&self.id);
+    }
+}
+
 pub struct AppState {
     pub config_manager: Mutex<ConfigManager>,
     pub config: Mutex<Config>,
     pub query_processor: Mutex<QueryProcessor>,
     pub connection_manager: Mutex<ConnectionManager>,
     pub db_client: DbClient,
+    /// Running queries by the query ID the webview chose.
+    pub running_queries: Mutex<HashMap<String, RunningQuery>>,
+    pub history: Arc<QueryHistory>,
+    /// Spilled rows of finished queries, paged by the webview.
+    pub spills: SpillStore,
+    /// Rows of recent results kept for sorting and filtering.
+    pub results: ResultStore,
 }
 
 impl AppState {
@@ -17,6 +53,7 @@ impl AppState {
         let config_manager = ConfigManager::new();
         let config = config_manager.load();
         let encoding = config.encoding.clone();
+        crate::utils::memory::set_budget_mb(config.memory_budget_mb);
 
         let mut query_processor = QueryProcessor::new();
         query_processor.parser_mut().set_encoding(encoding);
@@ -27,6 +64,21 @@ impl AppState {
             query_processor: Mutex::new(query_processor),
             connection_manager: Mutex::new(ConnectionManager::new()),
             db_client: DbClient::new(),
+            running_queries: Mutex::new(HashMap::new()),
+            history: Arc::new(QueryHistory::new(QueryHistory::default_path())),
+            spills: SpillStore::new(),
+            results: ResultStore::default(),
         }
     }
+
+    /// Register `query_id` for `ack_result_batches` and `cancel_query`
+    /// while the returned guard lives.
+    pub fn start_query(&self, query_id: &str, window: Option<Arc<Semaphore>>) -> RunningQueryGuard<'_> {
+        let cancel = CancellationToken::new();
+        self.running_queries
+            .lock()
+            .unwrap()
+            .insert(query_id.to_string(), RunningQuery { window, cancel: cancel.clone() });
+        RunningQueryGuard { queries: &self.running_queries, id: query_id.to_string(), cancel }
+    }
 }
@@ -1,12 +1,15 @@
 //! Cross-platform clipboard utilities.
 //!
 //! Uses arboard crate for clipboard access (works with GNU toolchain).
+//! Headless builds (without the `gui` feature) have no clipboard and always report failure.
 
+#[cfg(feature = "gui")]
 use arboard::Clipboard;
 
 /// Copy UTF-8 text to the clipboard.
 /// 
 /// Returns true if successful, false otherwise.
+#[cfg(feature = "gui")]
 pub fn copy_to_clipboard(text: &str) -> bool {
     // arboard requires a new Clipboard instance for each operation
     match Clipboard::new() {
@@ -26,6 +29,11 @@ pub fn copy_to_clipboard(text: &str) -> bool {
     }
 }
 
+#[cfg(not(feature = "gui"))]
+pub fn copy_to_clipboard(_text: &str) -> bool {
+    false
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
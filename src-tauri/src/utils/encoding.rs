@@ -2,13 +2,19 @@
 //!
 //! Uses encoding_rs crate instead of Windows APIs for portability.
 
-use encoding_rs::Encoding;
+use encoding_rs::{Decoder, Encoding};
+use super::perf;
+
+/// Look up an encoding by label, defaulting to UTF-8 if the label is invalid.
+/// Resolve once and reuse it when decoding many values.
+pub fn resolve_encoding(encoding_label: &str) -> &'static Encoding {
+    Encoding::for_label(encoding_label.as_bytes()).unwrap_or(encoding_rs::UTF_8)
+}
 
 /// Decode bytes using the specified encoding label.
 /// Defaults to UTF-8 if label is invalid or "UTF-8".
 pub fn decode_bytes(data: &[u8], encoding_label: &str) -> String {
-    let encoding = Encoding::for_label(encoding_label.as_bytes()).unwrap_or(encoding_rs::UTF_8);
-    let (decoded, _, _) = encoding.decode(data);
+    let (decoded, _, _) = resolve_encoding(encoding_label).decode(data);
     decoded.into_owned()
 }
 
@@ -18,28 +24,123 @@ pub fn shift_jis_to_utf8(data: &[u8]) -> String {
     decode_bytes(data, "SHIFT_JIS")
 }
 
-use std::io::{BufRead, BufReader, Read};
+use std::io::Read;
+use std::time::{Duration, Instant};
+
+/// Bytes read and decoded at a time by `LineReader`.
+const CHUNK_SIZE: usize = 256 * 1024;
+
+/// Streaming decoder yielding lines without their `\n` / `\r\n` terminator.
+///
+/// Decodes fixed-size chunks rather than single lines, so encodings whose
+/// code units may contain `0x0A` (UTF-16) still split correctly, and only one
+/// chunk plus the current partial line is held in memory.
+pub struct LineReader<R: Read> {
+    reader: R,
+    decoder: Decoder,
+    chunk: Vec<u8>,
+    text: String,
+    pos: usize,
+    eof: bool,
+    read_time: Duration,
+    decode_time: Duration,
+}
+
+impl<R: Read> LineReader<R> {
+    pub fn new(reader: R, encoding_label: &str) -> Self {
+        let encoding = resolve_encoding(encoding_label);
+        Self {
+            reader,
+            decoder: encoding.new_decoder(),
+            chunk: vec![0; CHUNK_SIZE],
+            text: String::new(),
+            pos: 0,
+            eof: false,
+            read_time: Duration::ZERO,
+            decode_time: Duration::ZERO,
+        }
+    }
+
+    /// Time spent reading and decoding so far.
+    pub fn io_time(&self) -> Duration {
+        self.read_time + self.decode_time
+    }
+
+    /// Decode the next chunk onto the unconsumed text.
+    fn fill(&mut self) {
+        self.text.drain(..self.pos);
+        self.pos = 0;
+
+        let start = Instant::now();
+        let n = loop {
+            match self.reader.read(&mut self.chunk) {
+                Ok(n) => break n,
+                Err(e) if e.kind() == std::io::ErrorKind::Interrupted => continue,
+                Err(_) => break 0,
+            }
+        };
+        self.read_time += start.elapsed();
+
+        let start = Instant::now();
+        let last = n == 0;
+        if let Some(max) = self.decoder.max_utf8_buffer_length(n) {
+            self.text.reserve(max);
+        }
+        let _ = self.decoder.decode_to_string(&self.chunk[..n], &mut self.text, last);
+        self.decode_time += start.elapsed();
+        self.eof = last;
+    }
+}
+
+impl<R: Read> Iterator for LineReader<R> {
+    type Item = String;
+
+    fn next(&mut self) -> Option<String> {
+        loop {
+            if let Some(offset) = self.text[self.pos..].find('\n') {
+                let end = self.pos + offset;
+                let line = &self.text[self.pos..end];
+                let line = line.strip_suffix('\r').unwrap_or(line).to_string();
+                self.pos = end + 1;
+                return Some(line);
+            }
+            if self.eof {
+                if self.pos < self.text.len() {
+                    let line = self.text[self.pos..].to_string();
+                    self.pos = self.text.len();
+                    return Some(line);
+                }
+                return None;
+            }
+            self.fill();
+        }
+    }
+}
+
+impl<R: Read> Drop for LineReader<R> {
+    fn drop(&mut self) {
+        perf::record("file_read", self.read_time);
+        perf::record("decode", self.decode_time);
+    }
+}
 
 /// Read a file with specified encoding and return an iterator over lines.
 /// This avoids loading the entire file into memory.
-pub fn read_file_lines(file_path: &str, encoding_label: &str) -> std::io::Result<impl Iterator<Item = String>> {
+pub fn read_file_lines(file_path: &str, encoding_label: &str) -> std::io::Result<LineReader<std::fs::File>> {
     let file = std::fs::File::open(file_path)?;
-    let reader = BufReader::new(file);
-    let encoding_label = encoding_label.to_string(); // Clone for closure
-    
-    Ok(reader.split(b'\n').filter_map(move |line_result| {
-        match line_result {
-            Ok(bytes) => Some(decode_bytes(&bytes, &encoding_label)),
-            Err(_) => None,
-        }
-    }))
+    Ok(LineReader::new(file, encoding_label))
 }
 
 /// Read a file with specified encoding and return as UTF-8 string.
 pub fn read_file_as_utf8(file_path: &str, encoding_label: &str) -> std::io::Result<String> {
-    let mut file = std::fs::File::open(file_path)?;
-    let mut buffer = Vec::new();
-    file.read_to_end(&mut buffer)?;
+    let buffer = {
+        let _span = perf::span("file_read");
+        let mut file = std::fs::File::open(file_path)?;
+        let mut buffer = Vec::new();
+        file.read_to_end(&mut buffer)?;
+        buffer
+    };
+    let _span = perf::span("decode");
     Ok(decode_bytes(&buffer, encoding_label))
 }
 
@@ -63,6 +164,22 @@ mod tests {
         assert_eq!(result, "日本語");
     }
 
+    #[test]
+    fn test_line_reader_splits_across_chunks() {
+        let mut text = String::new();
+        for i in 0..20_000 {
+            text.push_str(&format!("line {}\r\n", i));
+        }
+        text.push_str("last");
+
+        let lines: Vec<String> = LineReader::new(text.as_bytes(), "UTF-8").collect();
+        assert_eq!(lines.len(), 20_001);
+        assert_eq!(lines[0], "line 0");
+        assert_eq!(lines[19_999], "line 19999");
+        assert_eq!(lines[20_000], "last");
+        assert_eq!(lines, text.lines().collect::<Vec<_>>());
+    }
+
     #[test]
     fn test_invalid_encoding_fallback() {
          let data = b"Hello";
@@ -0,0 +1,304 @@
+//! Memory accounting and the global memory budget.
+//!
+//! Subsystems holding large buffers (parser output, caches, DB result rows)
+//! charge their estimated size through a `Charge` guard, tracked per
+//! subsystem as current and peak bytes. Buffers that can give memory back use
+//! `Charge::try_add` against the budget from `Config` and evict, spill or stop
+//! when it fails. With the `mem-tracking` feature, a counting global allocator
+//! also reports the real process heap.
+
+use serde::Serialize;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Subsystem {
+    Parser,
+    Cache,
+    DbResults,
+}
+
+impl Subsystem {
+    pub const ALL: [Subsystem; 3] = [Subsystem::Parser, Subsystem::Cache, Subsystem::DbResults];
+
+    fn name(self) -> &'static str {
+        match self {
+            Subsystem::Parser => "parser",
+            Subsystem::Cache => "cache",
+            Subsystem::DbResults => "db_results",
+        }
+    }
+}
+
+struct Counter {
+    current: AtomicUsize,
+    peak: AtomicUsize,
+}
+
+impl Counter {
+    const fn new() -> Self {
+        Self { current: AtomicUsize::new(0), peak: AtomicUsize::new(0) }
+    }
+
+    fn add(&self, bytes: usize) {
+        let now = self.current.fetch_add(bytes, Ordering::Relaxed) + bytes;
+        self.peak.fetch_max(now, Ordering::Relaxed);
+    }
+
+    fn sub(&self, bytes: usize) {
+        self.current.fetch_sub(bytes, Ordering::Relaxed);
+    }
+}
+
+/// Per-subsystem counters and the budget they are checked against. The app
+/// uses `GLOBAL`; tests use their own so they can run in parallel.
+pub struct Accounting {
+    counters: [Counter; 3],
+    /// Budget in bytes; 0 means unlimited.
+    budget_bytes: AtomicUsize,
+}
+
+impl Accounting {
+    pub const fn new() -> Self {
+        Self {
+            counters: [Counter::new(), Counter::new(), Counter::new()],
+            budget_bytes: AtomicUsize::new(0),
+        }
+    }
+
+    fn counter(&self, subsystem: Subsystem) -> &Counter {
+        &self.counters[subsystem as usize]
+    }
+
+    pub fn set_budget_mb(&self, mb: u64) {
+        let bytes = (mb as usize).saturating_mul(1024 * 1024);
+        self.budget_bytes.store(bytes, Ordering::Relaxed);
+    }
+
+    pub fn budget_bytes(&self) -> Option<usize> {
+        match self.budget_bytes.load(Ordering::Relaxed) {
+            0 => None,
+            n => Some(n),
+        }
+    }
+
+    pub fn charged_bytes(&self) -> usize {
+        self.counters.iter().map(|c| c.current.load(Ordering::Relaxed)).sum()
+    }
+}
+
+impl std::fmt::Debug for Accounting {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("Accounting").field("charged_bytes", &self.charged_bytes()).finish()
+    }
+}
+
+static GLOBAL: Accounting = Accounting::new();
+
+/// Set the global budget from `Config::memory_budget_mb` (0 = unlimited).
+pub fn set_budget_mb(mb: u64) {
+    GLOBAL.set_budget_mb(mb);
+}
+
+pub fn budget_bytes() -> Option<usize> {
+    GLOBAL.budget_bytes()
+}
+
+/// Total currently charged across all subsystems.
+pub fn charged_bytes() -> usize {
+    GLOBAL.charged_bytes()
+}
+
+/// Estimated bytes held by one subsystem, released when dropped.
+#[derive(Debug)]
+#[must_use = "a charge is released when dropped"]
+pub struct Charge {
+    subsystem: Subsystem,
+    bytes: usize,
+    accounting: &'static Accounting,
+}
+
+impl Charge {
+    pub fn new(subsystem: Subsystem) -> Self {
+        Self::in_accounting(subsystem, &GLOBAL)
+    }
+
+    /// A charge against `accounting` instead of the global one.
+    pub fn in_accounting(subsystem: Subsystem, accounting: &'static Accounting) -> Self {
+        Self { subsystem, bytes: 0, accounting }
+    }
+
+    /// Charge `bytes` regardless of the budget, for memory that cannot be
+    /// given back (e.g. a result the caller asked for in full).
+    pub fn add(&mut self, bytes: usize) {
+        self.accounting.counter(self.subsystem).add(bytes);
+        self.bytes += bytes;
+    }
+
+    /// Charge `bytes` only if the total stays within the budget. `false`
+    /// means the caller should evict, spill or stop buffering.
+    pub fn try_add(&mut self, bytes: usize) -> bool {
+        if let Some(budget) = self.accounting.budget_bytes() {
+            if self.accounting.charged_bytes() + bytes > budget {
+                return false;
+            }
+        }
+        self.add(bytes);
+        true
+    }
+
+    pub fn release(&mut self, bytes: usize) {
+        let bytes = bytes.min(self.bytes);
+        self.accounting.counter(self.subsystem).sub(bytes);
+        self.bytes -= bytes;
+    }
+
+    pub fn bytes(&self) -> usize {
+        self.bytes
+    }
+}
+
+impl Drop for Charge {
+    fn drop(&mut self) {
+        self.accounting.counter(self.subsystem).sub(self.bytes);
+    }
+}
+
+// ─── Heap Tracking ──────────────────────────────────────────────────────────
+
+#[cfg(feature = "mem-tracking")]
+mod heap {
+    use std::alloc::{GlobalAlloc, Layout, System};
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    pub static CURRENT: AtomicUsize = AtomicUsize::new(0);
+    pub static PEAK: AtomicUsize = AtomicUsize::new(0);
+
+    /// System allocator that counts live bytes.
+    pub struct CountingAlloc;
+
+    fn grow(bytes: usize) {
+        let now = CURRENT.fetch_add(bytes, Ordering::Relaxed) + bytes;
+        PEAK.fetch_max(now, Ordering::Relaxed);
+    }
+
+    unsafe impl GlobalAlloc for CountingAlloc {
+        unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+            let ptr = System.alloc(layout);
+            if !ptr.is_null() {
+                grow(layout.size());
+            }
+            ptr
+        }
+
+        unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+            let ptr = System.alloc_zeroed(layout);
+            if !ptr.is_null() {
+                grow(layout.size());
+            }
+            ptr
+        }
+
+        unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+            System.dealloc(ptr, layout);
+            CURRENT.fetch_sub(layout.size(), Ordering::Relaxed);
+        }
+
+        unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+            let new_ptr = System.realloc(ptr, layout, new_size);
+            if !new_ptr.is_null() {
+                if new_size > layout.size() {
+                    grow(new_size - layout.size());
+                } else {
+                    CURRENT.fetch_sub(layout.size() - new_size, Ordering::Relaxed);
+                }
+            }
+            new_ptr
+        }
+    }
+
+    #[global_allocator]
+    static GLOBAL: CountingAlloc = CountingAlloc;
+}
+
+// ─── Stats ──────────────────────────────────────────────────────────────────
+
+#[derive(Debug, Clone, Serialize)]
+pub struct SubsystemUsage {
+    pub subsystem: String,
+    pub current_bytes: u64,
+    pub peak_bytes: u64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct HeapUsage {
+    pub current_bytes: u64,
+    pub peak_bytes: u64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct MemoryStats {
+    pub subsystems: Vec<SubsystemUsage>,
+    pub charged_bytes: u64,
+    pub budget_bytes: Option<u64>,
+    /// Process heap, only with the `mem-tracking` feature.
+    pub heap: Option<HeapUsage>,
+}
+
+pub fn stats() -> MemoryStats {
+    #[cfg(feature = "mem-tracking")]
+    let heap = Some(HeapUsage {
+        current_bytes: heap::CURRENT.load(Ordering::Relaxed) as u64,
+        peak_bytes: heap::PEAK.load(Ordering::Relaxed) as u64,
+    });
+    #[cfg(not(feature = "mem-tracking"))]
+    let heap = None;
+
+    MemoryStats {
+        subsystems: Subsystem::ALL
+            .iter()
+            .map(|&s| SubsystemUsage {
+                subsystem: s.name().to_string(),
+                current_bytes: GLOBAL.counter(s).current.load(Ordering::Relaxed) as u64,
+                peak_bytes: GLOBAL.counter(s).peak.load(Ordering::Relaxed) as u64,
+            })
+            .collect(),
+        charged_bytes: charged_bytes() as u64,
+        budget_bytes: budget_bytes().map(|b| b as u64),
+        heap,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_charge_tracks_current_and_peak() {
+        static ACCOUNTING: Accounting = Accounting::new();
+        let usage = |s| ACCOUNTING.counter(s);
+        {
+            let mut charge = Charge::in_accounting(Subsystem::DbResults, &ACCOUNTING);
+            charge.add(1000);
+            charge.release(400);
+            assert_eq!(charge.bytes(), 600);
+            assert_eq!(usage(Subsystem::DbResults).current.load(Ordering::Relaxed), 600);
+            assert_eq!(usage(Subsystem::DbResults).peak.load(Ordering::Relaxed), 1000);
+        }
+        assert_eq!(ACCOUNTING.charged_bytes(), 0);
+        assert_eq!(usage(Subsystem::Cache).peak.load(Ordering::Relaxed), 0);
+    }
+
+    #[test]
+    fn test_try_add_respects_budget() {
+        static ACCOUNTING: Accounting = Accounting::new();
+        ACCOUNTING.set_budget_mb(1);
+        let mut other = Charge::in_accounting(Subsystem::Parser, &ACCOUNTING);
+        other.add(512 * 1024);
+        let mut charge = Charge::in_accounting(Subsystem::Cache, &ACCOUNTING);
+        assert!(!charge.try_add(600 * 1024));
+        assert!(charge.try_add(1024));
+        assert_eq!(charge.bytes(), 1024);
+        ACCOUNTING.set_budget_mb(0);
+        assert!(charge.try_add(2 * 1024 * 1024));
+    }
+}
@@ -1,3 +1,5 @@
 pub mod clipboard;
 pub mod encoding;
 pub mod file_helper;
+pub mod memory;
+pub mod perf;
@@ -0,0 +1,357 @@
+//! Phase-level timing for commands.
+//!
+//! A command is wrapped in `trace` (sync) or `trace_async`, and code anywhere
+//! below it marks phases with `span("name")` guards. Phases land in a ring
+//! buffer of recent commands plus per-(command, phase) log2 histograms, read
+//! back through `stats()`. Outside a traced command, spans are no-ops.
+
+use once_cell::sync::Lazy;
+use serde::Serialize;
+use std::cell::RefCell;
+use std::collections::{HashMap, VecDeque};
+use std::future::Future;
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+/// Number of recent commands kept for the breakdown view.
+const RECENT_CAPACITY: usize = 50;
+
+/// Histogram bucket `i` counts durations below `2^i` microseconds.
+const BUCKETS: usize = 32;
+
+/// Phases collected for the command currently running.
+#[derive(Default)]
+struct PhaseLog {
+    phases: Vec<(&'static str, Duration)>,
+    payload_bytes: Option<u64>,
+}
+
+impl PhaseLog {
+    fn add(&mut self, phase: &'static str, elapsed: Duration) {
+        // Phases recorded more than once (e.g. per result set) are summed
+        match self.phases.iter_mut().find(|(name, _)| *name == phase) {
+            Some((_, total)) => *total += elapsed,
+            None => self.phases.push((phase, elapsed)),
+        }
+    }
+}
+
+type SharedLog = Arc<Mutex<PhaseLog>>;
+
+thread_local! {
+    static CURRENT: RefCell<Option<SharedLog>> = RefCell::new(None);
+}
+
+tokio::task_local! {
+    static TASK_CURRENT: SharedLog;
+}
+
+fn with_current(f: impl FnOnce(&mut PhaseLog)) {
+    let mut f = Some(f);
+    let in_task = TASK_CURRENT
+        .try_with(|log| {
+            if let (Some(f), Ok(mut log)) = (f.take(), log.lock()) {
+                f(&mut log);
+            }
+        })
+        .is_ok();
+    if in_task {
+        return;
+    }
+    CURRENT.with(|current| {
+        if let (Some(f), Some(log)) = (f.take(), current.borrow().as_ref()) {
+            if let Ok(mut log) = log.lock() {
+                f(&mut log);
+            }
+        }
+    });
+}
+
+/// Add an already measured duration to the current command.
+pub fn record(phase: &'static str, elapsed: Duration) {
+    with_current(|log| log.add(phase, elapsed));
+}
+
+/// Run `f`, adding its duration to `acc`. For phases interleaved inside a hot
+/// loop, where recording each call separately would cost more than the work.
+pub fn accumulate<T>(acc: &mut Duration, f: impl FnOnce() -> T) -> T {
+    let start = Instant::now();
+    let out = f();
+    *acc += start.elapsed();
+    out
+}
+
+/// Add to the bytes handed to the webview by the current command.
+pub fn record_payload(bytes: usize) {
+    with_current(|log| *log.payload_bytes.get_or_insert(0) += bytes as u64);
+}
+
+/// Guard that records the time until it is dropped as `phase`.
+#[must_use = "a span records when dropped"]
+pub struct Span {
+    phase: &'static str,
+    start: Instant,
+}
+
+pub fn span(phase: &'static str) -> Span {
+    Span { phase, start: Instant::now() }
+}
+
+impl Drop for Span {
+    fn drop(&mut self) {
+        record(self.phase, self.start.elapsed());
+    }
+}
+
+/// Restores the previous thread-local log even if the command panics.
+struct ScopeGuard(Option<SharedLog>);
+
+impl Drop for ScopeGuard {
+    fn drop(&mut self) {
+        let prev = self.0.take();
+        CURRENT.with(|current| *current.borrow_mut() = prev);
+    }
+}
+
+/// Run a synchronous command, recording its phases under `command`.
+pub fn trace<T>(command: &'static str, f: impl FnOnce() -> T) -> T {
+    let log = SharedLog::default();
+    let prev = CURRENT.with(|current| current.replace(Some(log.clone())));
+    let guard = ScopeGuard(prev);
+
+    let start = Instant::now();
+    let out = f();
+    let total = start.elapsed();
+
+    drop(guard);
+    finish(command, total, &log);
+    out
+}
+
+/// Run an async command, recording its phases under `command`.
+pub async fn trace_async<F: Future>(command: &'static str, fut: F) -> F::Output {
+    let log = SharedLog::default();
+    let start = Instant::now();
+    let out = TASK_CURRENT.scope(log.clone(), fut).await;
+    finish(command, start.elapsed(), &log);
+    out
+}
+
+/// Run `fut` with its phases collected on their own and return them with
+/// its output, for callers that time several runs within one command. The
+/// phases are also added to the enclosing command.
+pub async fn capture<F: Future>(fut: F) -> (F::Output, Vec<(&'static str, Duration)>) {
+    let log = SharedLog::default();
+    let out = TASK_CURRENT.scope(log.clone(), fut).await;
+    let phases = std::mem::take(&mut log.lock().unwrap().phases);
+    for (phase, elapsed) in &phases {
+        record(phase, *elapsed);
+    }
+    (out, phases)
+}
+
+// ─── Registry ───────────────────────────────────────────────────────────────
+
+#[derive(Debug, Clone, Serialize)]
+pub struct PhaseTiming {
+    pub phase: String,
+    pub micros: u64,
+}
+
+/// One finished command.
+#[derive(Debug, Clone, Serialize)]
+pub struct CommandRecord {
+    pub command: String,
+    /// Unix time in milliseconds when the command finished.
+    pub finished_at_ms: u64,
+    pub total_micros: u64,
+    pub phases: Vec<PhaseTiming>,
+    pub payload_bytes: Option<u64>,
+}
+
+/// Distribution of one phase of one command.
+#[derive(Debug, Clone, Serialize)]
+pub struct PhaseHistogram {
+    pub command: String,
+    pub phase: String,
+    pub count: u64,
+    pub total_micros: u64,
+    pub max_micros: u64,
+    /// Upper bound of the bucket holding the 50th / 95th percentile.
+    pub p50_micros: u64,
+    pub p95_micros: u64,
+    pub buckets: Vec<u64>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct PerfStats {
+    /// Most recent first.
+    pub recent: Vec<CommandRecord>,
+    pub histograms: Vec<PhaseHistogram>,
+}
+
+#[derive(Clone)]
+struct Histogram {
+    count: u64,
+    total_micros: u64,
+    max_micros: u64,
+    buckets: [u64; BUCKETS],
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        Self { count: 0, total_micros: 0, max_micros: 0, buckets: [0; BUCKETS] }
+    }
+}
+
+impl Histogram {
+    fn add(&mut self, micros: u64) {
+        let bucket = (u64::BITS - micros.leading_zeros()) as usize;
+        self.buckets[bucket.min(BUCKETS - 1)] += 1;
+        self.count += 1;
+        self.total_micros += micros;
+        self.max_micros = self.max_micros.max(micros);
+    }
+
+    fn percentile(&self, p: f64) -> u64 {
+        let rank = ((self.count as f64) * p).ceil().max(1.0) as u64;
+        let mut seen = 0;
+        for (i, n) in self.buckets.iter().enumerate() {
+            seen += n;
+            if seen >= rank {
+                return (1u64 << i).min(self.max_micros);
+            }
+        }
+        self.max_micros
+    }
+}
+
+#[derive(Default)]
+struct Registry {
+    recent: VecDeque<CommandRecord>,
+    histograms: HashMap<(String, String), Histogram>,
+}
+
+static REGISTRY: Lazy<Mutex<Registry>> = Lazy::new(|| Mutex::new(Registry::default()));
+
+fn finish(command: &'static str, total: Duration, log: &SharedLog) {
+    let log = match log.lock() {
+        Ok(log) => log,
+        Err(_) => return,
+    };
+    let finished_at_ms = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_millis() as u64)
+        .unwrap_or(0);
+
+    let record = CommandRecord {
+        command: command.to_string(),
+        finished_at_ms,
+        total_micros: total.as_micros() as u64,
+        phases: log
+            .phases
+            .iter()
+            .map(|(phase, d)| PhaseTiming { phase: phase.to_string(), micros: d.as_micros() as u64 })
+            .collect(),
+        payload_bytes: log.payload_bytes,
+    };
+
+    let mut registry = match REGISTRY.lock() {
+        Ok(r) => r,
+        Err(_) => return,
+    };
+    for phase in record.phases.iter().map(|p| (p.phase.as_str(), p.micros)).chain([("total", record.total_micros)]) {
+        registry
+            .histograms
+            .entry((command.to_string(), phase.0.to_string()))
+            .or_default()
+            .add(phase.1);
+    }
+    if registry.recent.len() == RECENT_CAPACITY {
+        registry.recent.pop_back();
+    }
+    registry.recent.push_front(record);
+}
+
+/// Snapshot of recent commands and phase histograms.
+pub fn stats() -> PerfStats {
+    let registry = match REGISTRY.lock() {
+        Ok(r) => r,
+        Err(_) => return PerfStats { recent: Vec::new(), histograms: Vec::new() },
+    };
+
+    let mut histograms: Vec<PhaseHistogram> = registry
+        .histograms
+        .iter()
+        .map(|((command, phase), h)| PhaseHistogram {
+            command: command.clone(),
+            phase: phase.clone(),
+            count: h.count,
+            total_micros: h.total_micros,
+            max_micros: h.max_micros,
+            p50_micros: h.percentile(0.50),
+            p95_micros: h.percentile(0.95),
+            buckets: h.buckets.to_vec(),
+        })
+        .collect();
+    histograms.sort_by(|a, b| (&a.command, &a.phase).cmp(&(&b.command, &b.phase)));
+
+    PerfStats { recent: registry.recent.iter().cloned().collect(), histograms }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_trace_collects_and_sums_phases() {
+        trace("test_trace_collects", || {
+            record("parse", Duration::from_micros(100));
+            record("parse", Duration::from_micros(50));
+            record("format", Duration::from_micros(10));
+        });
+
+        let stats = stats();
+        let rec = stats
+            .recent
+            .iter()
+            .find(|r| r.command == "test_trace_collects")
+            .expect("command recorded");
+        assert_eq!(rec.phases.len(), 2);
+        assert_eq!(rec.phases[0].phase, "parse");
+        assert_eq!(rec.phases[0].micros, 150);
+    }
+
+    #[tokio::test]
+    async fn test_capture_separates_runs_and_forwards_phases() {
+        trace_async("test_capture", async {
+            for micros in [10, 20] {
+                let ((), phases) = capture(async { record("fetch", Duration::from_micros(micros)) }).await;
+                assert_eq!(phases, [("fetch", Duration::from_micros(micros))]);
+            }
+        })
+        .await;
+
+        let stats = stats();
+        let rec = stats.recent.iter().find(|r| r.command == "test_capture").expect("command recorded");
+        assert_eq!(rec.phases[0].micros, 30);
+    }
+
+    #[test]
+    fn test_span_outside_trace_is_noop() {
+        let _span = span("orphan");
+        record("orphan", Duration::from_micros(1));
+    }
+
+    #[test]
+    fn test_histogram_percentiles() {
+        let mut h = Histogram::default();
+        for micros in [1, 2, 3, 100, 1000] {
+            h.add(micros);
+        }
+        assert_eq!(h.count, 5);
+        assert_eq!(h.max_micros, 1000);
+        assert!(h.percentile(0.5) <= 4);
+        assert_eq!(h.percentile(1.0), 1000);
+    }
+}
@@ -1,12 +1,34 @@
-import { invoke } from "@tauri-apps/api/core";
+import { Channel, invoke } from "@tauri-apps/api/core";
 import type {
+  AggregateRequest,
+  AggregateResult,
+  BenchReport,
+  BenchRequest,
+  CellValue,
+  ChecksumReport,
+  ChecksumRequest,
   Config,
   ConnectionFields,
+  ConnectionHealth,
   DbConfig,
+  DiffMode,
+  ExportProgress,
+  ExportReport,
+  ExportRequest,
+  FanoutReport,
+  HistoryEntry,
+  HistoryFilter,
   IdInfo,
+  MemoryStats,
   ParsedSqlServerUrl,
+  PerfStats,
   ProcessResult,
+  QueryEvent,
   QueryResult,
+  ReplayReport,
+  SessionReport,
+  ViewPage,
+  ViewRequest,
 } from "../types";
 
 // ─── Log Parser ─────────────────────────────────────────────────────────────
@@ -69,11 +91,230 @@ export async function testConnection(config: DbConfig): Promise<string> {
   return invoke<string>("test_connection", { config });
 }
 
-export async function executeQuery(
+export async function warmConnection(connectionId: string): Promise<void> {
+  return invoke<void>("warm_connection", { connectionId });
+}
+
+/** Probe every saved connection and return each one's recent timings. */
+export async function probeConnections(): Promise<ConnectionHealth[]> {
+  return invoke<ConnectionHealth[]>("probe_connections");
+}
+
+export interface QueryStreamHandlers {
+  /** Called as each result set starts; the batches after it are its rows. */
+  onColumns: (columns: string[]) => void;
+  /**
+   * Called per batch, either JSON rows or a columnar frame (see
+   * `utils/columnar.ts`); acknowledge it with `ackResultBatches` once shown.
+   */
+  onRows: (rows: CellValue[][] | ArrayBuffer) => void;
+}
+
+/**
+ * Run a query, streaming its rows to `handlers` in columnar batches. Resolves
+ * with the summary (without rows) once the last batch has been delivered.
+ * With `capturePlan` the summary also carries the actual plan.
+ */
+export function executeQuery(
   connectionId: string,
   sql: string,
+  queryId: string,
+  handlers: QueryStreamHandlers,
+  capturePlan = false,
 ): Promise<QueryResult> {
-  return invoke<QueryResult>("execute_query", { connectionId, sql });
+  return new Promise((resolve, reject) => {
+    const onEvent = new Channel<QueryEvent | ArrayBuffer>();
+    onEvent.onmessage = (event) => {
+      if (event instanceof ArrayBuffer) {
+        handlers.onRows(event);
+        return;
+      }
+      switch (event.kind) {
+        case "columns":
+          handlers.onColumns(event.columns);
+          break;
+        case "rows":
+          handlers.onRows(event.rows);
+          break;
+        case "finished":
+          resolve(event.result);
+          break;
+      }
+    };
+    invoke<void>("execute_query", {
+      connectionId,
+      sql,
+      queryId,
+      format: "columnar",
+      capturePlan,
+      onEvent,
+    }).catch(reject);
+  });
+}
+
+/**
+ * Stream every row of `sql` into a CSV/TSV file without loading it into the
+ * webview. `queryId` can be passed to `cancelQuery`.
+ */
+export async function exportQuery(
+  connectionId: string,
+  sql: string,
+  request: ExportRequest,
+  queryId: string,
+  onProgress: (progress: ExportProgress) => void,
+): Promise<ExportReport> {
+  const channel = new Channel<ExportProgress>();
+  channel.onmessage = onProgress;
+  return invoke<ExportReport>("export_query", {
+    connectionId,
+    sql,
+    request,
+    queryId,
+    onProgress: channel,
+  });
+}
+
+export async function cancelQuery(queryId: string): Promise<void> {
+  return invoke<void>("cancel_query", { queryId });
+}
+
+/** Drop cached results of one connection, or of all when none is given. */
+export async function invalidateResultCache(connectionId?: string): Promise<void> {
+  return invoke<void>("invalidate_result_cache", { connectionId: connectionId ?? null });
+}
+
+/**
+ * Replay logged executions of a template with their parameters bound.
+ * `queryId` can be passed to `cancelQuery`.
+ */
+export async function replayGroup(
+  connectionId: string,
+  templateSql: string,
+  executions: { execution_index: number; params: string[] }[],
+  queryId: string,
+): Promise<ReplayReport> {
+  return invoke<ReplayReport>("replay_group", {
+    connectionId,
+    templateSql,
+    executions,
+    queryId,
+  });
+}
+
+/**
+ * Replay the statements of one ID in log order inside a transaction that is
+ * rolled back. `queryId` can be passed to `cancelQuery`.
+ */
+export async function replaySession(
+  connectionId: string,
+  statements: { execution_index: number; sql: string; params: string[] }[],
+  queryId: string,
+): Promise<SessionReport> {
+  return invoke<SessionReport>("replay_session", {
+    connectionId,
+    statements,
+    queryId,
+  });
+}
+
+/**
+ * Run `sql` on several connections at once and diff their rows against the
+ * first. `queryId` can be passed to `cancelQuery`.
+ */
+export async function fanOutQuery(
+  connectionIds: string[],
+  sql: string,
+  mode: DiffMode,
+  queryId: string,
+): Promise<FanoutReport> {
+  return invoke<FanoutReport>("fan_out_query", {
+    connectionIds,
+    sql,
+    mode,
+    queryId,
+  });
+}
+
+/**
+ * Compare a table between connections by server-side checksums, bisecting
+ * the key ranges that differ. `queryId` can be passed to `cancelQuery`.
+ */
+export async function compareTableChecksums(
+  connectionIds: string[],
+  request: ChecksumRequest,
+  queryId: string,
+): Promise<ChecksumReport> {
+  return invoke<ChecksumReport>("compare_table_checksums", {
+    connectionIds,
+    request,
+    queryId,
+  });
+}
+
+/**
+ * Run `sql` repeatedly on a pooled connection and summarise its server,
+ * transfer and decode time. `queryId` can be passed to `cancelQuery`.
+ */
+export async function benchmarkQuery(
+  connectionId: string,
+  sql: string,
+  request: BenchRequest,
+  queryId: string,
+): Promise<BenchReport> {
+  return invoke<BenchReport>("benchmark_query", {
+    connectionId,
+    sql,
+    request,
+    queryId,
+  });
+}
+
+/** Recorded executions matching `filter`, newest first. */
+export async function searchHistory(
+  filter: HistoryFilter,
+): Promise<HistoryEntry[]> {
+  return invoke<HistoryEntry[]>("search_history", { filter });
+}
+
+export async function ackResultBatches(
+  queryId: string,
+  batches: number,
+): Promise<void> {
+  return invoke<void>("ack_result_batches", { queryId, batches });
+}
+
+/** Rows of a spilled result set, as one columnar frame. */
+export async function fetchResultPage(
+  resultId: string,
+  resultSet: number,
+  offset: number,
+  limit: number,
+): Promise<ArrayBuffer> {
+  return invoke<ArrayBuffer>("fetch_result_page", {
+    resultId,
+    resultSet,
+    offset,
+    limit,
+  });
+}
+
+/** A sorted and filtered page of a finished result. */
+export async function viewResult(
+  resultId: string,
+  request: ViewRequest,
+): Promise<ViewPage> {
+  return invoke<ViewPage>("view_result", { resultId, request });
+}
+
+export async function aggregateResult(
+  resultId: string,
+  request: AggregateRequest,
+): Promise<AggregateResult> {
+  return invoke<AggregateResult>("aggregate_result", { resultId, request });
+}
+
+export async function closeResult(resultId: string): Promise<void> {
+  return invoke<void>("close_result", { resultId });
 }
 
 // ─── Config ─────────────────────────────────────────────────────────────────
@@ -101,3 +342,13 @@ export async function parseJdbcUrl(
 export async function buildJdbcUrl(fields: ConnectionFields): Promise<string> {
   return invoke<string>("build_jdbc_url_cmd", { fields });
 }
+
+// ─── Perf ───────────────────────────────────────────────────────────────────
+
+export async function getPerfStats(): Promise<PerfStats> {
+  return invoke<PerfStats>("get_perf_stats");
+}
+
+export async function getMemoryStats(): Promise<MemoryStats> {
+  return invoke<MemoryStats>("get_memory_stats");
+}
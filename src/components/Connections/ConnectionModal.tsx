@@ -46,7 +46,7 @@ export default function ConnectionModal({
   } | null>(null);
   const [saving, setSaving] = useState(false);
 
-  const updateField = (key: keyof DbConfig, value: string | DbType) => {
+  const updateField = (key: keyof DbConfig, value: string | number | DbType) => {
     setConn((prev) => ({ ...prev, [key]: value }));
     setTestResult(null);
   };
@@ -306,6 +306,42 @@ export default function ConnectionModal({
           />
         </div>
 
+        <hr style={{ borderColor: "var(--border)", margin: "12px 0" }} />
+
+        {/* Limits */}
+        <h3 style={{ fontSize: 14, marginBottom: 8 }}>Limits</h3>
+        <div className="form-row">
+          <label>Timeout (s, 0 = none):</label>
+          <input
+            type="number"
+            min={0}
+            value={conn.statement_timeout_secs}
+            onChange={(e) =>
+              updateField("statement_timeout_secs", Math.max(0, Number(e.target.value) || 0))
+            }
+          />
+        </div>
+        <div className="form-row">
+          <label>Max rows (0 = all):</label>
+          <input
+            type="number"
+            min={0}
+            value={conn.max_rows}
+            onChange={(e) => updateField("max_rows", Math.max(0, Number(e.target.value) || 0))}
+          />
+        </div>
+        <div className="form-row">
+          <label>Cache TTL (s, 0 = off):</label>
+          <input
+            type="number"
+            min={0}
+            value={conn.cache_ttl_secs}
+            onChange={(e) =>
+              updateField("cache_ttl_secs", Math.max(0, Number(e.target.value) || 0))
+            }
+          />
+        </div>
+
         {/* Test Status */}
         {testing && (
           <div className="flex-row mt-md">
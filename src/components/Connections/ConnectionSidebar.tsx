@@ -1,9 +1,16 @@
-import { useState } from "react";
-import { deleteConnection } from "../../api/commands";
-import type { DbConfig } from "../../types";
+import { useEffect, useState } from "react";
+import {
+  deleteConnection,
+  probeConnections,
+  warmConnection,
+} from "../../api/commands";
+import type { ConnectionHealth, DbConfig, ProbeSample } from "../../types";
 import ConnectionModal from "./ConnectionModal";
 import { v4 as uuidv4 } from "../../utils/uuid";
 
+/** How often every saved connection is probed while the sidebar is shown. */
+const PROBE_INTERVAL_MS = 60_000;
+
 interface ConnectionSidebarProps {
   connections: DbConfig[];
   activeConnectionId: string | null;
@@ -23,6 +30,30 @@ export default function ConnectionSidebar({
   const [editingConnection, setEditingConnection] = useState<DbConfig | null>(
     null,
   );
+  const [health, setHealth] = useState<Record<string, ProbeSample[]>>({});
+
+  // Probe in the background; the backend bounds how many run at once
+  useEffect(() => {
+    if (connections.length === 0) return;
+    let active = true;
+    const probe = () =>
+      probeConnections()
+        .then((results: ConnectionHealth[]) => {
+          if (!active) return;
+          setHealth(
+            Object.fromEntries(
+              results.map((h) => [h.connection_id, h.samples]),
+            ),
+          );
+        })
+        .catch((e) => console.warn("Health probe failed", e));
+    probe();
+    const timer = setInterval(probe, PROBE_INTERVAL_MS);
+    return () => {
+      active = false;
+      clearInterval(timer);
+    };
+  }, [connections]);
 
   const handleNew = () => {
     setEditingConnection({
@@ -33,6 +64,9 @@ export default function ConnectionSidebar({
       user: "",
       password: "",
       encoding: null,
+      statement_timeout_secs: 0,
+      max_rows: 0,
+      cache_ttl_secs: 0,
     });
     setShowModal(true);
   };
@@ -72,9 +106,17 @@ export default function ConnectionSidebar({
             <div
               key={conn.id}
               className={`sidebar-item ${activeConnectionId === conn.id ? "selected" : ""}`}
-              onClick={() => onSelectConnection(conn.id)}
+              onClick={() => {
+                onSelectConnection(conn.id);
+                // Log in ahead of the first query; failures surface on execute
+                warmConnection(conn.id).catch((e) => console.warn("Warm-up failed", e));
+              }}
             >
-              <span>{conn.name}</span>
+              <span className="flex-row" style={{ gap: 6 }}>
+                <HealthDot samples={health[conn.id]} />
+                {conn.name}
+              </span>
+              <Sparkline samples={health[conn.id]} />
               <div className="actions">
                 <button
                   onClick={(e) => {
@@ -122,3 +164,47 @@ export default function ConnectionSidebar({
     </>
   );
 }
+
+function describe(sample: ProbeSample): string {
+  if (sample.error) return sample.error;
+  const ms = (v: number | null) => (v === null ? "n/a" : `${v.toFixed(1)}ms`);
+  return `connect ${ms(sample.connect_ms)}, login ${ms(sample.login_ms)}, round trip ${ms(sample.round_trip_ms)}`;
+}
+
+function HealthDot({ samples }: { samples?: ProbeSample[] }) {
+  const last = samples?.[samples.length - 1];
+  const color = !last
+    ? "var(--comment)"
+    : last.error
+      ? "var(--red)"
+      : "var(--green)";
+  return (
+    <span
+      className="health-dot"
+      style={{ background: color }}
+      title={last ? describe(last) : "Not probed yet"}
+    />
+  );
+}
+
+/** Round-trip latency of the recent probes; failures drop to the baseline. */
+function Sparkline({ samples }: { samples?: ProbeSample[] }) {
+  if (!samples || samples.length < 2) return null;
+  const width = 48;
+  const height = 14;
+  const values = samples.map((s) => s.round_trip_ms ?? 0);
+  const max = Math.max(...values, 1);
+  const points = values
+    .map((v, i) => {
+      const x = (i / (values.length - 1)) * width;
+      const y = height - (v / max) * height;
+      return `${x.toFixed(1)},${y.toFixed(1)}`;
+    })
+    .join(" ");
+  return (
+    <svg className="sparkline" width={width} height={height}>
+      <title>{`Round trip, max ${max.toFixed(1)}ms`}</title>
+      <polyline points={points} fill="none" stroke="var(--cyan)" strokeWidth={1} />
+    </svg>
+  );
+}
@@ -1,8 +1,9 @@
-import type { ReactNode } from "react";
+import { useState, type ReactNode } from "react";
 import type { AppTab } from "../App";
 import type { Config } from "../types";
 import { open } from "@tauri-apps/plugin-dialog";
 import { saveConfig } from "../api/commands";
+import PerfPanel from "./Perf/PerfPanel";
 
 interface LayoutProps {
   activeTab: AppTab;
@@ -30,6 +31,8 @@ export default function Layout({
   status,
   children,
 }: LayoutProps) {
+  const [showPerf, setShowPerf] = useState(false);
+
   const handleBrowse = async () => {
     const selected = await open({
       filters: [
@@ -118,10 +121,20 @@ export default function Layout({
       {/* Content */}
       {children}
 
+      {showPerf && <PerfPanel config={config} updateConfig={updateConfig} />}
+
       {/* Status Bar */}
       <div className="statusbar">
         <span>{status}</span>
-        <span>v2.1.0</span>
+        <span>
+          <button
+            className={`statusbar-toggle ${showPerf ? "active" : ""}`}
+            onClick={() => setShowPerf((v) => !v)}
+          >
+            Perf
+          </button>
+          v2.1.0
+        </span>
       </div>
     </div>
   );
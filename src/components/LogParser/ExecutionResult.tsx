@@ -1,17 +1,36 @@
 import { useState } from "react";
-import { copyToClipboard } from "../../api/commands";
-import type { ProcessResult, QueryGroup, Execution } from "../../types";
+import {
+  cancelQuery,
+  copyToClipboard,
+  replayGroup,
+  replaySession,
+} from "../../api/commands";
+import type {
+  ProcessResult,
+  QueryGroup,
+  Execution,
+  ReplayReport,
+  SessionReport,
+  SessionStep,
+} from "../../types";
+import { cellValueToString } from "../../utils/columnar";
+import { v4 as uuidv4 } from "../../utils/uuid";
 
 interface ExecutionResultProps {
   result: ProcessResult;
   formatSql: boolean;
   onExecuteSql: (sql: string) => void;
+  /** Connection that "Replay" runs groups against, if one is chosen. */
+  replayConnectionId: string | null;
+  setStatus: (status: string) => void;
 }
 
 export default function ExecutionResult({
   result,
   formatSql,
   onExecuteSql,
+  replayConnectionId,
+  setStatus,
 }: ExecutionResultProps) {
   if (result.error) {
     return (
@@ -25,6 +44,11 @@ export default function ExecutionResult({
 
   return (
     <div>
+      <SessionReplay
+        executions={result.executions}
+        replayConnectionId={replayConnectionId}
+        setStatus={setStatus}
+      />
       {result.groups.map((group, gIdx) => (
         <GroupView
           key={gIdx}
@@ -32,6 +56,8 @@ export default function ExecutionResult({
           groupIndex={gIdx}
           formatSql={formatSql}
           onExecuteSql={onExecuteSql}
+          replayConnectionId={replayConnectionId}
+          setStatus={setStatus}
         />
       ))}
     </div>
@@ -43,13 +69,48 @@ function GroupView({
   groupIndex,
   formatSql,
   onExecuteSql,
+  replayConnectionId,
+  setStatus,
 }: {
   group: QueryGroup;
   groupIndex: number;
   formatSql: boolean;
   onExecuteSql: (sql: string) => void;
+  replayConnectionId: string | null;
+  setStatus: (status: string) => void;
 }) {
   const [templateExpanded, setTemplateExpanded] = useState(false);
+  const [replayId, setReplayId] = useState<string | null>(null);
+  const [replay, setReplay] = useState<ReplayReport | null>(null);
+
+  const handleReplay = async () => {
+    if (!replayConnectionId) {
+      setStatus("Select a connection to replay on");
+      return;
+    }
+    const queryId = uuidv4();
+    setReplayId(queryId);
+    setReplay(null);
+    setStatus(`Replaying ${group.executions.length} executions...`);
+    try {
+      const report = await replayGroup(
+        replayConnectionId,
+        group.template_sql,
+        group.executions,
+        queryId,
+      );
+      setReplay(report);
+      const failed = report.runs.filter((r) => r.error).length;
+      setStatus(
+        `Replayed ${report.runs.length} executions in ${report.total_ms.toFixed(1)}ms` +
+          (failed ? `, ${failed} failed` : ""),
+      );
+    } catch (e) {
+      setStatus(`Replay failed: ${e}`);
+    } finally {
+      setReplayId(null);
+    }
+  };
 
   const daoName =
     group.executions[0]?.dao_file || "Unknown DAO";
@@ -78,7 +139,18 @@ function GroupView({
             >
               Copy Template
             </button>
+            <button
+              className="btn-pink"
+              disabled={replayId !== null || !replayConnectionId}
+              onClick={handleReplay}
+            >
+              {replayId ? "Replaying..." : "Replay Group"}
+            </button>
+            {replayId && (
+              <button onClick={() => cancelQuery(replayId)}>Cancel</button>
+            )}
           </div>
+          {replay && <ReplayReportView report={replay} />}
           <div className="execution-item">
             <div className="sql-display">
               {group.formatted_template_sql || group.template_sql}
@@ -103,6 +175,132 @@ function GroupView({
   );
 }
 
+function SessionReplay({
+  executions,
+  replayConnectionId,
+  setStatus,
+}: {
+  executions: Execution[];
+  replayConnectionId: string | null;
+  setStatus: (status: string) => void;
+}) {
+  const [replayId, setReplayId] = useState<string | null>(null);
+  const [report, setReport] = useState<SessionReport | null>(null);
+
+  const handleReplay = async () => {
+    if (!replayConnectionId) {
+      setStatus("Select a connection to replay on");
+      return;
+    }
+    const queryId = uuidv4();
+    setReplayId(queryId);
+    setReport(null);
+    setStatus(`Replaying ${executions.length} statements in a transaction...`);
+    try {
+      const res = await replaySession(replayConnectionId, executions, queryId);
+      setReport(res);
+      const failed = res.steps.find((s) => s.error);
+      setStatus(
+        failed
+          ? `Session stopped at #${failed.execution_index}; rolled back`
+          : `Session replayed in ${res.total_ms.toFixed(1)}ms; rolled back`,
+      );
+    } catch (e) {
+      setStatus(`Session replay failed: ${e}`);
+    } finally {
+      setReplayId(null);
+    }
+  };
+
+  return (
+    <div className="mb-md">
+      <div className="flex-row mb-sm">
+        <button
+          className="btn-pink"
+          disabled={replayId !== null || !replayConnectionId}
+          onClick={handleReplay}
+        >
+          {replayId ? "Replaying..." : "Replay Session (rolled back)"}
+        </button>
+        {replayId && (
+          <button onClick={() => cancelQuery(replayId)}>Cancel</button>
+        )}
+        {report && (
+          <span className="meta-info">
+            {report.steps.length} statements in {report.total_ms.toFixed(1)}ms
+            {report.skipped > 0 && `, ${report.skipped} skipped`}
+          </span>
+        )}
+      </div>
+      {report && (
+        <table className="result-table">
+          <thead>
+            <tr>
+              <th>Index</th>
+              <th>SQL</th>
+              <th>Latency</th>
+              <th>Rows</th>
+              <th>First row / Error</th>
+            </tr>
+          </thead>
+          <tbody>
+            {report.steps.map((step, i) => (
+              <tr key={i}>
+                <td>#{step.execution_index}</td>
+                <td>{step.sql.slice(0, 60)}</td>
+                <td className="perf-num">{step.elapsed_ms.toFixed(1)}ms</td>
+                <td className="perf-num">{step.rows}</td>
+                <td style={step.error ? { color: "var(--red)" } : undefined}>
+                  {step.error ?? firstRowPreview(step)}
+                </td>
+              </tr>
+            ))}
+          </tbody>
+        </table>
+      )}
+    </div>
+  );
+}
+
+function firstRowPreview(step: SessionStep): string {
+  if (!step.first_row) return "";
+  return step.first_row
+    .map((cell, i) => `${step.columns[i] ?? i}=${cellValueToString(cell)}`)
+    .join(", ");
+}
+
+function ReplayReportView({ report }: { report: ReplayReport }) {
+  return (
+    <div className="execution-item mb-sm">
+      <div className="meta-info">
+        {report.prepare_ms !== null &&
+          `Prepared in ${report.prepare_ms.toFixed(1)}ms, `}
+        total {report.total_ms.toFixed(1)}ms
+      </div>
+      <table className="result-table">
+        <thead>
+          <tr>
+            <th>Index</th>
+            <th>Latency</th>
+            <th>Rows</th>
+            <th>Error</th>
+          </tr>
+        </thead>
+        <tbody>
+          {report.runs.map((run, i) => (
+            <tr key={i}>
+              <td>#{run.execution_index}</td>
+              <td className="perf-num">{run.elapsed_ms.toFixed(1)}ms</td>
+              <td className="perf-num">{run.rows}</td>
+              <td style={{ color: "var(--red)" }}>{run.error}</td>
+            </tr>
+          ))}
+        </tbody>
+      </table>
+    </div>
+  );
+}
+
 function ExecutionView({
   exec,
   defaultExpanded,
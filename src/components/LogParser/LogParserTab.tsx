@@ -1,6 +1,6 @@
-import { useState, useCallback } from "react";
-import { processQuery } from "../../api/commands";
-import type { Config, ProcessResult } from "../../types";
+import { useState, useCallback, useEffect } from "react";
+import { listConnections, processQuery } from "../../api/commands";
+import type { Config, DbConfig, ProcessResult } from "../../types";
 import IdSidebar from "./IdSidebar";
 import ExecutionResult from "./ExecutionResult";
 
@@ -20,6 +20,16 @@ export default function LogParserTab({
   const [searchInput, setSearchInput] = useState("");
   const [selectedId, setSelectedId] = useState("");
   const [result, setResult] = useState<ProcessResult | null>(null);
+  const [connections, setConnections] = useState<DbConfig[]>([]);
+  const [replayConnectionId, setReplayConnectionId] = useState<string | null>(
+    null,
+  );
+
+  useEffect(() => {
+    listConnections()
+      .then(setConnections)
+      .catch((e) => setStatus(`Failed to load connections: ${e}`));
+  }, [setStatus]);
 
   const doSearch = useCallback(
     async (id: string) => {
@@ -110,6 +120,19 @@ export default function LogParserTab({
           <button className="btn-primary" onClick={() => doSearch(searchInput)}>
             Search
           </button>
+          <span style={{ fontSize: 13, marginLeft: "auto" }}>Replay on:</span>
+          <select
+            value={replayConnectionId || ""}
+            onChange={(e) => setReplayConnectionId(e.target.value || null)}
+            style={{ minWidth: 160 }}
+          >
+            <option value="">Select Connection</option>
+            {connections.map((conn) => (
+              <option key={conn.id} value={conn.id}>
+                {conn.name}
+              </option>
+            ))}
+          </select>
         </div>
 
         {/* Results */}
@@ -118,6 +141,8 @@ export default function LogParserTab({
             result={result}
             formatSql={config.format_sql}
             onExecuteSql={onSwitchToExecutor}
+            replayConnectionId={replayConnectionId}
+            setStatus={setStatus}
           />
         )}
 
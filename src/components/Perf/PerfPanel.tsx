@@ -0,0 +1,217 @@
+import { useEffect, useState } from "react";
+import type { CommandRecord, Config, MemoryStats, PerfStats } from "../../types";
+import { getMemoryStats, getPerfStats } from "../../api/commands";
+
+interface PerfPanelProps {
+  config: Config;
+  updateConfig: (patch: Partial<Config>) => Promise<void>;
+}
+
+const POLL_INTERVAL_MS = 2000;
+
+const PHASE_COLORS: Record<string, string> = {
+  file_read: "var(--cyan)",
+  decode: "var(--green)",
+  regex_match: "var(--purple)",
+  dao_lookahead: "var(--pink)",
+  fill_params: "var(--orange)",
+  format: "var(--yellow)",
+  group: "var(--red)",
+  connect: "var(--cyan)",
+  query: "var(--purple)",
+  fetch: "var(--green)",
+  row_decode: "var(--orange)",
+  serialize: "var(--pink)",
+};
+
+function formatMicros(micros: number): string {
+  if (micros >= 1_000_000) return `${(micros / 1_000_000).toFixed(2)} s`;
+  if (micros >= 1_000) return `${(micros / 1_000).toFixed(1)} ms`;
+  return `${micros} µs`;
+}
+
+function formatBytes(bytes: number | null | undefined): string {
+  if (bytes === null || bytes === undefined) return "-";
+  if (bytes >= 1024 * 1024) return `${(bytes / 1024 / 1024).toFixed(1)} MB`;
+  if (bytes >= 1024) return `${(bytes / 1024).toFixed(1)} KB`;
+  return `${bytes} B`;
+}
+
+/** Stacked bar of one command's phases, scaled to its total time. */
+function PhaseBar({ record }: { record: CommandRecord }) {
+  const total = Math.max(record.total_micros, 1);
+  return (
+    <div className="perf-bar">
+      {record.phases.map((p) => (
+        <span
+          key={p.phase}
+          title={`${p.phase}: ${formatMicros(p.micros)}`}
+          style={{
+            width: `${(p.micros / total) * 100}%`,
+            background: PHASE_COLORS[p.phase] ?? "var(--comment)",
+          }}
+        />
+      ))}
+    </div>
+  );
+}
+
+export default function PerfPanel({ config, updateConfig }: PerfPanelProps) {
+  const [stats, setStats] = useState<PerfStats | null>(null);
+  const [memory, setMemory] = useState<MemoryStats | null>(null);
+
+  useEffect(() => {
+    let cancelled = false;
+    const refresh = async () => {
+      try {
+        const [next, mem] = await Promise.all([getPerfStats(), getMemoryStats()]);
+        if (!cancelled) {
+          setStats(next);
+          setMemory(mem);
+        }
+      } catch (e) {
+        console.error("Failed to load perf stats", e);
+      }
+    };
+    refresh();
+    const timer = setInterval(refresh, POLL_INTERVAL_MS);
+    return () => {
+      cancelled = true;
+      clearInterval(timer);
+    };
+  }, []);
+
+  if (!stats) {
+    return <div className="perf-panel">Loading…</div>;
+  }
+
+  return (
+    <div className="perf-panel">
+      <div className="perf-section">
+        <h3>Recent commands</h3>
+        <table className="result-table">
+          <thead>
+            <tr>
+              <th>Command</th>
+              <th>Total</th>
+              <th>Phases</th>
+              <th>Payload</th>
+            </tr>
+          </thead>
+          <tbody>
+            {stats.recent.map((r, i) => (
+              <tr
+                key={`${r.finished_at_ms}-${i}`}
+                title={r.phases
+                  .map((p) => `${p.phase}: ${formatMicros(p.micros)}`)
+                  .join("\n")}
+              >
+                <td>{r.command}</td>
+                <td className="perf-num">{formatMicros(r.total_micros)}</td>
+                <td>
+                  <PhaseBar record={r} />
+                </td>
+                <td className="perf-num">{formatBytes(r.payload_bytes)}</td>
+              </tr>
+            ))}
+          </tbody>
+        </table>
+      </div>
+
+      <div className="perf-section" style={{ flex: "0 0 220px" }}>
+        <h3>Memory</h3>
+        <table className="result-table">
+          <thead>
+            <tr>
+              <th>Subsystem</th>
+              <th>Current</th>
+              <th>Peak</th>
+            </tr>
+          </thead>
+          <tbody>
+            {memory?.subsystems.map((s) => (
+              <tr key={s.subsystem}>
+                <td>{s.subsystem}</td>
+                <td className="perf-num">{formatBytes(s.current_bytes)}</td>
+                <td className="perf-num">{formatBytes(s.peak_bytes)}</td>
+              </tr>
+            ))}
+            {memory?.heap && (
+              <tr>
+                <td>process heap</td>
+                <td className="perf-num">{formatBytes(memory.heap.current_bytes)}</td>
+                <td className="perf-num">{formatBytes(memory.heap.peak_bytes)}</td>
+              </tr>
+            )}
+          </tbody>
+        </table>
+        <label className="flex-row mt-md">
+          Budget (MB, 0 = unlimited)
+          <input
+            type="number"
+            min={0}
+            value={config.memory_budget_mb}
+            onChange={(e) =>
+              updateConfig({ memory_budget_mb: Math.max(0, Number(e.target.value) || 0) })
+            }
+            style={{ width: 80 }}
+          />
+        </label>
+        <label className="flex-row mt-sm">
+          Spill results to disk after (rows, 0 = never)
+          <input
+            type="number"
+            min={0}
+            value={config.spill_after_rows}
+            onChange={(e) =>
+              updateConfig({ spill_after_rows: Math.max(0, Number(e.target.value) || 0) })
+            }
+            style={{ width: 100 }}
+          />
+          or MB
+          <input
+            type="number"
+            min={0}
+            value={config.spill_after_mb}
+            onChange={(e) =>
+              updateConfig({ spill_after_mb: Math.max(0, Number(e.target.value) || 0) })
+            }
+            style={{ width: 80 }}
+          />
+        </label>
+        <div className="meta-info mt-sm">
+          In use: {formatBytes(memory?.charged_bytes)}
+          {memory?.budget_bytes ? ` of ${formatBytes(memory.budget_bytes)}` : ""}
+        </div>
+      </div>
+
+      <div className="perf-section">
+        <h3>Phase distribution</h3>
+        <table className="result-table">
+          <thead>
+            <tr>
+              <th>Command</th>
+              <th>Phase</th>
+              <th>Count</th>
+              <th>p50</th>
+              <th>p95</th>
+              <th>Max</th>
+            </tr>
+          </thead>
+          <tbody>
+            {stats.histograms.map((h) => (
+              <tr key={`${h.command}/${h.phase}`}>
+                <td>{h.command}</td>
+                <td>{h.phase}</td>
+                <td className="perf-num">{h.count}</td>
+                <td className="perf-num">{formatMicros(h.p50_micros)}</td>
+                <td className="perf-num">{formatMicros(h.p95_micros)}</td>
+                <td className="perf-num">{formatMicros(h.max_micros)}</td>
+              </tr>
+            ))}
+          </tbody>
+        </table>
+      </div>
+    </div>
+  );
+}
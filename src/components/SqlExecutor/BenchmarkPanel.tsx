@@ -0,0 +1,159 @@
+import { useState } from "react";
+import { benchmarkQuery, cancelQuery } from "../../api/commands";
+import type { BenchReport, DbConfig, Distribution } from "../../types";
+import { v4 as uuidv4 } from "../../utils/uuid";
+
+interface BenchmarkPanelProps {
+  sql: string;
+  connection: DbConfig | undefined;
+  setStatus: (status: string) => void;
+}
+
+/**
+ * Runs the editor's SQL repeatedly on the active connection and shows the
+ * spread of server, transfer and decode time.
+ */
+export default function BenchmarkPanel({
+  sql,
+  connection,
+  setStatus,
+}: BenchmarkPanelProps) {
+  const [expanded, setExpanded] = useState(false);
+  const [iterations, setIterations] = useState(20);
+  const [warmup, setWarmup] = useState(2);
+  const [setupSql, setSetupSql] = useState("");
+  const [runId, setRunId] = useState<string | null>(null);
+  const [report, setReport] = useState<BenchReport | null>(null);
+
+  const handleRun = async () => {
+    if (!connection) {
+      setStatus("Select a connection first");
+      return;
+    }
+    if (!sql.trim()) {
+      setStatus("Enter a SQL query");
+      return;
+    }
+    const queryId = uuidv4();
+    setRunId(queryId);
+    setReport(null);
+    setStatus(`Benchmarking ${iterations} runs on ${connection.name}...`);
+    try {
+      const res = await benchmarkQuery(
+        connection.id,
+        sql,
+        { iterations, warmup, setup_sql: setupSql.trim() || null },
+        queryId,
+      );
+      setReport(res);
+      setStatus(
+        `Benchmark done: p50 ${res.total.p50_ms.toFixed(1)}ms, p95 ${res.total.p95_ms.toFixed(1)}ms over ${res.iterations} runs`,
+      );
+    } catch (e) {
+      setStatus(`Benchmark failed: ${e}`);
+    } finally {
+      setRunId(null);
+    }
+  };
+
+  const setupHint =
+    connection?.db_type === "SqlServer"
+      ? " (e.g. CHECKPOINT; DBCC DROPCLEANBUFFERS)"
+      : connection?.db_type === "Postgres"
+        ? " (e.g. DISCARD ALL)"
+        : "";
+
+  return (
+    <div className="mb-sm">
+      <div
+        className="collapsible-header"
+        onClick={() => setExpanded(!expanded)}
+      >
+        <span className={`arrow ${expanded ? "open" : ""}`}>&#9654;</span>
+        <span style={{ color: "var(--cyan)" }}>Benchmark</span>
+      </div>
+      {expanded && (
+        <div className="collapsible-body">
+          <div className="flex-row mb-sm" style={{ flexWrap: "wrap" }}>
+            <label className="flex-row" style={{ fontSize: 12 }}>
+              Runs
+              <input
+                type="number"
+                min={1}
+                max={1000}
+                value={iterations}
+                onChange={(e) =>
+                  setIterations(Math.max(1, Number(e.target.value) || 1))
+                }
+                style={{ width: 70 }}
+              />
+            </label>
+            <label className="flex-row" style={{ fontSize: 12 }}>
+              Warm-up
+              <input
+                type="number"
+                min={0}
+                max={100}
+                value={warmup}
+                onChange={(e) =>
+                  setWarmup(Math.max(0, Number(e.target.value) || 0))
+                }
+                style={{ width: 60 }}
+              />
+            </label>
+            <input
+              placeholder={`SQL before each run, untimed${setupHint}`}
+              value={setupSql}
+              onChange={(e) => setSetupSql(e.target.value)}
+              style={{ flex: 1 }}
+            />
+            <button
+              className="btn-primary"
+              disabled={runId !== null || !connection}
+              onClick={handleRun}
+            >
+              {runId ? "Running..." : "Run Benchmark"}
+            </button>
+            {runId && <button onClick={() => cancelQuery(runId)}>Cancel</button>}
+          </div>
+
+          {report && (
+            <>
+              <div className="meta-info">
+                {report.iterations} runs after {report.warmup} warm-up,{" "}
+                {report.rows} rows each
+              </div>
+              <table className="result-table">
+                <thead>
+                  <tr>
+                    <th>Phase</th>
+                    <th>p50</th>
+                    <th>p95</th>
+                    <th>max</th>
+                  </tr>
+                </thead>
+                <tbody>
+                  <PhaseRow label="Server execution" d={report.server} />
+                  <PhaseRow label="Network transfer" d={report.transfer} />
+                  <PhaseRow label="Client decode" d={report.decode} />
+                  <PhaseRow label="Total" d={report.total} />
+                </tbody>
+              </table>
+            </>
+          )}
+        </div>
+      )}
+    </div>
+  );
+}
+
+function PhaseRow({ label, d }: { label: string; d: Distribution }) {
+  return (
+    <tr>
+      <td>{label}</td>
+      <td className="perf-num">{d.p50_ms.toFixed(2)}ms</td>
+      <td className="perf-num">{d.p95_ms.toFixed(2)}ms</td>
+      <td className="perf-num">{d.max_ms.toFixed(2)}ms</td>
+    </tr>
+  );
+}
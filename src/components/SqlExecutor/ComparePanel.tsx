@@ -0,0 +1,310 @@
+import { useState } from "react";
+import {
+  cancelQuery,
+  compareTableChecksums,
+  fanOutQuery,
+} from "../../api/commands";
+import type {
+  CellValue,
+  ChecksumReport,
+  DbConfig,
+  DiffMode,
+  FanoutReport,
+} from "../../types";
+import { cellValueToString } from "../../utils/columnar";
+import { v4 as uuidv4 } from "../../utils/uuid";
+
+interface ComparePanelProps {
+  sql: string;
+  connections: DbConfig[];
+  setStatus: (status: string) => void;
+}
+
+/**
+ * Runs the editor's SQL on several connections at once and diffs the rows,
+ * or compares a whole table by server-side checksums.
+ */
+export default function ComparePanel({
+  sql,
+  connections,
+  setStatus,
+}: ComparePanelProps) {
+  const [selected, setSelected] = useState<string[]>([]);
+  const [mode, setMode] = useState<DiffMode>("multiset");
+  const [runId, setRunId] = useState<string | null>(null);
+  const [report, setReport] = useState<FanoutReport | null>(null);
+  const [table, setTable] = useState("");
+  const [keyColumn, setKeyColumn] = useState("");
+  const [hashColumns, setHashColumns] = useState("");
+  const [keyFrom, setKeyFrom] = useState("");
+  const [keyTo, setKeyTo] = useState("");
+  const [checksumReport, setChecksumReport] = useState<ChecksumReport | null>(
+    null,
+  );
+
+  const toggle = (id: string) =>
+    setSelected((ids) =>
+      ids.includes(id) ? ids.filter((other) => other !== id) : [...ids, id],
+    );
+
+  const handleCompare = async () => {
+    if (selected.length < 2) {
+      setStatus("Select at least two connections to compare");
+      return;
+    }
+    if (!sql.trim()) {
+      setStatus("Enter a SQL query");
+      return;
+    }
+    const queryId = uuidv4();
+    setRunId(queryId);
+    setReport(null);
+    setStatus(`Running on ${selected.length} connections...`);
+    try {
+      const res = await fanOutQuery(selected, sql, mode, queryId);
+      setReport(res);
+      setStatus(
+        res.identical
+          ? `Results identical across ${res.sides.length} connections`
+          : "Results differ; see the comparison below",
+      );
+    } catch (e) {
+      setStatus(`Compare failed: ${e}`);
+    } finally {
+      setRunId(null);
+    }
+  };
+
+  const handleChecksums = async () => {
+    if (selected.length < 2) {
+      setStatus("Select at least two connections to compare");
+      return;
+    }
+    if (!table.trim() || !keyColumn.trim()) {
+      setStatus("Enter a table and its integer key column");
+      return;
+    }
+    const queryId = uuidv4();
+    setRunId(queryId);
+    setChecksumReport(null);
+    setStatus(`Comparing checksums of ${table} on ${selected.length} connections...`);
+    try {
+      const res = await compareTableChecksums(
+        selected,
+        {
+          table: table.trim(),
+          key_column: keyColumn.trim(),
+          columns: hashColumns
+            .split(",")
+            .map((c) => c.trim())
+            .filter(Boolean),
+          segments: 16,
+          leaf_rows: 1000,
+          lo: keyFrom.trim() ? Number(keyFrom) : null,
+          hi: keyTo.trim() ? Number(keyTo) : null,
+        },
+        queryId,
+      );
+      setChecksumReport(res);
+      setStatus(
+        res.identical
+          ? `${table} identical (${res.queries} checksum queries, ${res.rows_fetched} rows fetched)`
+          : `${table} differs in ${res.ranges.length}${res.truncated ? "+" : ""} key ranges`,
+      );
+    } catch (e) {
+      setStatus(`Checksum compare failed: ${e}`);
+    } finally {
+      setRunId(null);
+    }
+  };
+
+  const nameOf = (id: string) =>
+    connections.find((conn) => conn.id === id)?.name ?? id;
+
+  return (
+    <div className="mb-md">
+      <div className="flex-row mb-sm" style={{ flexWrap: "wrap" }}>
+        <span style={{ fontSize: 13, color: "var(--comment)" }}>Compare on:</span>
+        {connections.map((conn) => (
+          <label
+            key={conn.id}
+            style={{ fontSize: 12, display: "flex", alignItems: "center", gap: 4 }}
+          >
+            <input
+              type="checkbox"
+              checked={selected.includes(conn.id)}
+              onChange={() => toggle(conn.id)}
+            />
+            {conn.name}
+          </label>
+        ))}
+        <select value={mode} onChange={(e) => setMode(e.target.value as DiffMode)}>
+          <option value="multiset">Any order</option>
+          <option value="ordered">Same order</option>
+        </select>
+        <button
+          className="btn-primary"
+          disabled={runId !== null || selected.length < 2}
+          onClick={handleCompare}
+        >
+          {runId ? "Comparing..." : "Compare"}
+        </button>
+        {runId && <button onClick={() => cancelQuery(runId)}>Cancel</button>}
+      </div>
+      <div className="flex-row mb-sm">
+        <input
+          placeholder="Table"
+          value={table}
+          onChange={(e) => setTable(e.target.value)}
+        />
+        <input
+          placeholder="Integer key column"
+          value={keyColumn}
+          onChange={(e) => setKeyColumn(e.target.value)}
+        />
+        <input
+          placeholder="Columns to hash (blank = all)"
+          value={hashColumns}
+          onChange={(e) => setHashColumns(e.target.value)}
+        />
+        <input
+          type="number"
+          placeholder="Keys from"
+          value={keyFrom}
+          onChange={(e) => setKeyFrom(e.target.value)}
+          style={{ width: 100 }}
+        />
+        <input
+          type="number"
+          placeholder="to"
+          value={keyTo}
+          onChange={(e) => setKeyTo(e.target.value)}
+          style={{ width: 100 }}
+        />
+        <button
+          disabled={runId !== null || selected.length < 2}
+          onClick={handleChecksums}
+        >
+          Compare Checksums
+        </button>
+      </div>
+
+      {checksumReport && (
+        <div className="execution-item mb-sm">
+          <div className="meta-info">
+            Rows:{" "}
+            {checksumReport.connection_ids
+              .map((id, i) => `${nameOf(id)} ${checksumReport.rows[i]}`)
+              .join(", ")}
+            ; {checksumReport.queries} checksum queries,{" "}
+            {checksumReport.rows_fetched} rows fetched in{" "}
+            {checksumReport.total_ms.toFixed(1)}ms
+          </div>
+          {checksumReport.ranges.length > 0 && (
+            <table className="result-table">
+              <thead>
+                <tr>
+                  <th>Key range</th>
+                  {checksumReport.connection_ids.map((id) => (
+                    <th key={id}>{nameOf(id)} rows</th>
+                  ))}
+                </tr>
+              </thead>
+              <tbody>
+                {checksumReport.ranges.map((range, i) => (
+                  <tr key={i}>
+                    <td>
+                      {range.lo === range.hi
+                        ? range.lo
+                        : `${range.lo} – ${range.hi}`}
+                    </td>
+                    {range.rows.map((n, j) => (
+                      <td key={j} className="perf-num">
+                        {n}
+                      </td>
+                    ))}
+                  </tr>
+                ))}
+              </tbody>
+            </table>
+          )}
+          {checksumReport.truncated && (
+            <div className="meta-info" style={{ color: "var(--orange)" }}>
+              More ranges differ than are listed.
+            </div>
+          )}
+        </div>
+      )}
+
+      {report && (
+        <>
+          <div className="meta-info">
+            Baseline: {nameOf(report.baseline_id)}, total{" "}
+            {report.total_ms.toFixed(1)}ms
+          </div>
+          <table className="result-table mb-sm">
+            <thead>
+              <tr>
+                <th>Connection</th>
+                <th>Latency</th>
+                <th>Rows</th>
+                <th>Extra</th>
+                <th>Missing</th>
+                <th>First difference / Error</th>
+              </tr>
+            </thead>
+            <tbody>
+              {report.sides.map((side) => {
+                const diff = report.diffs.find(
+                  (d) => d.connection_id === side.connection_id,
+                );
+                return (
+                  <tr key={side.connection_id}>
+                    <td>{side.name}</td>
+                    <td className="perf-num">{side.elapsed_ms.toFixed(1)}ms</td>
+                    <td className="perf-num">{side.rows}</td>
+                    <td className="perf-num">{diff?.extra ?? ""}</td>
+                    <td className="perf-num">{diff?.missing ?? ""}</td>
+                    <td style={side.error ? { color: "var(--red)" } : undefined}>
+                      {side.error ??
+                        (side.truncated
+                          ? "Truncated; not compared"
+                          : diff && !diff.columns_match
+                            ? "Columns differ"
+                            : diff?.first_difference != null
+                              ? `Row ${diff.first_difference + 1}`
+                              : "")}
+                    </td>
+                  </tr>
+                );
+              })}
+            </tbody>
+          </table>
+          {report.diffs
+            .filter((d) => d.extra_samples.length + d.missing_samples.length > 0)
+            .map((d) => (
+              <div key={d.connection_id} className="execution-item mb-sm">
+                <div className="meta-info">{nameOf(d.connection_id)}</div>
+                <SampleRows label="Only here" rows={d.extra_samples} />
+                <SampleRows label="Only in baseline" rows={d.missing_samples} />
+              </div>
+            ))}
+        </>
+      )}
+    </div>
+  );
+}
+
+function SampleRows({ label, rows }: { label: string; rows: CellValue[][] }) {
+  if (rows.length === 0) return null;
+  return (
+    <div>
+      <span style={{ fontSize: 12, color: "var(--orange)" }}>{label}:</span>
+      {rows.map((row, i) => (
+        <pre key={i} className="sql-display">
+          {row.map(cellValueToString).join(" | ")}
+        </pre>
+      ))}
+    </div>
+  );
+}
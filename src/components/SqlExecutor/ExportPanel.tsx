@@ -0,0 +1,116 @@
+import { useState } from "react";
+import { save } from "@tauri-apps/plugin-dialog";
+import { cancelQuery, exportQuery } from "../../api/commands";
+import type { Config, DbConfig, ExportProgress } from "../../types";
+import { v4 as uuidv4 } from "../../utils/uuid";
+
+type OutputEncoding = "UTF-8" | "UTF-8-BOM" | "SHIFT_JIS";
+
+interface ExportPanelProps {
+  sql: string;
+  connection: DbConfig | undefined;
+  config: Config;
+  setStatus: (status: string) => void;
+}
+
+/**
+ * Exports every row of the editor's SQL to a CSV/TSV file, streamed by the
+ * backend straight from the database to disk.
+ */
+export default function ExportPanel({
+  sql,
+  connection,
+  config,
+  setStatus,
+}: ExportPanelProps) {
+  const [format, setFormat] = useState<"csv" | "tsv">("csv");
+  // Where the logs are SHIFT_JIS, Excel expects CSV files in it too
+  const [encoding, setEncoding] = useState<OutputEncoding>(
+    config.encoding.toUpperCase() === "SHIFT_JIS" ? "SHIFT_JIS" : "UTF-8-BOM",
+  );
+  const [runId, setRunId] = useState<string | null>(null);
+  const [progress, setProgress] = useState<ExportProgress | null>(null);
+
+  const handleExport = async () => {
+    if (!connection) {
+      setStatus("Select a connection first");
+      return;
+    }
+    if (!sql.trim()) {
+      setStatus("Enter a SQL query");
+      return;
+    }
+    const path = await save({
+      filters: [
+        format === "csv"
+          ? { name: "CSV", extensions: ["csv"] }
+          : { name: "TSV", extensions: ["tsv", "txt"] },
+      ],
+    });
+    if (!path) return;
+
+    const queryId = uuidv4();
+    setRunId(queryId);
+    setProgress(null);
+    setStatus(`Exporting to ${path}...`);
+    try {
+      const report = await exportQuery(
+        connection.id,
+        sql,
+        {
+          path,
+          separator: format === "csv" ? config.csv_separator || "," : "\t",
+          encoding: encoding === "UTF-8-BOM" ? "UTF-8" : encoding,
+          bom: encoding === "UTF-8-BOM",
+        },
+        queryId,
+        setProgress,
+      );
+      setStatus(
+        `Exported ${report.rows.toLocaleString()} rows (${formatMb(report.bytes)}) in ${(report.elapsed_ms / 1000).toFixed(1)}s`,
+      );
+    } catch (e) {
+      setStatus(`Export failed: ${e}`);
+    } finally {
+      setRunId(null);
+    }
+  };
+
+  return (
+    <div className="flex-row mb-sm">
+      <span style={{ fontSize: 13, color: "var(--comment)" }}>Export:</span>
+      <select
+        value={format}
+        onChange={(e) => setFormat(e.target.value as "csv" | "tsv")}
+      >
+        <option value="csv">CSV ({config.csv_separator || ","})</option>
+        <option value="tsv">TSV</option>
+      </select>
+      <select
+        value={encoding}
+        onChange={(e) => setEncoding(e.target.value as OutputEncoding)}
+      >
+        <option value="UTF-8-BOM">UTF-8 with BOM</option>
+        <option value="UTF-8">UTF-8</option>
+        <option value="SHIFT_JIS">SHIFT_JIS</option>
+      </select>
+      <button disabled={runId !== null || !connection} onClick={handleExport}>
+        {runId ? "Exporting..." : "Export to File"}
+      </button>
+      {runId && (
+        <>
+          <span className="meta-info">
+            {progress
+              ? `${progress.rows.toLocaleString()} rows, ${formatMb(progress.bytes)}`
+              : "Waiting for rows..."}
+          </span>
+          <button onClick={() => cancelQuery(runId)}>Cancel</button>
+        </>
+      )}
+    </div>
+  );
+}
+
+function formatMb(bytes: number): string {
+  return `${(bytes / (1024 * 1024)).toFixed(1)} MB`;
+}
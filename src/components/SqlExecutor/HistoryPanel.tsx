@@ -0,0 +1,136 @@
+import { useEffect, useState } from "react";
+import { searchHistory } from "../../api/commands";
+import type { HistoryEntry } from "../../types";
+
+/** Entries fetched per page. */
+const PAGE_SIZE = 100;
+/** Typing pause before the history is searched. */
+const SEARCH_DELAY_MS = 200;
+
+interface HistoryPanelProps {
+  activeConnectionId: string | null;
+  /** Changes after each execution, so the list picks it up. */
+  refreshKey: number;
+  onSelect: (sql: string) => void;
+  setStatus: (status: string) => void;
+}
+
+export default function HistoryPanel({
+  activeConnectionId,
+  refreshKey,
+  onSelect,
+  setStatus,
+}: HistoryPanelProps) {
+  const [expanded, setExpanded] = useState(false);
+  const [text, setText] = useState("");
+  const [onlyActive, setOnlyActive] = useState(false);
+  const [entries, setEntries] = useState<HistoryEntry[]>([]);
+  const [hasMore, setHasMore] = useState(false);
+
+  const connectionId =
+    onlyActive && activeConnectionId ? activeConnectionId : undefined;
+
+  useEffect(() => {
+    if (!expanded) return;
+    let active = true;
+    const timer = setTimeout(() => {
+      searchHistory({ text, connection_id: connectionId, limit: PAGE_SIZE })
+        .then((found) => {
+          if (!active) return;
+          setEntries(found);
+          setHasMore(found.length === PAGE_SIZE);
+        })
+        .catch((e) => setStatus(`History search failed: ${e}`));
+    }, SEARCH_DELAY_MS);
+    return () => {
+      active = false;
+      clearTimeout(timer);
+    };
+  }, [expanded, text, connectionId, refreshKey, setStatus]);
+
+  const handleMore = async () => {
+    const last = entries[entries.length - 1];
+    if (!last) return;
+    try {
+      const older = await searchHistory({
+        text,
+        connection_id: connectionId,
+        before_id: last.id,
+        limit: PAGE_SIZE,
+      });
+      setEntries([...entries, ...older]);
+      setHasMore(older.length === PAGE_SIZE);
+    } catch (e) {
+      setStatus(`History search failed: ${e}`);
+    }
+  };
+
+  return (
+    <div className="mb-sm">
+      <div
+        className="collapsible-header"
+        onClick={() => setExpanded(!expanded)}
+      >
+        <span className={`arrow ${expanded ? "open" : ""}`}>&#9654;</span>
+        <span style={{ color: "var(--cyan)" }}>History</span>
+      </div>
+      {expanded && (
+        <div className="collapsible-body">
+          <div className="flex-row mb-sm">
+            <input
+              placeholder="Search SQL"
+              value={text}
+              onChange={(e) => setText(e.target.value)}
+              style={{ flex: 1 }}
+            />
+            <label
+              style={{ fontSize: 12, display: "flex", alignItems: "center", gap: 4 }}
+            >
+              <input
+                type="checkbox"
+                checked={onlyActive}
+                onChange={(e) => setOnlyActive(e.target.checked)}
+              />
+              This connection only
+            </label>
+          </div>
+          <table className="result-table">
+            <thead>
+              <tr>
+                <th>Time</th>
+                <th>Connection</th>
+                <th>SQL</th>
+                <th>Duration</th>
+                <th>Rows</th>
+              </tr>
+            </thead>
+            <tbody>
+              {entries.map((entry) => (
+                <tr
+                  key={entry.id}
+                  onClick={() => onSelect(entry.sql)}
+                  style={{ cursor: "pointer" }}
+                  title={entry.error ?? "Load into the editor"}
+                >
+                  <td>{new Date(entry.executed_at_ms).toLocaleString()}</td>
+                  <td>{entry.connection_name}</td>
+                  <td style={entry.error ? { color: "var(--red)" } : undefined}>
+                    {entry.sql.slice(0, 120)}
+                  </td>
+                  <td className="perf-num">{entry.duration_ms.toFixed(1)}ms</td>
+                  <td className="perf-num">{entry.error ? "" : entry.rows}</td>
+                </tr>
+              ))}
+            </tbody>
+          </table>
+          {entries.length === 0 && (
+            <div style={{ color: "var(--comment)", fontSize: 12 }}>
+              No executions found.
+            </div>
+          )}
+          {hasMore && <button onClick={handleMore}>Older</button>}
+        </div>
+      )}
+    </div>
+  );
+}
@@ -0,0 +1,270 @@
+import { useEffect, useMemo, useState } from "react";
+import { aggregateResult, viewResult } from "../../api/commands";
+import type {
+  AggregateOp,
+  AggregateResult,
+  ColumnFilter,
+  FilterOp,
+  SortKey,
+} from "../../types";
+import { ResultRows } from "../../utils/columnar";
+import ResultTable from "./ResultTable";
+
+/** Rows fetched per page of a sorted or filtered view. */
+const PAGE_SIZE = 500;
+
+const FILTER_OPS: { op: FilterOp; label: string }[] = [
+  { op: "contains", label: "contains" },
+  { op: "equals", label: "=" },
+  { op: "not_equals", label: "≠" },
+  { op: "greater", label: ">" },
+  { op: "less", label: "<" },
+  { op: "is_null", label: "is NULL" },
+  { op: "not_null", label: "is not NULL" },
+];
+
+interface ResultSetViewProps {
+  /** `null` while the query is still running. */
+  resultId: string | null;
+  resultSet: number;
+  columns: string[];
+  /** Rows as streamed, shown while no sort or filter is set. */
+  rows: ResultRows;
+  setStatus: (status: string) => void;
+}
+
+/**
+ * A result table whose sorting, filtering and aggregates run in the
+ * backend over the rows it kept, so only the visible page is sent here.
+ */
+export default function ResultSetView({
+  resultId,
+  resultSet,
+  columns,
+  rows,
+  setStatus,
+}: ResultSetViewProps) {
+  const [sort, setSort] = useState<SortKey[]>([]);
+  const [filters, setFilters] = useState<ColumnFilter[]>([]);
+  const [page, setPage] = useState(0);
+  const [viewRows, setViewRows] = useState<ResultRows | null>(null);
+  const [matched, setMatched] = useState(0);
+  const [complete, setComplete] = useState(true);
+  const [filterColumn, setFilterColumn] = useState(0);
+  const [filterOp, setFilterOp] = useState<FilterOp>("contains");
+  const [filterValue, setFilterValue] = useState("");
+  const [groupBy, setGroupBy] = useState(-1);
+  const [aggOp, setAggOp] = useState<AggregateOp>("count");
+  const [aggColumn, setAggColumn] = useState(-1);
+  const [aggregate, setAggregate] = useState<AggregateResult | null>(null);
+
+  const viewing = resultId !== null && (sort.length > 0 || filters.length > 0);
+
+  useEffect(() => {
+    if (!viewing || !resultId) {
+      setViewRows(null);
+      return;
+    }
+    let active = true;
+    viewResult(resultId, {
+      result_set: resultSet,
+      sort,
+      filters,
+      offset: page * PAGE_SIZE,
+      limit: PAGE_SIZE,
+    })
+      .then((view) => {
+        if (!active) return;
+        const pageRows = new ResultRows();
+        pageRows.append(view.rows);
+        setViewRows(pageRows);
+        setMatched(view.matched);
+        setComplete(view.complete);
+      })
+      .catch((e) => setStatus(`Failed to sort or filter: ${e}`));
+    return () => {
+      active = false;
+    };
+  }, [viewing, resultId, resultSet, sort, filters, page, setStatus]);
+
+  // Click: ascending, then descending, then unsorted. Shift-click adds or
+  // toggles a column in a multi-column sort.
+  const handleSort = (column: number, add: boolean) => {
+    const current = sort.find((key) => key.column === column);
+    const next: SortKey | null = !current
+      ? { column, descending: false }
+      : current.descending
+        ? null
+        : { column, descending: true };
+    if (!add) {
+      setSort(next ? [next] : []);
+    } else if (!current) {
+      setSort([...sort, next!]);
+    } else {
+      setSort(
+        next
+          ? sort.map((key) => (key.column === column ? next : key))
+          : sort.filter((key) => key.column !== column),
+      );
+    }
+    setPage(0);
+  };
+
+  const addFilter = () => {
+    setFilters([
+      ...filters,
+      { column: filterColumn, op: filterOp, value: filterValue },
+    ]);
+    setFilterValue("");
+    setPage(0);
+  };
+
+  const removeFilter = (index: number) => {
+    setFilters(filters.filter((_, i) => i !== index));
+    setPage(0);
+  };
+
+  const handleAggregate = async () => {
+    if (!resultId) return;
+    try {
+      const res = await aggregateResult(resultId, {
+        result_set: resultSet,
+        group_by: groupBy >= 0 ? [groupBy] : [],
+        aggregates: [{ op: aggOp, column: aggColumn >= 0 ? aggColumn : null }],
+        filters,
+      });
+      setAggregate(res);
+    } catch (e) {
+      setStatus(`Aggregate failed: ${e}`);
+    }
+  };
+
+  const aggRows = useMemo(() => {
+    const rows = new ResultRows();
+    if (aggregate) rows.append(aggregate.rows);
+    return rows;
+  }, [aggregate]);
+  const pages = Math.ceil(matched / PAGE_SIZE);
+  const noValue = filterOp === "is_null" || filterOp === "not_null";
+
+  return (
+    <div>
+      {resultId && (
+        <div className="flex-row mb-sm" style={{ flexWrap: "wrap" }}>
+          <select
+            value={filterColumn}
+            onChange={(e) => setFilterColumn(Number(e.target.value))}
+          >
+            {columns.map((name, i) => (
+              <option key={i} value={i}>
+                {name}
+              </option>
+            ))}
+          </select>
+          <select
+            value={filterOp}
+            onChange={(e) => setFilterOp(e.target.value as FilterOp)}
+          >
+            {FILTER_OPS.map(({ op, label }) => (
+              <option key={op} value={op}>
+                {label}
+              </option>
+            ))}
+          </select>
+          {!noValue && (
+            <input
+              placeholder="Value"
+              value={filterValue}
+              onChange={(e) => setFilterValue(e.target.value)}
+              onKeyDown={(e) => e.key === "Enter" && addFilter()}
+            />
+          )}
+          <button onClick={addFilter}>Filter</button>
+          {filters.map((filter, i) => (
+            <button key={i} onClick={() => removeFilter(i)} title="Remove">
+              {columns[filter.column]}{" "}
+              {FILTER_OPS.find((f) => f.op === filter.op)?.label} {filter.value}{" "}
+              &times;
+            </button>
+          ))}
+          <span style={{ fontSize: 13, color: "var(--comment)" }}>
+            Aggregate:
+          </span>
+          <select value={aggOp} onChange={(e) => setAggOp(e.target.value as AggregateOp)}>
+            <option value="count">count</option>
+            <option value="sum">sum</option>
+            <option value="min">min</option>
+            <option value="max">max</option>
+          </select>
+          <select
+            value={aggColumn}
+            onChange={(e) => setAggColumn(Number(e.target.value))}
+          >
+            <option value={-1}>*</option>
+            {columns.map((name, i) => (
+              <option key={i} value={i}>
+                {name}
+              </option>
+            ))}
+          </select>
+          <span style={{ fontSize: 13, color: "var(--comment)" }}>by</span>
+          <select value={groupBy} onChange={(e) => setGroupBy(Number(e.target.value))}>
+            <option value={-1}>(all rows)</option>
+            {columns.map((name, i) => (
+              <option key={i} value={i}>
+                {name}
+              </option>
+            ))}
+          </select>
+          <button onClick={handleAggregate}>Run</button>
+        </div>
+      )}
+
+      {aggregate && (
+        <div className="execution-item mb-sm">
+          <button onClick={() => setAggregate(null)}>Close</button>
+          <ResultTable columns={aggregate.columns} rows={aggRows} />
+          {aggregate.truncated && (
+            <div className="meta-info" style={{ color: "var(--orange)" }}>
+              Only the first {aggregate.rows.length} groups are shown.
+            </div>
+          )}
+        </div>
+      )}
+
+      {viewing && viewRows ? (
+        <>
+          <div className="flex-row meta-info">
+            {matched} matching rows; showing {page * PAGE_SIZE + 1}–
+            {Math.min((page + 1) * PAGE_SIZE, matched)}
+            <button disabled={page === 0} onClick={() => setPage(page - 1)}>
+              Prev
+            </button>
+            <button disabled={page + 1 >= pages} onClick={() => setPage(page + 1)}>
+              Next
+            </button>
+          </div>
+          {!complete && (
+            <div className="meta-info" style={{ color: "var(--orange)" }}>
+              Sorted and filtered over the rows kept in memory only; rows
+              spilled to disk or past the memory budget are not included.
+            </div>
+          )}
+          <ResultTable
+            columns={columns}
+            rows={viewRows}
+            sort={sort}
+            onSort={handleSort}
+          />
+        </>
+      ) : (
+        <ResultTable
+          columns={columns}
+          rows={rows}
+          sort={sort}
+          onSort={resultId ? handleSort : undefined}
+        />
+      )}
+    </div>
+  );
+}
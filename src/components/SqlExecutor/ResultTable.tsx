@@ -6,64 +6,54 @@ import {
   createColumnHelper,
   type ColumnDef,
 } from "@tanstack/react-table";
-import type { CellValue, QueryResult } from "../../types";
+import type { SortKey } from "../../types";
+import type { ResultRows } from "../../utils/columnar";
 
 interface ResultTableProps {
-  result: QueryResult;
+  columns: string[];
+  rows: ResultRows;
+  /** Sort shown on the headers. */
+  sort?: SortKey[];
+  /** Header clicked; `add` when Shift was held, to sort by several columns. */
+  onSort?: (column: number, add: boolean) => void;
 }
 
-function cellValueToString(cell: CellValue): string {
-  if (cell === "Null") return "NULL";
-  if (typeof cell === "object") {
-    if ("Text" in cell) return cell.Text;
-    if ("Int" in cell) return cell.Int.toString();
-    if ("Float" in cell) return cell.Float.toString();
-    if ("Bool" in cell) return cell.Bool.toString();
-    if ("DateTime" in cell) return cell.DateTime;
-    if ("Binary" in cell) return cell.Binary;
-  }
-  return "?";
-}
-
-function isNull(cell: CellValue): boolean {
-  return cell === "Null";
-}
-
-type RowData = Record<string, CellValue>;
+// Table rows are indices into `rows`; cells are read from the received
+// batches on render, so appending a batch does not rebuild earlier rows
+type RowData = number;
 
-export default function ResultTable({ result }: ResultTableProps) {
+export default function ResultTable({
+  columns: columnNames,
+  rows,
+  sort,
+  onSort,
+}: ResultTableProps) {
   const columnHelper = createColumnHelper<RowData>();
 
-  const columns: ColumnDef<RowData, CellValue>[] = useMemo(
+  const columns: ColumnDef<RowData, string | null>[] = useMemo(
     () =>
-      result.columns.map((colName, colIdx) =>
-        columnHelper.accessor((row) => row[`col_${colIdx}`], {
+      columnNames.map((colName, colIdx) =>
+        columnHelper.accessor((row) => rows.cell(row, colIdx), {
           id: `col_${colIdx}`,
           header: () => colName,
           cell: (info) => {
             const val = info.getValue();
-            if (!val || isNull(val)) {
+            if (val === null) {
               return <span className="cell-null">NULL</span>;
             }
-            return cellValueToString(val);
+            return val;
           },
           size: 150,
           minSize: 60,
         }),
       ),
-    [result.columns, columnHelper],
+    [columnNames, rows, columnHelper],
   );
 
-  const data: RowData[] = useMemo(
-    () =>
-      result.rows.map((row) => {
-        const obj: RowData = {};
-        for (let i = 0; i < result.columns.length; i++) {
-          obj[`col_${i}`] = row[i] ?? "Null";
-        }
-        return obj;
-      }),
-    [result.rows, result.columns],
+  const rowCount = rows.rowCount;
+  const data = useMemo(
+    () => Array.from({ length: rowCount }, (_, i) => i),
+    [rowCount],
   );
 
   const table = useReactTable({
@@ -76,7 +66,7 @@ export default function ResultTable({ result }: ResultTableProps) {
   return (
     <div>
       <div className="meta-info">
-        {result.columns.length} columns, {result.rows.length} rows
+        {columnNames.length} columns, {rowCount} rows
       </div>
       <div className="result-table-container">
         <table
@@ -89,7 +79,11 @@ export default function ResultTable({ result }: ResultTableProps) {
                 {headerGroup.headers.map((header) => (
                   <th
                     key={header.id}
-                    style={{ width: header.getSize() }}
+                    style={{
+                      width: header.getSize(),
+                      cursor: onSort ? "pointer" : undefined,
+                    }}
+                    onClick={onSort && ((e) => onSort(header.index, e.shiftKey))}
                   >
                     {header.isPlaceholder
                       ? null
@@ -97,10 +91,12 @@ export default function ResultTable({ result }: ResultTableProps) {
                           header.column.columnDef.header,
                           header.getContext(),
                         )}
+                    {sortMark(sort, header.index)}
                     <div
                       className={`resizer ${header.column.getIsResizing() ? "isResizing" : ""}`}
                       onMouseDown={header.getResizeHandler()}
                       onTouchStart={header.getResizeHandler()}
+                      onClick={(e) => e.stopPropagation()}
                     />
                   </th>
                 ))}
@@ -123,3 +119,10 @@ export default function ResultTable({ result }: ResultTableProps) {
     </div>
   );
 }
+
+function sortMark(sort: SortKey[] | undefined, column: number): string {
+  const at = sort?.findIndex((key) => key.column === column) ?? -1;
+  if (!sort || at < 0) return "";
+  const arrow = sort[at].descending ? " \u25BC" : " \u25B2";
+  return sort.length > 1 ? `${arrow}${at + 1}` : arrow;
+}
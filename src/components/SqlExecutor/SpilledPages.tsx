@@ -0,0 +1,64 @@
+import { useEffect, useState } from "react";
+import { fetchResultPage } from "../../api/commands";
+import type { SpilledSet } from "../../types";
+import { ResultRows } from "../../utils/columnar";
+import ResultTable from "./ResultTable";
+
+/** Rows read from disk per page. */
+const PAGE_SIZE = 500;
+
+interface SpilledPagesProps {
+  resultId: string;
+  set: SpilledSet;
+  columns: string[];
+  setStatus: (status: string) => void;
+}
+
+/** Pages through the rows of a result set that were spilled to disk. */
+export default function SpilledPages({
+  resultId,
+  set,
+  columns,
+  setStatus,
+}: SpilledPagesProps) {
+  const [page, setPage] = useState(0);
+  const [rows, setRows] = useState<ResultRows | null>(null);
+  const pages = Math.ceil(set.rows / PAGE_SIZE);
+
+  useEffect(() => {
+    let active = true;
+    fetchResultPage(
+      resultId,
+      set.result_set,
+      set.from_row + page * PAGE_SIZE,
+      PAGE_SIZE,
+    )
+      .then((buf) => {
+        if (!active) return;
+        const pageRows = new ResultRows();
+        pageRows.append(buf);
+        setRows(pageRows);
+      })
+      .catch((e) => setStatus(`Failed to read spilled rows: ${e}`));
+    return () => {
+      active = false;
+    };
+  }, [resultId, set, page, setStatus]);
+
+  const first = set.from_row + page * PAGE_SIZE;
+  return (
+    <div className="mt-sm">
+      <div className="flex-row meta-info">
+        {set.rows} more rows were written to disk; showing rows {first + 1}–
+        {Math.min(first + PAGE_SIZE, set.from_row + set.rows)}
+        <button disabled={page === 0} onClick={() => setPage(page - 1)}>
+          Prev
+        </button>
+        <button disabled={page + 1 >= pages} onClick={() => setPage(page + 1)}>
+          Next
+        </button>
+      </div>
+      {rows && <ResultTable columns={columns} rows={rows} />}
+    </div>
+  );
+}
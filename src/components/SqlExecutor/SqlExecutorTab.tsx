@@ -1,9 +1,29 @@
-import { useState, useEffect, useCallback } from "react";
-import { executeQuery, listConnections } from "../../api/commands";
-import type { Config, DbConfig, QueryResult } from "../../types";
+import { useState, useEffect, useCallback, useRef } from "react";
+import {
+  ackResultBatches,
+  cancelQuery,
+  closeResult,
+  copyToClipboard,
+  executeQuery,
+  invalidateResultCache,
+  listConnections,
+} from "../../api/commands";
+import type { Config, DbConfig, QueryPlan, QueryResult } from "../../types";
+import { ResultRows } from "../../utils/columnar";
+import { v4 as uuidv4 } from "../../utils/uuid";
 import ConnectionSidebar from "../Connections/ConnectionSidebar";
 import SqlEditor from "./SqlEditor";
-import ResultTable from "./ResultTable";
+import ResultSetView from "./ResultSetView";
+import ComparePanel from "./ComparePanel";
+import HistoryPanel from "./HistoryPanel";
+import BenchmarkPanel from "./BenchmarkPanel";
+import ExportPanel from "./ExportPanel";
+import SpilledPages from "./SpilledPages";
+
+interface ResultSetRows {
+  columns: string[];
+  rows: ResultRows;
+}
 
 interface SqlExecutorTabProps {
   config: Config;
@@ -13,7 +33,7 @@ interface SqlExecutorTabProps {
 }
 
 export default function SqlExecutorTab({
-  config: _config,
+  config,
   setStatus,
   initialSql,
   onSqlConsumed,
@@ -26,6 +46,34 @@ export default function SqlExecutorTab({
   const [queryResult, setQueryResult] = useState<QueryResult | null>(null);
   const [queryError, setQueryError] = useState<string | null>(null);
   const [executing, setExecuting] = useState(false);
+  const [capturePlan, setCapturePlan] = useState(false);
+  // Result sets of the current script; `rowCount` re-renders the tables as
+  // their rows grow
+  const [resultSets, setResultSets] = useState<ResultSetRows[]>([]);
+  const [rowCount, setRowCount] = useState(0);
+  const [historyKey, setHistoryKey] = useState(0);
+
+  // Result sets received so far for the running query; rendered once per frame
+  const setsRef = useRef<ResultSetRows[]>([]);
+  const unackedRef = useRef(0);
+  const frameRef = useRef<number | null>(null);
+  const queryIdRef = useRef<string | null>(null);
+  // Finished result whose rows the backend keeps for sorting and paging
+  // (in memory, or spilled to disk) until it is closed
+  const [resultId, setResultId] = useState<string | null>(null);
+  const resultIdRef = useRef<string | null>(null);
+
+  const closeCurrentResult = useCallback(() => {
+    if (resultIdRef.current) {
+      closeResult(resultIdRef.current).catch((e) =>
+        console.warn("Failed to close result", e),
+      );
+      resultIdRef.current = null;
+    }
+    setResultId(null);
+  }, []);
+
+  useEffect(() => closeCurrentResult, [closeCurrentResult]);
 
   // Load connections on mount
   const refreshConnections = useCallback(async () => {
@@ -59,22 +107,105 @@ export default function SqlExecutorTab({
       return;
     }
 
+    closeCurrentResult();
     setExecuting(true);
     setQueryResult(null);
     setQueryError(null);
     setStatus("Executing query...");
 
+    const queryId = uuidv4();
+    queryIdRef.current = queryId;
+    setsRef.current = [];
+    setResultSets([]);
+    setRowCount(0);
+    const receivedRows = () =>
+      setsRef.current.reduce((n, set) => n + set.rows.rowCount, 0);
+    unackedRef.current = 0;
+
+    // Acknowledge batches only after they are rendered, so the backend stops
+    // reading from the server while the table is catching up
+    const flush = () => {
+      frameRef.current = null;
+      const received = receivedRows();
+      setRowCount(received);
+      setStatus(`Receiving rows... ${received}`);
+      const batches = unackedRef.current;
+      unackedRef.current = 0;
+      if (batches > 0) {
+        ackResultBatches(queryId, batches).catch((e) =>
+          console.warn("Failed to acknowledge rows", e),
+        );
+      }
+    };
+
     try {
-      const result = await executeQuery(activeConnectionId, sql);
+      const result = await executeQuery(
+        activeConnectionId,
+        sql,
+        queryId,
+        {
+          onColumns: (columns) => {
+            setsRef.current.push({ columns, rows: new ResultRows() });
+            setResultSets([...setsRef.current]);
+            setQueryResult(
+              (current) =>
+                current ?? {
+                  columns,
+                  rows: [],
+                  affected_rows: 0,
+                  execution_time_ms: 0,
+                  truncated: false,
+                  result_sets: [],
+                },
+            );
+          },
+          onRows: (rows) => {
+            setsRef.current[setsRef.current.length - 1]?.rows.append(rows);
+            unackedRef.current += 1;
+            if (frameRef.current === null) {
+              frameRef.current = requestAnimationFrame(flush);
+            }
+          },
+        },
+        capturePlan,
+      );
+      if (frameRef.current !== null) {
+        cancelAnimationFrame(frameRef.current);
+        frameRef.current = null;
+      }
+      resultIdRef.current = queryId;
+      setResultId(queryId);
       setQueryResult(result);
+      setRowCount(receivedRows());
       setStatus(
         `Query completed in ${result.execution_time_ms}ms. Affected rows: ${result.affected_rows}`,
       );
     } catch (e) {
+      if (frameRef.current !== null) {
+        cancelAnimationFrame(frameRef.current);
+        frameRef.current = null;
+      }
       setQueryError(String(e));
       setStatus(`Query failed: ${e}`);
     } finally {
+      queryIdRef.current = null;
       setExecuting(false);
+      setHistoryKey((key) => key + 1);
+    }
+  };
+
+  const activeConnection = connections.find((c) => c.id === activeConnectionId);
+
+  const handleClearCache = () => {
+    if (!activeConnectionId) return;
+    invalidateResultCache(activeConnectionId)
+      .then(() => setStatus("Result cache cleared"))
+      .catch((e) => setStatus(`Failed to clear cache: ${e}`));
+  };
+
+  const handleCancelQuery = () => {
+    if (queryIdRef.current) {
+      cancelQuery(queryIdRef.current).catch((e) => setStatus(`Cancel failed: ${e}`));
     }
   };
 
@@ -116,12 +247,54 @@ export default function SqlExecutorTab({
           >
             {executing ? "Executing..." : "Run Query"}
           </button>
-          {executing && <span className="spinner" />}
+          <label style={{ fontSize: 12, display: "flex", alignItems: "center", gap: 4 }}>
+            <input
+              type="checkbox"
+              checked={capturePlan}
+              onChange={(e) => setCapturePlan(e.target.checked)}
+            />
+            Capture Plan
+          </label>
+          {activeConnection && activeConnection.cache_ttl_secs > 0 && (
+            <button disabled={executing} onClick={handleClearCache}>
+              Clear Cache
+            </button>
+          )}
+          {executing && (
+            <>
+              <span className="spinner" />
+              <button onClick={handleCancelQuery}>Cancel</button>
+            </>
+          )}
         </div>
 
         {/* SQL Editor */}
         <SqlEditor value={sql} onChange={setSql} />
 
+        <ExportPanel
+          sql={sql}
+          connection={activeConnection}
+          config={config}
+          setStatus={setStatus}
+        />
+
+        <HistoryPanel
+          activeConnectionId={activeConnectionId}
+          refreshKey={historyKey}
+          onSelect={setSql}
+          setStatus={setStatus}
+        />
+
+        <BenchmarkPanel
+          sql={sql}
+          connection={activeConnection}
+          setStatus={setStatus}
+        />
+
+        {connections.length > 1 && (
+          <ComparePanel sql={sql} connections={connections} setStatus={setStatus} />
+        )}
+
         <hr style={{ borderColor: "var(--border)", margin: "12px 0" }} />
 
         {/* Results */}
@@ -132,9 +305,44 @@ export default function SqlExecutorTab({
             <div className="meta-info">
               Affected rows: {queryResult.affected_rows}, Execution time:{" "}
               {queryResult.execution_time_ms}ms
+              {queryResult.cached_age_ms != null &&
+                `, from cache (${(queryResult.cached_age_ms / 1000).toFixed(1)}s old)`}
             </div>
-            {queryResult.columns.length > 0 ? (
-              <ResultTable result={queryResult} />
+            {queryResult.plan && <PlanSummary plan={queryResult.plan} />}
+            {queryResult.truncated && (
+              <div className="meta-info" style={{ color: "var(--orange)" }}>
+                Fetching stopped at the row cap or memory budget; only the
+                first {rowCount} rows are shown.
+              </div>
+            )}
+            {resultSets.length > 0 ? (
+              resultSets.map((set, i) => (
+                <div key={i} className="mb-md">
+                  {resultSets.length > 1 && (
+                    <div className="meta-info">
+                      Result {i + 1} of {resultSets.length}
+                    </div>
+                  )}
+                  <ResultSetView
+                    resultId={resultId}
+                    resultSet={i}
+                    columns={set.columns}
+                    rows={set.rows}
+                    setStatus={setStatus}
+                  />
+                  {queryResult.spill?.sets
+                    .filter((spilled) => spilled.result_set === i)
+                    .map((spilled) => (
+                      <SpilledPages
+                        key={queryResult.spill!.result_id}
+                        resultId={queryResult.spill!.result_id}
+                        set={spilled}
+                        columns={set.columns}
+                        setStatus={setStatus}
+                      />
+                    ))}
+                </div>
+              ))
             ) : (
               <div style={{ color: "var(--comment)" }}>
                 Query executed successfully. No result set returned.
@@ -158,3 +366,50 @@ export default function SqlExecutorTab({
     </div>
   );
 }
+
+function formatStat(value: number | null, unit = ""): string {
+  return value === null ? "n/a" : `${value.toLocaleString()}${unit}`;
+}
+
+function PlanSummary({ plan }: { plan: QueryPlan }) {
+  const [expanded, setExpanded] = useState(false);
+
+  if (plan.error) {
+    return (
+      <div className="meta-info" style={{ color: "var(--orange)" }}>
+        No plan captured: {plan.error}
+      </div>
+    );
+  }
+
+  return (
+    <div className="mb-sm">
+      <div className="meta-info">
+        CPU: {formatStat(plan.cpu_ms, "ms")}, Elapsed:{" "}
+        {formatStat(plan.elapsed_ms, "ms")}, Logical reads:{" "}
+        {formatStat(plan.logical_reads)}, Physical reads:{" "}
+        {formatStat(plan.physical_reads)}
+      </div>
+      <div
+        className="collapsible-header"
+        onClick={() => setExpanded(!expanded)}
+      >
+        <span className={`arrow ${expanded ? "open" : ""}`}>&#9654;</span>
+        <span style={{ color: "var(--cyan)" }}>
+          Plan ({plan.plans.length} statement
+          {plan.plans.length === 1 ? "" : "s"})
+        </span>
+      </div>
+      {expanded && (
+        <div className="collapsible-body">
+          {plan.plans.map((text, i) => (
+            <div key={i} className="execution-item">
+              <button onClick={() => copyToClipboard(text)}>Copy Plan</button>
+              <pre className="sql-display">{text}</pre>
+            </div>
+          ))}
+        </div>
+      )}
+    </div>
+  );
+}
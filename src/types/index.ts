@@ -9,13 +9,304 @@ export type CellValue =
   | { Float: number }
   | { Bool: boolean }
   | { DateTime: string }
-  | { Binary: string };
+  | { Binary: string }
+  | { Decimal: string };
 
 export interface QueryResult {
   columns: string[];
   rows: CellValue[][];
   affected_rows: number;
   execution_time_ms: number;
+  truncated: boolean;
+  /** Every result set in order; `columns` repeats the first one's. */
+  result_sets: ResultSetSummary[];
+  /** Set when served from the result cache: how old the cached result is. */
+  cached_age_ms?: number | null;
+  /** Present when plan capture was requested. */
+  plan?: QueryPlan | null;
+  /** Present when rows past the spill threshold went to disk. */
+  spill?: SpillSummary | null;
+}
+
+export interface SpilledSet {
+  result_set: number;
+  /** Rows before this one were delivered as usual. */
+  from_row: number;
+  rows: number;
+}
+
+export interface SpillSummary {
+  result_id: string;
+  sets: SpilledSet[];
+}
+
+// ─── Result View Types (mirrors src-tauri/src/core/db/view.rs) ──────────────
+
+export interface SortKey {
+  column: number;
+  descending: boolean;
+}
+
+export type FilterOp =
+  | "contains"
+  | "equals"
+  | "not_equals"
+  | "greater"
+  | "less"
+  | "is_null"
+  | "not_null";
+
+export interface ColumnFilter {
+  column: number;
+  op: FilterOp;
+  value: string;
+}
+
+export interface ViewRequest {
+  result_set: number;
+  sort: SortKey[];
+  filters: ColumnFilter[];
+  offset: number;
+  limit: number;
+}
+
+export interface ViewPage {
+  rows: CellValue[][];
+  /** Rows matching the filters. */
+  matched: number;
+  /** Rows the view was computed over. */
+  retained: number;
+  /** False when some fetched rows were spilled or over the memory budget. */
+  complete: boolean;
+}
+
+export type AggregateOp = "count" | "sum" | "min" | "max";
+
+export interface AggregateRequest {
+  result_set: number;
+  group_by: number[];
+  aggregates: { op: AggregateOp; column: number | null }[];
+  filters: ColumnFilter[];
+}
+
+export interface AggregateResult {
+  columns: string[];
+  rows: CellValue[][];
+  truncated: boolean;
+}
+
+export interface ResultSetSummary {
+  columns: string[];
+  row_count: number;
+}
+
+/** Actual plan and runtime statistics; mirrors `QueryPlan` in `core/db/plan.rs`. */
+export interface QueryPlan {
+  format: "showplan_xml" | "postgres_json" | "";
+  plans: string[];
+  cpu_ms: number | null;
+  elapsed_ms: number | null;
+  logical_reads: number | null;
+  physical_reads: number | null;
+  error: string | null;
+}
+
+/** Events of a streaming `execute_query` (mirrors `QueryEvent` in commands.rs). */
+export type QueryEvent =
+  | { kind: "columns"; columns: string[] }
+  | { kind: "rows"; rows: CellValue[][] }
+  | { kind: "finished"; result: QueryResult };
+
+/** Mirrors `ReplayReport` in `core/db/replay.rs`. */
+export interface ReplayRun {
+  execution_index: number;
+  elapsed_ms: number;
+  /** Rows returned, or affected for statements without a result set. */
+  rows: number;
+  error: string | null;
+}
+
+export interface ReplayReport {
+  sql: string;
+  prepare_ms: number | null;
+  runs: ReplayRun[];
+  total_ms: number;
+}
+
+/** Mirrors `SessionReport` in `core/db/session.rs`. */
+export interface SessionStep {
+  execution_index: number;
+  sql: string;
+  elapsed_ms: number;
+  rows: number;
+  columns: string[];
+  first_row: CellValue[] | null;
+  error: string | null;
+}
+
+export interface SessionReport {
+  steps: SessionStep[];
+  /** Statements not run because an earlier one failed. */
+  skipped: number;
+  total_ms: number;
+}
+
+/** Mirrors `FanoutReport` in `core/db/fanout.rs`. */
+export type DiffMode = "ordered" | "multiset";
+
+export interface SideReport {
+  connection_id: string;
+  name: string;
+  elapsed_ms: number;
+  rows: number;
+  columns: string[];
+  truncated: boolean;
+  error: string | null;
+}
+
+export interface SideDiff {
+  connection_id: string;
+  extra: number;
+  missing: number;
+  first_difference: number | null;
+  columns_match: boolean;
+  extra_samples: CellValue[][];
+  missing_samples: CellValue[][];
+}
+
+export interface FanoutReport {
+  mode: DiffMode;
+  baseline_id: string;
+  sides: SideReport[];
+  diffs: SideDiff[];
+  identical: boolean;
+  total_ms: number;
+}
+
+/** Mirrors `ChecksumRequest` in `core/db/checksum.rs`. */
+export interface ChecksumRequest {
+  table: string;
+  /** Integer column the ranges are taken over. */
+  key_column: string;
+  /** Columns to hash; empty hashes whole rows. */
+  columns: string[];
+  segments: number;
+  leaf_rows: number;
+  /** Key range to compare; the table's own bounds where null. */
+  lo: number | null;
+  hi: number | null;
+}
+
+export interface RangeDiff {
+  lo: number;
+  hi: number;
+  /** Rows in the range per connection, in request order. */
+  rows: number[];
+}
+
+export interface ChecksumReport {
+  connection_ids: string[];
+  rows: number[];
+  identical: boolean;
+  ranges: RangeDiff[];
+  truncated: boolean;
+  queries: number;
+  rows_fetched: number;
+  total_ms: number;
+}
+
+// ─── Benchmark Types (mirrors src-tauri/src/core/db/bench.rs) ───────────────
+
+export interface BenchRequest {
+  iterations: number;
+  warmup: number;
+  /** Run untimed before every run, e.g. to drop the buffer cache. */
+  setup_sql: string | null;
+}
+
+export interface Distribution {
+  p50_ms: number;
+  p95_ms: number;
+  max_ms: number;
+}
+
+export interface BenchSample {
+  total_ms: number;
+  server_ms: number;
+  transfer_ms: number;
+  decode_ms: number;
+}
+
+export interface BenchReport {
+  iterations: number;
+  warmup: number;
+  rows: number;
+  server: Distribution;
+  transfer: Distribution;
+  decode: Distribution;
+  total: Distribution;
+  samples: BenchSample[];
+}
+
+// ─── Export Types (mirrors src-tauri/src/core/db/export.rs) ─────────────────
+
+export interface ExportRequest {
+  path: string;
+  separator: string;
+  /** Output encoding label, e.g. "UTF-8" or "SHIFT_JIS". */
+  encoding: string;
+  /** Byte order mark for UTF-8, so Excel detects the encoding. */
+  bom: boolean;
+}
+
+export interface ExportProgress {
+  rows: number;
+  bytes: number;
+}
+
+export interface ExportReport {
+  path: string;
+  rows: number;
+  bytes: number;
+  result_sets: number;
+  elapsed_ms: number;
+}
+
+/** Mirrors `ProbeSample` in `core/db/health.rs`. */
+export interface ProbeSample {
+  at_ms: number;
+  connect_ms: number | null;
+  login_ms: number | null;
+  round_trip_ms: number | null;
+  error: string | null;
+}
+
+export interface ConnectionHealth {
+  connection_id: string;
+  /** Oldest first. */
+  samples: ProbeSample[];
+}
+
+/** Mirrors `HistoryEntry` in `core/history.rs`. */
+export interface HistoryEntry {
+  id: number;
+  executed_at_ms: number;
+  connection_id: string;
+  connection_name: string;
+  sql: string;
+  duration_ms: number;
+  /** Rows returned, or affected for statements without a result set. */
+  rows: number;
+  error: string | null;
+}
+
+export interface HistoryFilter {
+  /** Words that must all occur in the SQL, each as a prefix. */
+  text?: string;
+  connection_id?: string;
+  /** Only entries older than this ID, for paging back. */
+  before_id?: number;
+  limit?: number;
 }
 
 export interface DbConfig {
@@ -26,6 +317,12 @@ export interface DbConfig {
   user: string;
   password: string;
   encoding: string | null;
+  /** Seconds before a statement is abandoned; 0 = no limit. */
+  statement_timeout_secs: number;
+  /** Stop fetching after this many rows; 0 = no cap. */
+  max_rows: number;
+  /** Seconds read-only results are served from the cache; 0 = no caching. */
+  cache_ttl_secs: number;
 }
 
 export interface ConnectionFields {
@@ -99,6 +396,9 @@ export interface Config {
   csv_separator: string;
   encoding: string;
   format_sql: boolean;
+  memory_budget_mb: number;
+  spill_after_rows: number;
+  spill_after_mb: number;
 }
 
 export interface LegacyDbConnection {
@@ -109,3 +409,49 @@ export interface LegacyDbConnection {
   password: string;
   use_windows_auth: boolean;
 }
+
+// ─── Perf Types (mirrors src-tauri/src/utils/perf.rs) ───────────────────────
+
+export interface PhaseTiming {
+  phase: string;
+  micros: number;
+}
+
+export interface CommandRecord {
+  command: string;
+  finished_at_ms: number;
+  total_micros: number;
+  phases: PhaseTiming[];
+  payload_bytes: number | null;
+}
+
+export interface PhaseHistogram {
+  command: string;
+  phase: string;
+  count: number;
+  total_micros: number;
+  max_micros: number;
+  p50_micros: number;
+  p95_micros: number;
+  buckets: number[];
+}
+
+export interface PerfStats {
+  recent: CommandRecord[];
+  histograms: PhaseHistogram[];
+}
+
+// ─── Memory Types (mirrors src-tauri/src/utils/memory.rs) ───────────────────
+
+export interface SubsystemUsage {
+  subsystem: string;
+  current_bytes: number;
+  peak_bytes: number;
+}
+
+export interface MemoryStats {
+  subsystems: SubsystemUsage[];
+  charged_bytes: number;
+  budget_bytes: number | null;
+  heap: { current_bytes: number; peak_bytes: number } | null;
+}
@@ -0,0 +1,138 @@
+import type { CellValue } from "../types";
+
+// Column kinds of a frame from `core/db/columnar.rs`
+const KIND_NULL = 0;
+const KIND_INT32 = 1;
+const KIND_INT64 = 2;
+const KIND_FLOAT64 = 3;
+const KIND_BOOL = 4;
+const KIND_TEXT = 5;
+
+type CellReader = (row: number, col: number) => string | null;
+
+export function cellValueToString(cell: CellValue): string {
+  if (cell === "Null") return "NULL";
+  if (typeof cell === "object") {
+    if ("Text" in cell) return cell.Text;
+    if ("Int" in cell) return cell.Int.toString();
+    if ("Float" in cell) return cell.Float.toString();
+    if ("Bool" in cell) return cell.Bool.toString();
+    if ("DateTime" in cell) return cell.DateTime;
+    if ("Binary" in cell) return cell.Binary;
+    if ("Decimal" in cell) return cell.Decimal;
+  }
+  return "?";
+}
+
+const align = (n: number) => (n + 7) & ~7;
+
+/**
+ * Read a columnar frame in place: numeric columns are typed-array views over
+ * the buffer, and each distinct string is decoded once per frame.
+ */
+export function decodeFrame(buf: ArrayBuffer): { rowCount: number; cell: CellReader } {
+  const view = new DataView(buf);
+  const rowCount = view.getUint32(0, true);
+  const columnCount = view.getUint32(4, true);
+  const columns: ((row: number) => string | null)[] = [];
+  let at = 8;
+
+  for (let c = 0; c < columnCount; c++) {
+    const kind = view.getUint32(at, true);
+    at += 8;
+    const nulls = new Uint8Array(buf, at, (rowCount + 7) >> 3);
+    at = align(at + nulls.length);
+    const isNull = (row: number) => (nulls[row >> 3] >> (row & 7)) & 1;
+
+    switch (kind) {
+      case KIND_NULL:
+        columns.push(() => null);
+        break;
+      case KIND_INT32: {
+        const values = new Int32Array(buf, at, rowCount);
+        at = align(at + rowCount * 4);
+        columns.push((row) => (isNull(row) ? null : values[row].toString()));
+        break;
+      }
+      case KIND_INT64: {
+        const values = new BigInt64Array(buf, at, rowCount);
+        at += rowCount * 8;
+        columns.push((row) => (isNull(row) ? null : values[row].toString()));
+        break;
+      }
+      case KIND_FLOAT64: {
+        const values = new Float64Array(buf, at, rowCount);
+        at += rowCount * 8;
+        columns.push((row) => (isNull(row) ? null : values[row].toString()));
+        break;
+      }
+      case KIND_BOOL: {
+        const values = new Uint8Array(buf, at, rowCount);
+        at = align(at + rowCount);
+        columns.push((row) => (isNull(row) ? null : values[row] ? "true" : "false"));
+        break;
+      }
+      case KIND_TEXT: {
+        const entries = view.getUint32(at, true);
+        const byteLen = view.getUint32(at + 4, true);
+        const offsets = new Uint32Array(buf, at + 8, entries + 1);
+        at = align(at + 8 + (entries + 1) * 4);
+        const bytes = new Uint8Array(buf, at, byteLen);
+        at = align(at + byteLen);
+        const indices = new Uint32Array(buf, at, rowCount);
+        at = align(at + rowCount * 4);
+
+        const decoder = new TextDecoder();
+        const strings: string[] = [];
+        for (let i = 0; i < entries; i++) {
+          strings.push(decoder.decode(bytes.subarray(offsets[i], offsets[i + 1])));
+        }
+        columns.push((row) => (isNull(row) ? null : strings[indices[row]]));
+        break;
+      }
+      default:
+        throw new Error(`Unknown column kind ${kind} in result frame`);
+    }
+  }
+
+  return { rowCount, cell: (row, col) => columns[col]?.(row) ?? null };
+}
+
+/**
+ * Rows of one result, kept as the batches they arrived in (JSON rows or
+ * columnar frames) so appending a batch does not copy earlier ones.
+ */
+export class ResultRows {
+  private batches: { start: number; cell: CellReader }[] = [];
+  rowCount = 0;
+
+  append(batch: CellValue[][] | ArrayBuffer) {
+    let rowCount: number;
+    let cell: CellReader;
+    if (batch instanceof ArrayBuffer) {
+      ({ rowCount, cell } = decodeFrame(batch));
+    } else {
+      rowCount = batch.length;
+      cell = (row, col) => {
+        const value = batch[row][col];
+        return value === undefined || value === "Null" ? null : cellValueToString(value);
+      };
+    }
+    if (rowCount === 0) return;
+    this.batches.push({ start: this.rowCount, cell });
+    this.rowCount += rowCount;
+  }
+
+  /** Display text of a cell, or `null` for SQL NULL. */
+  cell(row: number, col: number): string | null {
+    let lo = 0;
+    let hi = this.batches.length - 1;
+    while (lo < hi) {
+      const mid = (lo + hi + 1) >> 1;
+      if (this.batches[mid].start <= row) lo = mid;
+      else hi = mid - 1;
+    }
+    const batch = this.batches[lo];
+    return batch ? batch.cell(row - batch.start, col) : null;
+  }
+}